@@ -0,0 +1,112 @@
+#ifndef deflate_stream_h
+#define deflate_stream_h
+
+#include <inttypes.h>
+#include <stddef.h>
+#include <string.h>
+
+#include <blvckstd/compattrs.h>
+
+/*
+  The deflate stream compresses a byte stream into the gzip format
+  (RFC 1951, RFC 1952) with constant memory, so it can sit between a
+  document producer and the chunks of a response.
+
+  Matches are searched within a small sliding window through hash chains,
+  and all symbols are encoded with the fixed huffman codes, as there's no
+  room to buffer a whole block for building dynamic codes. That gives away
+  some ratio compared to zlib, but JSON mostly repeats the same keys within
+  a few hundred bytes, which a small window still catches.
+
+  Input is taken as long as there's room within the window and output is
+  buffered until it's read, so the caller alternates between writing and
+  reading until the stream has been finished and drained.
+*/
+
+// Size of the sliding window, has to be a power of two
+#define DEFLATE_STREAM_WINDOW 1024
+
+// Number of bits of a hash chain head index
+#define DEFLATE_STREAM_HASH_BITS 10
+#define DEFLATE_STREAM_HASH_SIZE (1 << DEFLATE_STREAM_HASH_BITS)
+
+// Maximum number of chain links followed when searching for a match
+#define DEFLATE_STREAM_MAX_CHAIN 16
+
+// Matches at least this long are taken right away without searching any further
+#define DEFLATE_STREAM_GOOD_MATCH 32
+
+// Number of bytes of compressed output buffered until they're read
+#define DEFLATE_STREAM_OUT_LEN 512
+
+// Match length limits of deflate
+#define DEFLATE_STREAM_MIN_MATCH 3
+#define DEFLATE_STREAM_MAX_MATCH 258
+
+typedef struct deflate_stream
+{
+  uint8_t window[2 * DEFLATE_STREAM_WINDOW];  // History, followed by the lookahead
+  size_t pos;                                 // Position of the next byte to compress
+  size_t end;                                 // End of the buffered input
+
+  uint16_t head[DEFLATE_STREAM_HASH_SIZE];    // Latest position plus one per hash, zero if none
+  uint16_t prev[DEFLATE_STREAM_WINDOW];       // Previous position plus one with the same hash
+
+  uint32_t bits;                              // Bits which don't make up a whole byte yet
+  uint8_t num_bits;                           // Number of pending bits
+
+  uint8_t out[DEFLATE_STREAM_OUT_LEN];        // Compressed output which hasn't been read yet
+  size_t out_len;                             // Number of buffered output bytes
+  size_t out_offs;                            // Number of output bytes already read
+
+  uint32_t crc;                               // CRC32 of the input so far
+  uint32_t total_in;                          // Number of input bytes taken
+  uint32_t total_out;                         // Number of output bytes read
+  bool finishing;                             // Whether all input has been written
+  bool finished;                              // Whether the trailer has been emitted
+} deflate_stream_t;
+
+/**
+ * @brief Initialize a stream for a new gzip member
+ */
+void deflate_stream_init(deflate_stream_t *ds);
+
+/**
+ * @brief Write input into the stream, which is only taken as long as there's room
+ * within the window and output buffer, so read in between
+ *
+ * @param ds Stream handle
+ * @param data Input to compress
+ * @param len Length of the input
+ *
+ * @return size_t Number of bytes taken
+ */
+size_t deflate_stream_write(deflate_stream_t *ds, const uint8_t *data, size_t len);
+
+/**
+ * @brief Mark the end of the input, the rest is flushed by the following reads
+ */
+void deflate_stream_finish(deflate_stream_t *ds);
+
+/**
+ * @brief Read compressed output from the stream
+ *
+ * @param ds Stream handle
+ * @param buf Buffer to read into
+ * @param len Length of the buffer
+ *
+ * @return size_t Number of bytes read, zero if more input is needed or the stream is done
+ */
+size_t deflate_stream_read(deflate_stream_t *ds, uint8_t *buf, size_t len);
+
+/**
+ * @brief Check whether the stream has been finished and all of it's output has been read
+ */
+bool deflate_stream_done(deflate_stream_t *ds);
+
+/**
+ * @brief Get the maximum compressed length of an input, including the gzip framing
+ */
+size_t deflate_stream_bound(size_t len);
+
+#endif
\ No newline at end of file
@@ -0,0 +1,225 @@
+#ifndef json_reader_h
+#define json_reader_h
+
+#include <inttypes.h>
+#include <stddef.h>
+#include <string.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdarg.h>
+
+#include <blvckstd/compattrs.h>
+#include <blvckstd/enumlut.h>
+#include <blvckstd/mman.h>
+
+/*
+  The json reader is the counterpart of the json writer. It tokenizes a
+  document incrementally, segment by segment as it arrives (like the body
+  segments of a request), and assigns the values of known keys directly
+  into the members of a caller-provided struct, as described by a schema.
+  No JSONH tree is built and nothing is allocated, only the current key and
+  the current scalar value are buffered, so memory stays constant no matter
+  how large the document gets.
+
+  A document is either a single flat object, or an array of flat objects
+  (items), where each item is handed to a callback as soon as it's complete.
+  Values of keys which are not part of the schema are skipped, including
+  nested objects and arrays.
+
+  The very same document model is also accepted as CBOR (RFC 8949): maps
+  with text string keys, of definite or indefinite length, and text strings,
+  unsigned integers, booleans and null as values. Tags are ignored.
+*/
+
+// Maximum length of a key, longer keys never match any field
+#define JSON_READER_KEY_MAXLEN 24
+
+// Maximum length of a scalar value, including the terminator
+#define JSON_READER_VALUE_MAXLEN 64
+
+// Maximum length of an error message, including the terminator
+#define JSON_READER_ERR_MAXLEN 96
+
+// Maximum number of fields within a schema, as presence is tracked by a bitmap
+#define JSON_READER_MAX_FIELDS 32
+
+// Maximum nesting depth of a skipped CBOR value
+#define JSON_READER_CBOR_MAX_DEPTH 8
+
+// Number of items left within a CBOR container of indefinite length
+#define JSON_READER_CBOR_INDEFINITE UINT64_MAX
+
+#define _EVALS_JSON_READER_TYPE(FUN)  \
+  FUN(JRT_STR,      0)                \
+  FUN(JRT_UINT,     1)                \
+  FUN(JRT_BOOL,     2)
+
+ENUM_TYPEDEF_FULL_IMPL(json_reader_type, _EVALS_JSON_READER_TYPE);
+
+#define _EVALS_JSON_READER_ERROR(FUN) \
+  FUN(JRE_NONE,     0)                \
+  FUN(JRE_SYNTAX,   1)                \
+  FUN(JRE_SCHEMA,   2)
+
+ENUM_TYPEDEF_FULL_IMPL(json_reader_error, _EVALS_JSON_READER_ERROR);
+
+typedef enum json_reader_state
+{
+  JRS_DOC,                                    // Expecting the document's object or array
+  JRS_ITEM_OR_ARR_END,                        // Expecting the first item or the end of an empty array
+  JRS_ITEM,                                   // Expecting an item after a comma
+  JRS_ARR_COMMA_OR_END,                       // Expecting the next item or the end of the array
+  JRS_KEY_OR_OBJ_END,                         // Expecting the first key or the end of an empty object
+  JRS_KEY_START,                              // Expecting a key after a comma
+  JRS_KEY,                                    // Within a key's string
+  JRS_COLON,                                  // Expecting the colon after a key
+  JRS_VALUE,                                  // Expecting a value
+  JRS_STR,                                    // Within a value's string
+  JRS_LITERAL,                                // Within a number, true, false or null
+  JRS_SKIP,                                   // Within a nested value that's skipped
+  JRS_OBJ_COMMA_OR_END,                       // Expecting the next key or the end of the object
+  JRS_END,                                    // Document complete, only whitespace may follow
+  JRS_FAILED                                  // An error occurred, see err
+} json_reader_state_t;
+
+/**
+ * @brief Converts a string value into a member, like a time string into a scheduler_time_t
+ *
+ * @param str String value
+ * @param err Error output, mman-allocated
+ * @param out Member to write
+ *
+ * @return true Converted successfully
+ * @return false Invalid value, see err
+ */
+typedef bool (*json_reader_convert_t)(const char *str, char **err, void *out);
+
+/**
+ * @brief Validates a completed object as a whole, like checking the relation of two members
+ *
+ * @param out Completed object
+ * @param seen Bit per field of the schema, set if it has been present
+ * @param err Error output, mman-allocated
+ *
+ * @return true Object valid
+ * @return false Object invalid, see err
+ */
+typedef bool (*json_reader_validate_t)(void *out, uint32_t seen, char **err);
+
+/**
+ * @brief Receives a completed and validated item of an array document
+ *
+ * @param item Completed item, reused for the next item afterwards
+ * @param seen Bit per field of the schema, set if it has been present
+ * @param arg Argument provided at initialization
+ * @param err Error output, mman-allocated
+ *
+ * @return true Item accepted
+ * @return false Item rejected, see err
+ */
+typedef bool (*json_reader_item_t)(void *item, uint32_t seen, void *arg, char **err);
+
+typedef struct json_reader_field
+{
+  const char *key;                            // Key within the object
+  json_reader_type_t type;                    // Type of the value
+  size_t offset;                              // Offset of the member within the object's struct
+  size_t size;                                // Size of the member, including the terminator for strings
+  json_reader_convert_t convert;              // Conversion of string values, NULL to copy them into the member
+  bool required;                              // Whether the object is invalid without this field
+} json_reader_field_t;
+
+// Field which is read into a member of a struct
+#define JSON_READER_FIELD(key, type, struct_type, member, convert, required) \
+  { key, type, offsetof(struct_type, member), sizeof(((struct_type *) 0)->member), convert, required }
+
+typedef struct json_reader_schema
+{
+  const json_reader_field_t *fields;          // Fields of the object
+  size_t num_fields;                          // Number of fields, at most JSON_READER_MAX_FIELDS
+  size_t out_len;                             // Size of the object's struct
+  json_reader_validate_t validate;            // Validation of completed objects, NULL if not needed
+} json_reader_schema_t;
+
+typedef struct json_reader
+{
+  const json_reader_schema_t *schema;         // Schema of the object or of all items
+  void *out;                                  // Struct the current object is read into
+  json_reader_item_t item_fn;                 // Item callback, NULL if the document is a single object
+  void *item_arg;                             // Argument passed to the item callback
+
+  json_reader_state_t state;                  // Current tokenizer state
+  uint32_t seen;                              // Bit per field, set if present within the current object
+  int field;                                  // Field of the current value, -1 if unknown
+
+  char key[JSON_READER_KEY_MAXLEN];           // Current key
+  size_t key_len;                             // Length of the current key, exceeding the buffer if too long
+
+  char value[JSON_READER_VALUE_MAXLEN];       // Current scalar value
+  size_t value_len;                           // Length of the current value, exceeding the buffer if too long
+
+  bool escaped;                               // Whether the last string character has been a backslash
+  uint8_t unicode_left;                       // Number of hex digits left within an unicode escape
+  uint16_t unicode;                           // Code point of the current unicode escape
+
+  size_t skip_depth;                          // Nesting depth of the skipped value
+  bool skip_in_str;                           // Whether the skipped value is within a string
+  bool skip_escaped;                          // Whether the last skipped string character has been a backslash
+
+  bool cbor;                                  // Whether the document is CBOR instead of JSON
+  uint8_t cbor_head;                          // Initial byte of the current CBOR item
+  uint8_t cbor_arg_left;                      // Number of argument bytes of the current item still to come
+  uint64_t cbor_arg;                          // Argument of the current item
+  uint64_t cbor_str_left;                     // Number of string bytes still to come
+  uint64_t cbor_arr_left;                     // Number of items left within the document's array
+  uint64_t cbor_obj_left;                     // Number of keys left within the current object
+  uint64_t cbor_skip[JSON_READER_CBOR_MAX_DEPTH];  // Number of items left per container of a skipped value
+  uint8_t cbor_skip_depth;                    // Nesting depth of the skipped value
+
+  size_t items;                               // Number of completed items
+  json_reader_error_t error;                  // Kind of error which occurred
+  char err[JSON_READER_ERR_MAXLEN];           // Error message
+} json_reader_t;
+
+/**
+ * @brief Initialize a reader for a new document
+ *
+ * @param jr Reader to initialize
+ * @param schema Schema of the object or of all items
+ * @param out Struct to read the object or the current item into, schema->out_len bytes
+ * @param item_fn Item callback to read an array of objects, NULL to read a single object
+ * @param item_arg Argument passed to the item callback
+ * @param cbor Whether the document is CBOR encoded instead of JSON
+ */
+void json_reader_init(
+  json_reader_t *jr,
+  const json_reader_schema_t *schema,
+  void *out,
+  json_reader_item_t item_fn,
+  void *item_arg,
+  bool cbor
+);
+
+/**
+ * @brief Feed the next segment of the document
+ *
+ * @param jr Reader handle
+ * @param data Segment data
+ * @param len Segment length
+ *
+ * @return true Segment processed
+ * @return false The document is invalid, see error and err
+ */
+bool json_reader_feed(json_reader_t *jr, const uint8_t *data, size_t len);
+
+/**
+ * @brief Check that the document has been completed after the last segment
+ *
+ * @param jr Reader handle
+ *
+ * @return true The document is complete and valid
+ * @return false The document is invalid or incomplete, see error and err
+ */
+bool json_reader_finish(json_reader_t *jr);
+
+#endif
\ No newline at end of file
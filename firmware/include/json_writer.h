@@ -0,0 +1,206 @@
+#ifndef json_writer_h
+#define json_writer_h
+
+#include <inttypes.h>
+#include <stddef.h>
+#include <string.h>
+#include <stdio.h>
+
+#include <blvckstd/compattrs.h>
+#include <blvckstd/dbglog.h>
+
+/*
+  The json writer serializes a document directly into caller-provided
+  output windows (like the chunk buffer of an async response), without
+  building a JSONH tree or a growing string first.
+
+  A document is described by a step routine, which emits one small unit
+  (a header, a single array item, a footer, ...) per invocation. The writer
+  invokes steps until the current window is full. Whatever part of the last
+  step didn't fit anymore is kept inside a small fixed overflow buffer and
+  flushed at the start of the next window, so memory stays constant no
+  matter how large the document gets.
+
+  The same step routines can also emit CBOR (RFC 8949) instead of JSON.
+  As the number of members isn't known when a container begins, objects
+  and arrays are encoded with indefinite length and closed by a break.
+*/
+
+// Maximum number of bytes a single step may spill over the end of a window
+#define JSON_WRITER_OVERFLOW_LEN 512
+
+// Maximum nesting depth of objects and arrays, exceeding it aborts the document
+#define JSON_WRITER_MAX_DEPTH 32
+
+// Number of spaces used per indentation level in pretty mode
+#define JSON_WRITER_INDENT 2
+
+typedef struct json_writer json_writer_t;
+
+typedef enum json_writer_format
+{
+  JWF_COMPACT,                                // JSON without any whitespace
+  JWF_PRETTY,                                 // Indented JSON
+  JWF_CBOR                                    // CBOR, see RFC 8949
+} json_writer_format_t;
+
+/**
+ * @brief Emits the unit of a document that corresponds to the current step
+ *
+ * @param jw Writer to emit into
+ * @param step Zero-based step index
+ * @param arg Argument provided at initialization
+ *
+ * @return true There are further steps to emit
+ * @return false The document is complete
+ */
+typedef bool (*json_writer_step_t)(json_writer_t *jw, size_t step, void *arg);
+
+struct json_writer
+{
+  uint8_t *buf;                               // Current output window, NULL when only measuring
+  size_t buf_len;                             // Length of the current output window
+  size_t buf_offs;                            // Write offset within the current output window
+
+  char overflow[JSON_WRITER_OVERFLOW_LEN];    // Bytes that didn't fit into the last window
+  size_t overflow_len;                        // Number of buffered overflow bytes
+  size_t overflow_offs;                       // Number of overflow bytes already flushed
+
+  uint32_t has_items;                         // Bit per nesting level, set if it already contains an item
+  uint8_t depth;                              // Current nesting depth
+  bool after_key;                             // Whether a key has just been written
+  json_writer_format_t format;                // Output format
+
+  size_t total;                               // Total number of bytes emitted so far
+  bool truncated;                             // Whether the overflow buffer has been exhausted
+  bool failed;                                // Whether the document has been aborted, nothing is emitted afterwards
+
+  json_writer_step_t step_fn;                 // Document step routine
+  void *step_arg;                             // Argument passed to the step routine
+  size_t step;                                // Next step to invoke
+  size_t cursor;                              // Free for the step routine to track it's position
+  bool done;                                  // Whether the last step has been emitted
+};
+
+/*
+============================================================================
+                                 Driving
+============================================================================
+*/
+
+/**
+ * @brief Initialize a writer for a new document
+ *
+ * @param jw Writer to initialize
+ * @param step_fn Document step routine
+ * @param step_arg Argument passed to the step routine
+ * @param format Output format
+ */
+void json_writer_init(json_writer_t *jw, json_writer_step_t step_fn, void *step_arg, json_writer_format_t format);
+
+/**
+ * @brief Fill an output window with the next bytes of the document
+ *
+ * @param jw Writer handle
+ * @param buf Output window
+ * @param len Length of the output window
+ *
+ * @return size_t Number of bytes written, zero once the document is complete
+ */
+size_t json_writer_fill(json_writer_t *jw, uint8_t *buf, size_t len);
+
+/**
+ * @brief Measure the total length of a document without writing it anywhere
+ *
+ * @param step_fn Document step routine
+ * @param step_arg Argument passed to the step routine
+ * @param format Output format
+ *
+ * @return size_t Length of the document in bytes
+ */
+size_t json_writer_measure(json_writer_step_t step_fn, void *step_arg, json_writer_format_t format);
+
+/*
+============================================================================
+                                 Emitting
+============================================================================
+*/
+
+/**
+ * @brief Begin a new object
+ */
+void json_writer_obj_begin(json_writer_t *jw);
+
+/**
+ * @brief End the current object
+ */
+void json_writer_obj_end(json_writer_t *jw);
+
+/**
+ * @brief Begin a new array
+ */
+void json_writer_arr_begin(json_writer_t *jw);
+
+/**
+ * @brief End the current array
+ */
+void json_writer_arr_end(json_writer_t *jw);
+
+/**
+ * @brief Write the key of the next value within the current object
+ *
+ * @param jw Writer handle
+ * @param key Key string, will be escaped
+ */
+void json_writer_key(json_writer_t *jw, const char *key);
+
+/**
+ * @brief Write a string value
+ *
+ * @param jw Writer handle
+ * @param value String to write, will be escaped
+ * @param maxlen Maximum number of characters to write from value
+ */
+void json_writer_str_n(json_writer_t *jw, const char *value, size_t maxlen);
+
+/**
+ * @brief Write a null-terminated string value
+ */
+void json_writer_str(json_writer_t *jw, const char *value);
+
+/**
+ * @brief Write a signed integer value
+ */
+void json_writer_int(json_writer_t *jw, long value);
+
+/**
+ * @brief Write an unsigned integer value
+ */
+void json_writer_uint(json_writer_t *jw, unsigned long value);
+
+/**
+ * @brief Write a boolean value
+ */
+void json_writer_bool(json_writer_t *jw, bool value);
+
+/**
+ * @brief Write a key and it's string value
+ */
+void json_writer_kv_str(json_writer_t *jw, const char *key, const char *value);
+
+/**
+ * @brief Write a key and it's signed integer value
+ */
+void json_writer_kv_int(json_writer_t *jw, const char *key, long value);
+
+/**
+ * @brief Write a key and it's unsigned integer value
+ */
+void json_writer_kv_uint(json_writer_t *jw, const char *key, unsigned long value);
+
+/**
+ * @brief Write a key and it's boolean value
+ */
+void json_writer_kv_bool(json_writer_t *jw, const char *key, bool value);
+
+#endif
\ No newline at end of file
@@ -14,6 +14,8 @@
 #include "web_server/sockets/web_server_socket_events.h"
 #include "valve_control.h"
 #include "scheduler_time.h"
+#include "json_writer.h"
+#include "json_reader.h"
 
 /*
   The scheduler schedules on-times over the period of one
@@ -62,7 +64,7 @@ typedef struct scheduler_interval
 } scheduler_interval_t;
 
 /**
- * @brief Parse an interval's writable values from json, using the following schema:
+ * @brief Json reader schema of an interval's writable values, read into a scheduler_interval_t:
  * 
  * {
  *   "start": "<hours>:<minutes>:<seconds>",
@@ -70,25 +72,38 @@ typedef struct scheduler_interval
  *   "identifier": <integer>,
  *   "disabled": <boolean>
  * }
+ */
+extern const json_reader_schema_t scheduler_interval_schema;
+
+/**
+ * @brief An interval along with it's index, as a snapshot to be written by scheduler_indexed_interval_json_step
+ */
+typedef struct scheduler_indexed_interval
+{
+  int index;                                  // Index within the array of intervals
+  scheduler_interval_t interval;              // Interval at that index
+} scheduler_indexed_interval_t;
+
+/**
+ * @brief Json writer step routine which emits a single interval along with it's index
  * 
- * @param json JSONH json node
- * @param err Error output buffer
- * @param out Value output buffer
+ * @param jw Json writer handle
+ * @param step Current step
+ * @param indexed scheduler_indexed_interval_t to write
  * 
- * @return true Parsing successful
- * @return false Parsing error, see err
+ * @return true There are further steps to emit
+ * @return false The interval has been written completely
  */
-bool scheduler_interval_parse(htable_t *json, char **err, scheduler_interval_t *out);
+bool scheduler_indexed_interval_json_step(json_writer_t *jw, size_t step, void *indexed);
 
 /**
- * @brief Transform a scheduler interval into it's JSONH object data-structure
+ * @brief Write a scheduler interval as a JSON object into a json writer
  * 
+ * @param jw Json writer handle
  * @param index Index within the array of intervals
- * @param interval Interval to transform
- * 
- * @return htable_t* JSONH data structure
+ * @param interval Interval to write
  */
-htable_t *scheduler_interval_jsonify(int index, scheduler_interval_t *interval);
+void scheduler_interval_json_write(json_writer_t *jw, int index, scheduler_interval_t *interval);
 
 /**
  * @brief Check if a given interval is equal to the empty interval constant
@@ -124,27 +139,59 @@ const scheduler_interval_t SCHEDULER_INTERVAL_EMPTY = { SCHEDULER_TIME_MIDNIGHT,
 // This callback provides the user with the occurring edge as well as the identifier
 typedef void (*scheduler_callback_t)(scheduler_edge_t, uint8_t, scheduler_weekday_t, scheduler_time_t);
 
+// The slot occupancy of a day is tracked within a single bitmap
+#if SCHEDULER_MAX_INTERVALS_PER_DAY > 32
+#error "SCHEDULER_MAX_INTERVALS_PER_DAY exceeds the width of the occupancy bitmap"
+#endif
+
 typedef struct scheduler_day
 {
   scheduler_interval_t intervals[SCHEDULER_MAX_INTERVALS_PER_DAY];  // Intervals of this day
   bool disabled;                                                    // Whether or not this day is disabled
+  uint32_t occupied;                                                // Bit per slot, set if it holds a non-empty interval
 } scheduler_day_t;
 
 /**
- * @brief Parse a day's writable values from json, using the following schema:
+ * @brief Update the occupancy bit of a slot, has to be called after every
+ * direct write to a day's intervals
+ * 
+ * @param day Day to update
+ * @param index Index of the slot that has been written
+ */
+void scheduler_day_update_occupancy(scheduler_day_t *day, size_t index);
+
+/**
+ * @brief Json reader schema of a day's writable values, read into a scheduler_day_t:
  * 
  * {
  *   "disabled": <boolean>
  * }
+ */
+extern const json_reader_schema_t scheduler_day_schema;
+
+/**
+ * @brief Json reader conversion of a weekday's name (WEEKDAY_XX) into a scheduler_weekday_t
+ */
+bool scheduler_weekday_json_convert(const char *str, char **err, void *out);
+
+/**
+ * @brief Json writer step routine which emits a scheduler day, one occupied interval per step,
+ * empty slots are omitted and can be derived from the total number of slots:
  * 
- * @param json JSONH json node
- * @param err Error output buffer
- * @param out Value output buffer
+ * {
+ *   "disabled": <boolean>,
+ *   "slots": <integer>,
+ *   "intervals": [ <occupied intervals, each with it's index> ]
+ * }
+ * 
+ * @param jw Json writer handle
+ * @param step Current step
+ * @param day scheduler_day_t to write
  * 
- * @return true Parsing successful
- * @return false Parsing error, see err
+ * @return true There are further steps to emit
+ * @return false The day has been written completely
  */
-bool scheduler_day_parse(htable_t *json, char **err, scheduler_day_t *out);
+bool scheduler_day_json_step(json_writer_t *jw, size_t step, void *day);
 
 typedef struct scheduler
 {
@@ -154,17 +201,31 @@ typedef struct scheduler
 
   scheduler_time_t last_tick_time;                 // Time at which the last tick occurred
   scheduler_weekday_t last_tick_day;               // Day at which the last tick occurred
+
+  uint32_t generation;                             // Incremented whenever any day or interval changes
+  SemaphoreHandle_t lock;                          // Held while ticking and while applying batches of changes
 } scheduler_t;
 
 /**
- * @brief Transform a scheduler weekday into it's JSONH object data-structure
+ * @brief Mark the schedule as changed, invalidating everything derived from an older generation
  * 
  * @param scheduler Scheduler handle
- * @param day Day of the target week
+ */
+void scheduler_bump_generation(scheduler_t *scheduler);
+
+/**
+ * @brief Lock the scheduler, so that no tick interleaves with a series of changes
  * 
- * @return htable_t* JSONH data structure
+ * @param scheduler Scheduler handle
  */
-htable_t *scheduler_weekday_jsonify(scheduler_t *scheduler, scheduler_weekday_t day);
+void scheduler_lock(scheduler_t *scheduler);
+
+/**
+ * @brief Unlock the scheduler after scheduler_lock
+ * 
+ * @param scheduler Scheduler handle
+ */
+void scheduler_unlock(scheduler_t *scheduler);
 
 /**
  * @brief Create a new scheduler with empty interval-lists
@@ -211,6 +272,37 @@ bool scheduler_unregister_interval(scheduler_t *scheduler, scheduler_weekday_t d
  */
 bool scheduler_change_interval(scheduler_t *scheduler, scheduler_weekday_t day, scheduler_interval_t from, scheduler_interval_t to);
 
+/**
+ * @brief Write an interval into a slot, broadcasting an event for every property that changed
+ * 
+ * @param scheduler Scheduler handle
+ * @param day Day of the week
+ * @param index Index of the slot
+ * @param interval New interval
+ */
+void scheduler_interval_patch(scheduler_t *scheduler, scheduler_weekday_t day, size_t index, const scheduler_interval_t *interval);
+
+/**
+ * @brief Clear a slot and broadcast it's deletion
+ * 
+ * @param scheduler Scheduler handle
+ * @param day Day of the week
+ * @param index Index of the slot
+ * 
+ * @return true Slot cleared
+ * @return false The slot has already been empty
+ */
+bool scheduler_interval_clear(scheduler_t *scheduler, scheduler_weekday_t day, size_t index);
+
+/**
+ * @brief Apply a day's writable values, broadcasting an event if they changed
+ * 
+ * @param scheduler Scheduler handle
+ * @param day Day of the week
+ * @param patch Writable values of the day
+ */
+void scheduler_day_patch(scheduler_t *scheduler, scheduler_weekday_t day, const scheduler_day_t *patch);
+
 /**
  * @brief Update the scheduler's internals, should be called in some kind of main-loop
  * 
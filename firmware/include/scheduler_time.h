@@ -1,6 +1,7 @@
 #ifndef scheduler_time_h
 #define scheduler_time_h
 
+#include <stdio.h>
 #include <blvckstd/strfmt.h>
 #include <blvckstd/longp.h>
 #include <blvckstd/partial_strdup.h>
@@ -14,6 +15,9 @@ typedef struct scheduler_time
 
 const scheduler_time_t SCHEDULER_TIME_MIDNIGHT = { 00, 00, 00 };
 
+// Length of a stringified time, including the null terminator
+#define SCHEDULER_TIME_STRLEN 9
+
 /**
  * @brief Stringify a time into the common "hh:mm:ss" format
  * 
@@ -22,6 +26,14 @@ const scheduler_time_t SCHEDULER_TIME_MIDNIGHT = { 00, 00, 00 };
  */
 char *scheduler_time_stringify(const scheduler_time_t *time);
 
+/**
+ * @brief Stringify a time into the common "hh:mm:ss" format without allocating
+ * 
+ * @param time Time to stringify
+ * @param buf Output buffer, has to hold at least SCHEDULER_TIME_STRLEN characters
+ */
+void scheduler_time_stringify_buf(const scheduler_time_t *time, char *buf);
+
 /**
  * @brief Decrement a time safely (having a lower-bound, midnight) by a certain amount
  * 
@@ -45,6 +57,18 @@ void scheduler_time_decrement_bound(scheduler_time_t *time, size_t seconds);
  */
 bool scheduler_time_parse(const char *str, char **err, scheduler_time_t *out);
 
+/**
+ * @brief Json reader conversion of a time string, see scheduler_time_parse
+ * 
+ * @param str Input string
+ * @param err Error output buffer
+ * @param out Output scheduler_time_t
+ * 
+ * @return true Parsing success
+ * @return false On parsing errors, see err
+ */
+bool scheduler_time_json_convert(const char *str, char **err, void *out);
+
 /**
  * @brief Compare two scheduler times
  * 
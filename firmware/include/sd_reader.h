@@ -0,0 +1,85 @@
+#ifndef sd_reader_h
+#define sd_reader_h
+
+#include <Arduino.h>
+#include <SD.h>
+#include <inttypes.h>
+#include <stddef.h>
+
+#include <blvckstd/compattrs.h>
+#include <blvckstd/mman.h>
+#include <blvckstd/dbglog.h>
+
+/*
+  The SD reader streams files through two chunk buffers. While the consumer
+  sends out the front buffer, a dedicated task already reads the next chunk
+  from the SD into the back buffer, so the SD bus and the network are kept
+  busy at the same time instead of taking turns.
+
+  Readers are taken from a small fixed pool. All chunks are read by the one
+  reader task, which fills one chunk of every active reader per round, so
+  concurrent downloads share the SD bus evenly.
+*/
+
+// Length of a single chunk buffer, each reader owns two of them
+#define SD_READER_CHUNK_LEN 4096
+
+// Maximum number of files being streamed at once
+#define SD_READER_POOL_LEN 4
+
+#define SD_READER_TASK_PRIO 3
+#define SD_READER_TASK_STACK 4096
+
+// Returned by reads which timed out before the next chunk has been read
+#define SD_READER_PENDING ((size_t) -1)
+
+typedef struct sd_reader
+{
+  File f;                                     // File being streamed, only touched by the reader task once opened
+  uint8_t *bufs[2];                           // Chunk buffers, mman-allocated
+  size_t lens[2];                             // Number of bytes read into each buffer
+  bool ready[2];                              // Whether a buffer holds a chunk not yet consumed
+  bool queued[2];                             // Whether a buffer waits to be filled by the reader task
+  uint8_t front;                              // Buffer consumed next
+  uint8_t fill_next;                          // Buffer filled next
+  size_t front_offs;                          // Number of bytes already consumed from the front buffer
+  bool in_use;                                // Whether this reader has been handed out
+  bool closing;                               // Whether this reader is released once it's last fill completed
+  TaskHandle_t waiter;                        // Task blocked on the next chunk, NULL if none
+} sd_reader_t;
+
+/**
+ * @brief Start streaming an opened file, the first chunk is read on the calling task
+ * so it's available right away, while the second one is prefetched by the reader task
+ * 
+ * @param f File to stream, ownership is taken over on success
+ * 
+ * @return sd_reader_t* Reader handle, NULL if the pool is exhausted or out of memory
+ */
+sd_reader_t *sd_reader_open(File f);
+
+/**
+ * @brief Read the next bytes of the file, at most up to the end of the current chunk
+ * 
+ * @param reader Reader handle
+ * @param buf Output buffer
+ * @param len Length of the output buffer
+ * @param timeout_ms Maximum time to wait for the next chunk, zero to not wait at all
+ * 
+ * @return size_t Number of bytes read, zero at the end of the file, SD_READER_PENDING on a timeout
+ */
+size_t sd_reader_read(sd_reader_t *reader, uint8_t *buf, size_t len, uint32_t timeout_ms);
+
+/**
+ * @brief Stop streaming and close the file, the handle must not be used afterwards
+ * 
+ * @param reader Reader handle
+ */
+void sd_reader_close(sd_reader_t *reader);
+
+/**
+ * @brief Start the reader task
+ */
+void sd_reader_init();
+
+#endif
\ No newline at end of file
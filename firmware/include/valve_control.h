@@ -7,6 +7,8 @@
 #include "shift_register.h"
 #include "scheduler_time.h"
 #include "sd_handler.h"
+#include "json_writer.h"
+#include "json_reader.h"
 #include "web_server/sockets/web_server_socket_events.h"
 
 // Maximum number of valves that can be attached to the system
@@ -38,10 +40,18 @@ valve_t valve_control_valve_make(const char *alias, bool disabled);
 typedef struct valve_control
 {
   valve_t valves[VALVE_CONTROL_NUM_VALVES]; // Valve table
+  uint32_t generation;                      // Incremented whenever the valve table changes
 } valve_control_t;
 
 valve_control_t valve_control_make();
 
+/**
+ * @brief Mark the valve table as changed, invalidating everything derived from an older generation
+ * 
+ * @param vc Valve controller handle
+ */
+void valve_control_bump_generation(valve_control_t *vc);
+
 /**
  * @brief Load all valve aliases from a file
  * 
@@ -66,30 +76,84 @@ void valve_control_file_save(valve_control_t *vc);
 void valve_control_toggle(valve_control_t *vc, size_t valve_id, bool state);
 
 /**
- * @brief Transform a valve into it's JSONH array data-structure
+ * @brief Find the valve which already uses an alias, ignoring casing
+ * 
+ * @param vc Valve controller handle
+ * @param valve_id ID of the valve that's about to use the alias, which is skipped
+ * @param alias Alias to look for
+ * 
+ * @return int ID of the valve using the alias, -1 if it's not in use
+ */
+int valve_control_find_alias(valve_control_t *vc, size_t valve_id, const char *alias);
+
+/**
+ * @brief Apply a valve's writable values, broadcasting an event for every property that changed
+ * 
+ * @param vc Valve controller handle
+ * @param valve_id ID of the target valve
+ * @param patch Writable values of the valve
+ */
+void valve_control_valve_patch(valve_control_t *vc, size_t valve_id, const valve_t *patch);
+
+/**
+ * @brief Start a valve's timer and turn it on
+ * 
+ * @param vc Valve controller handle
+ * @param valve_id ID of the target valve
+ * @param timer Duration of the timer
+ */
+void valve_control_timer_start(valve_control_t *vc, size_t valve_id, scheduler_time_t timer);
+
+/**
+ * @brief A valve along with it's id, as a snapshot to be written by valve_control_indexed_valve_json_step
+ */
+typedef struct valve_control_indexed_valve
+{
+  size_t valve_id;                          // ID of the valve
+  valve_t valve;                            // Valve with that ID
+} valve_control_indexed_valve_t;
+
+/**
+ * @brief Json writer step routine which emits a single valve along with it's id
  * 
+ * @param jw Json writer handle
+ * @param step Current step
+ * @param indexed valve_control_indexed_valve_t to write
+ * 
+ * @return true There are further steps to emit
+ * @return false The valve has been written completely
+ */
+bool valve_control_indexed_valve_json_step(json_writer_t *jw, size_t step, void *indexed);
+
+/**
+ * @brief Write a valve as a JSON object into a json writer
+ * 
+ * @param jw Json writer handle
  * @param vc Valve controller handle
  * @param valve_id ID of the target valve
+ */
+void valve_control_valve_json_write(json_writer_t *jw, valve_control_t *vc, size_t valve_id);
+
+/**
+ * @brief Json writer step routine which emits the list of all valves, one valve per step
+ * 
+ * @param jw Json writer handle
+ * @param step Current step
+ * @param vc valve_control_t to write
  * 
- * @return htable_t* JSONH data structure
+ * @return true There are further steps to emit
+ * @return false The list has been written completely
  */
-htable_t *valve_control_valve_jsonify(valve_control_t *vc, size_t valve_id);
+bool valve_control_json_step(json_writer_t *jw, size_t step, void *vc);
 
 /**
- * @brief Parsse a valve's writable values from json, using the following schema:
+ * @brief Json reader schema of a valve's writable values, read into a valve_t:
  * 
  * {
  *   "alias": "...",
  *   "disabled": <boolean>
  * }
- * 
- * @param json JSONH json node
- * @param err Error output buffer
- * @param out Value output buffer
- * 
- * @return true Parsing successful
- * @return false Parsing error, see err
  */
-bool valve_control_valve_parse(htable_t *json, char **err, valve_t *out);
+extern const json_reader_schema_t valve_control_valve_schema;
 
 #endif
\ No newline at end of file
@@ -11,4 +11,16 @@
 
 void web_server_route_any_options(AsyncWebServerRequest *request);
 
+/*
+============================================================================
+                              Initialization                                
+============================================================================
+*/
+
+/**
+ * @brief Answer all preflight requests right away, has to be called before attaching
+ * any other handlers so preflights never reach routing
+ */
+void web_server_route_any_options_init(AsyncWebServer *wsrv);
+
 #endif
\ No newline at end of file
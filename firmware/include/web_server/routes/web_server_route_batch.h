@@ -0,0 +1,72 @@
+#ifndef web_server_route_batch_h
+#define web_server_route_batch_h
+
+#include "web_server/web_server_common.h"
+#include "web_server/web_server_router.h"
+#include "scheduler.h"
+#include "valve_control.h"
+
+/*
+  POST /api/batch applies an ordered array of operations at once. All of
+  them are checked before anything is touched, so either every operation is
+  applied or none is. They're applied while the scheduler is locked, so no
+  tick interleaves, followed by persisting each affected table once and
+  publishing all resulting events together.
+
+  [
+    { "op": "BATCH_INTERVAL_SET", "day": "<weekday>", "index": <integer>,
+      "start": "<time>", "end": "<time>", "identifier": <integer>, "disabled": <boolean> },
+    { "op": "BATCH_INTERVAL_DELETE", "day": "<weekday>", "index": <integer> },
+    { "op": "BATCH_DAY_SET", "day": "<weekday>", "disabled": <boolean> },
+    { "op": "BATCH_VALVE_SET", "valve": <integer>, "alias": "...", "disabled": <boolean> },
+    { "op": "BATCH_TIMER_SET", "valve": <integer>, "duration": "<time>" }
+  ]
+
+  Deleting an already empty slot is not an error within a batch, as an
+  earlier operation of the same batch may be the one that emptied it.
+*/
+
+// Maximum number of operations within a single batch
+#define WEB_SERVER_ROUTE_BATCH_MAX_OPS 64
+
+// Maximum length of a batch's json body
+#define WEB_SERVER_ROUTE_BATCH_BODY_MAXLEN 8192
+
+#define _EVALS_WEB_SERVER_ROUTE_BATCH_OP(FUN) \
+  FUN(BATCH_INTERVAL_SET,       0)            \
+  FUN(BATCH_INTERVAL_DELETE,    1)            \
+  FUN(BATCH_DAY_SET,            2)            \
+  FUN(BATCH_VALVE_SET,          3)            \
+  FUN(BATCH_TIMER_SET,          4)
+
+ENUM_TYPEDEF_FULL_IMPL(web_server_route_batch_op_type, _EVALS_WEB_SERVER_ROUTE_BATCH_OP);
+
+typedef struct web_server_route_batch_op
+{
+  web_server_route_batch_op_type_t op;        // Type of the operation
+  scheduler_weekday_t day;                    // Target day of interval and day operations
+  uint8_t index;                              // Target slot of interval operations
+  uint8_t valve;                              // Target valve of valve and timer operations
+  scheduler_time_t start;                     // Start of the interval
+  scheduler_time_t end;                       // End of the interval
+  uint8_t identifier;                         // Identifier of the interval
+  bool disabled;                              // Disabled state of the interval, day or valve
+  char alias[VALVE_CONTROL_ALIAS_MAXLEN];     // Alias of the valve
+  scheduler_time_t duration;                  // Duration of the timer
+} web_server_route_batch_op_t;
+
+typedef struct web_server_route_batch
+{
+  size_t num_ops;                                           // Number of operations read
+  web_server_route_batch_op_t ops[WEB_SERVER_ROUTE_BATCH_MAX_OPS];  // Operations in order
+} web_server_route_batch_t;
+
+/*
+============================================================================
+                              Initialization                                
+============================================================================
+*/
+
+void web_server_route_batch_init(scheduler_t *scheduler_ref, valve_control_t *valvectl_ref);
+
+#endif
\ No newline at end of file
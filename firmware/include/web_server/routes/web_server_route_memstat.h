@@ -2,7 +2,7 @@
 #define web_server_route_memstat_h
 
 #include "web_server/web_server_common.h"
-#include "web_server/routes/web_server_route_any_options.h"
+#include "web_server/web_server_router.h"
 
 /*
 ============================================================================
@@ -10,6 +10,6 @@
 ============================================================================
 */
 
-void web_server_route_memstat_init(AsyncWebServer *wsrv);
+void web_server_route_memstat_init();
 
 #endif
\ No newline at end of file
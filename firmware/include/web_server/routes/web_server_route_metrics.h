@@ -0,0 +1,21 @@
+#ifndef web_server_route_metrics_h
+#define web_server_route_metrics_h
+
+#include "web_server/web_server_common.h"
+#include "web_server/web_server_cache.h"
+#include "web_server/web_server_static.h"
+#include "web_server/web_server_gzip.h"
+#include "web_server/web_server_admission.h"
+#include "web_server/sockets/web_server_socket_events.h"
+#include "web_server/web_server_router.h"
+#include "json_writer.h"
+
+/*
+============================================================================
+                              Initialization                                
+============================================================================
+*/
+
+void web_server_route_metrics_init();
+
+#endif
\ No newline at end of file
@@ -2,6 +2,7 @@
 #define web_server_route_not_found_h
 
 #include "web_server/web_server_common.h"
+#include "web_server/web_server_static.h"
 
 /*
 ============================================================================
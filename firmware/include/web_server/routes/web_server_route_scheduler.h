@@ -2,15 +2,19 @@
 #define web_server_route_scheduler_h
 
 #include "web_server/web_server_common.h"
-#include "web_server/routes/web_server_route_any_options.h"
+#include "web_server/web_server_cache.h"
+#include "web_server/web_server_router.h"
 #include "scheduler.h"
 
+// Maximum length of a day's or an interval's json body
+#define WEB_SERVER_ROUTE_SCHEDULER_BODY_MAXLEN 256
+
 /*
 ============================================================================
                               Initialization                                
 ============================================================================
 */
 
-void web_server_route_scheduler_init(scheduler_t *scheduler_ref, AsyncWebServer *wsrv);
+void web_server_route_scheduler_init(scheduler_t *scheduler_ref);
 
 #endif
\ No newline at end of file
@@ -0,0 +1,18 @@
+#ifndef web_server_route_state_h
+#define web_server_route_state_h
+
+#include "web_server/web_server_common.h"
+#include "web_server/web_server_cache.h"
+#include "web_server/web_server_router.h"
+#include "scheduler.h"
+#include "valve_control.h"
+
+/*
+============================================================================
+                              Initialization                                
+============================================================================
+*/
+
+void web_server_route_state_init(scheduler_t *scheduler_ref, valve_control_t *valvectl_ref);
+
+#endif
\ No newline at end of file
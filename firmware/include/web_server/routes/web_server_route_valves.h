@@ -2,15 +2,19 @@
 #define web_server_route_valves_h
 
 #include "web_server/web_server_common.h"
-#include "web_server/routes/web_server_route_any_options.h"
+#include "web_server/web_server_cache.h"
+#include "web_server/web_server_router.h"
 #include "valve_control.h"
 
+// Maximum length of a valve's or a timer's json body
+#define WEB_SERVER_ROUTE_VALVES_BODY_MAXLEN 256
+
 /*
 ============================================================================
                               Initialization                                
 ============================================================================
 */
 
-void web_server_route_valves_init(valve_control_t *valvectl_ref, AsyncWebServer *wsrv);
+void web_server_route_valves_init(valve_control_t *valvectl_ref);
 
 #endif
\ No newline at end of file
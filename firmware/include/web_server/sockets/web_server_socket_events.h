@@ -2,19 +2,102 @@
 #define web_server_socket_events_h
 
 #include <AsyncWebSocket.h>
+#include <AsyncEventSource.h>
 #include <blvckstd/dbglog.h>
 #include <blvckstd/enumlut.h>
 #include <blvckstd/mman.h>
+#include <blvckstd/longp.h>
+#include <inttypes.h>
+
+#include "scheduler_time.h"
 
 #define WEB_SERVER_SOCKET_EVENT_PATH "/api/events"
 
+// Server-sent events endpoint which carries the same events one-way, in text framing
+#define WEB_SERVER_SOCKET_EVENT_SSE_PATH "/api/events/sse"
+
+// Number of past events kept for replaying them to reconnecting clients
+#define WEB_SERVER_SOCKET_EVENT_REPLAY_LEN 64
+
+// Maximum length of an event in text framing, including the terminator
+#define WEB_SERVER_SOCKET_EVENT_MSG_MAXLEN 80
+
+// Maximum length of an event in binary framing
+#define WEB_SERVER_SOCKET_EVENT_BIN_MAXLEN 32
+
+// Maximum length of a valve alias carried by an event, has to fit VALVE_CONTROL_ALIAS_MAXLEN
+#define WEB_SERVER_SOCKET_EVENT_ALIAS_MAXLEN 16
+
+// Maximum number of simultaneously connected clients, further clients are rejected
+#define WEB_SERVER_SOCKET_EVENT_MAX_CLIENTS DEFAULT_MAX_WS_CLIENTS
+
+// Query parameter which carries the epoch and sequence number of the last event a reconnecting client received, as <epoch>:<seq>
+#define WEB_SERVER_SOCKET_EVENT_SINCE_PARAM "since"
+
+// Number of random bits of the epoch, which tells sequence numbers of different boots apart
+#define WEB_SERVER_SOCKET_EVENT_EPOCH_BITS 15
+
+// Subprotocol a client requests (as it's only protocol) to receive binary framed events
+#define WEB_SERVER_SOCKET_EVENT_PROTO_BIN "wse.bin.v1"
+
+// Query parameters which carry the initial subscription masks, see web_server_socket_event_topic_t
+#define WEB_SERVER_SOCKET_EVENT_TOPICS_PARAM "topics"
+#define WEB_SERVER_SOCKET_EVENT_VALVES_PARAM "valves"
+
+// Prefix of the message a client sends to change it's subscription: sub;<topics>;<valves>
+#define WEB_SERVER_SOCKET_EVENT_SUB_PREFIX "sub;"
+
+// Maximum length of a message received from a client
+#define WEB_SERVER_SOCKET_EVENT_RX_MAXLEN 32
+
+// Interval in which clients are pinged to measure their round trip time
+#define WEB_SERVER_SOCKET_EVENT_PING_INTERVAL_MS 5000
+
+// Clients which didn't answer a ping within this time are considered dead and evicted
+#define WEB_SERVER_SOCKET_EVENT_PONG_TIMEOUT_MS 10000
+
+// Connection probe a client may send, which is answered with the very same constant
+#define WEB_SERVER_SOCKET_EVENT_PROBE "<conn_test>"
+
+// Number of events waiting for publication, has to be a power of two and hold all events of a full /api/batch
+#define WEB_SERVER_SOCKET_EVENT_QUEUE_LEN 256
+
+// Maximum number of events sent within a single frame
+#define WEB_SERVER_SOCKET_EVENT_BATCH_LEN 32
+
+// Longest time an event waits for publication without web_server_socket_events_publish being called
+#define WEB_SERVER_SOCKET_EVENT_PUBLISH_INTERVAL_MS 50
+
+#define WEB_SERVER_SOCKET_EVENT_PUBLISHER_PRIO 1
+#define WEB_SERVER_SOCKET_EVENT_PUBLISHER_STACK 4096
+
+// Number of coalesced events staged per client while it's queue is full, exceeding it requires a resync
+#define WEB_SERVER_SOCKET_EVENT_STAGING_LEN 16
+
+/*
+  Clients only receive events of the topics they subscribed to, and events
+  concerning a specific valve only if that valve's bit is set in their valve
+  mask. Both masks default to everything. WSE_RESYNC_REQUIRED is always sent.
+*/
+typedef enum web_server_socket_event_topic
+{
+  WSE_TOPIC_VALVES    = 1 << 0,     // Valve state, alias and disabled changes
+  WSE_TOPIC_TIMERS    = 1 << 1,     // Valve timer updates, which occur every second while active
+  WSE_TOPIC_SCHEDULE  = 1 << 2,     // Day and interval edits
+  WSE_TOPIC_INTERVALS = 1 << 3,     // Intervals being scheduled on and off
+  WSE_TOPIC_ALL       = 0xFF
+} web_server_socket_event_topic_t;
+
+// Valve mask which covers all valves
+#define WEB_SERVER_SOCKET_EVENT_VALVES_ALL UINT32_MAX
+
 #define _EVALS_WEB_SERVER_SOCKET_EVENT(FUN)                                   \
   /*  Event name and id     |  Event parameters       */                      \
   FUN(WSE_INTERVAL_SCHED_ON,                0) /* <interval_index> */         \
   FUN(WSE_INTERVAL_SCHED_OFF,               1) /* <interval_index> */         \
   FUN(WSE_VALVE_ON,                         2) /* <valve_id> */               \
   FUN(WSE_VALVE_OFF,                        3) /* <valve_id> */               \
-  FUN(WSE_VALVE_RENAME,                     4) /* <valve_id> */               \
+  FUN(WSE_VALVE_RENAME,                     4) /* <valve_id><alias> */        \
   FUN(WSE_VALVE_DISABLE_ON,                 5) /* <valve_id> */               \
   FUN(WSE_VALVE_DISABLE_OFF,                6) /* <valve_id> */               \
   FUN(WSE_DAY_DISABLE_ON,                   7) /* <day> */                    \
@@ -25,10 +108,81 @@
   FUN(WSE_INTERVAL_END_CHANGE,             12) /* <day><index><end> */        \
   FUN(WSE_INTERVAL_IDENTIFIER_CHANGE,      13) /* <day><index><identifier> */ \
   FUN(WSE_INTERVAL_DELETED,                14) /* <day><index> */             \
-  FUN(WSE_VALVE_TIMER_UPDATED,             15) /* <valve_id><timer> */
+  FUN(WSE_VALVE_TIMER_UPDATED,             15) /* <valve_id><timer> */        \
+  FUN(WSE_RESYNC_REQUIRED,                 16) /* Missed events are lost */  \
+  FUN(WSE_EPOCH,                           17) /* <epoch> */
 
 ENUM_TYPEDEF_FULL_IMPL(web_socket_event, _EVALS_WEB_SERVER_SOCKET_EVENT);
 
+/*
+  Events are kept in their typed form and only serialized when being sent,
+  according to the framing each client negotiated on connect.
+
+  Text framing (default):
+  <seq>;<event name>;<param>;<param>...
+
+  Binary framing (subprotocol WEB_SERVER_SOCKET_EVENT_PROTO_BIN):
+  <u8 event id><u32 seq><params>
+
+  A frame may carry multiple events, which are separated by line breaks in
+  text framing and simply concatenated in binary framing.
+
+  Server-sent events (WEB_SERVER_SOCKET_EVENT_SSE_PATH) carry one event per
+  message, with the event name as the SSE event, the packed id as the SSE id
+  and the text framing as data. Reconnecting clients pass the last id they
+  received as Last-Event-ID, which is replayed like ?since=<epoch>:<seq>.
+
+  Sequence numbers start over on every boot, so they're only meaningful
+  together with the epoch, a random number picked at boot. Every websocket
+  client receives WSE_EPOCH first, replays from another epoch are answered
+  with WSE_RESYNC_REQUIRED. The SSE library only carries numeric ids, so
+  those are packed as <epoch> << 16 | <lower 16 bits of seq>.
+
+  All integers are little endian. Binary parameters are laid out as follows:
+  - valve_id, interval_index, day, index, identifier: u8
+  - start, end, timer: u32 seconds, packed from hours, minutes and seconds
+  - alias: u8 length followed by the characters, without terminator
+*/
+
+typedef struct web_server_socket_event
+{
+  web_socket_event_t type;                            // Type of the event
+  uint32_t seq;                                       // Sequence number, assigned when broadcasting
+  uint8_t day;                                        // Weekday of day and interval events
+  uint8_t index;                                      // Interval index or valve id
+  uint8_t identifier;                                 // New identifier of an interval
+  scheduler_time_t time;                              // New start or end of an interval, or a valve's timer
+  char alias[WEB_SERVER_SOCKET_EVENT_ALIAS_MAXLEN];   // New alias of a valve, not necessarily terminated
+} web_server_socket_event_t;
+
+typedef struct web_server_socket_events_stats
+{
+  uint32_t broadcasts;                                // Number of broadcasted events
+  uint32_t batches;                                   // Number of batches they've been published in
+  uint32_t dropped;                                   // Number of events dropped due to a full publication queue
+  uint32_t buffers;                                   // Number of shared message buffers allocated for them
+  uint64_t total_us;                                  // Time spent publishing batches in total
+  uint32_t max_us;                                    // Longest time publishing a single batch took
+  uint32_t staged;                                    // Number of events staged for clients with a full queue
+  uint32_t coalesced;                                 // Number of staged events replaced by a newer state
+  uint32_t resyncs;                                   // Number of clients told to resync due to staging overflows
+  uint32_t evicted;                                   // Number of clients evicted for not answering pings
+} web_server_socket_events_stats_t;
+
+typedef struct web_server_socket_events_sse_stats
+{
+  uint32_t clients;                                   // Number of connected server-sent event clients
+  uint32_t avg_waiting;                               // Average number of messages waiting per client
+} web_server_socket_events_sse_stats_t;
+
+typedef struct web_server_socket_events_client_info
+{
+  uint32_t id;                                        // Id of the websocket client
+  uint32_t rtt_us;                                    // Latest round trip time, zero until the first pong arrived
+  bool binary;                                        // Whether the client negotiated binary framing
+  uint8_t num_staged;                                 // Number of events staged while it's queue is full
+} web_server_socket_events_client_info_t;
+
 /**
  * @brief Initialize the websocket in conjunction with a webserver
  * 
@@ -37,19 +191,103 @@ ENUM_TYPEDEF_FULL_IMPL(web_socket_event, _EVALS_WEB_SERVER_SOCKET_EVENT);
 void web_server_socket_events_init(AsyncWebServer *wsrv);
 
 /**
- * @brief Clean up websocket-related resources, call this periodically inside the main loop
+ * @brief Clean up websocket-related resources and flush events staged for slow
+ * clients, call this periodically inside the main loop
  */
 void web_server_socket_events_cleanup();
 
+/*
+============================================================================
+                                Broadcasting                                
+============================================================================
+*/
+
+/**
+ * @brief Queue an event for being broadcasted to all connected clients, stamped with the
+ * next sequence number. This never blocks and is safe to be called from any task, the
+ * event is sent by the publisher task along with all other events queued in the meantime
+ * 
+ * Clients which reconnect with ?since=<epoch>:<seq> get all events after <seq> replayed, or
+ * WSE_RESYNC_REQUIRED stamped with the current sequence number if those have been lost
+ * 
+ * @param event Event to broadcast, the sequence number is assigned internally
+ */
+void web_server_socket_events_broadcast(const web_server_socket_event_t *event);
+
+/**
+ * @brief Wake up the publisher to send all queued events as one batch, call this after every tick
+ */
+void web_server_socket_events_publish();
+
+/**
+ * @brief Publish all queued events right away from the calling task, instead of waiting for the publisher
+ * 
+ * @return uint32_t Sequence number of the latest event after publishing, which includes all events queued before the call
+ */
+uint32_t web_server_socket_events_publish_now();
+
+/**
+ * @brief Broadcast an event which only carries a valve id or an interval index
+ */
+void web_server_socket_events_broadcast_index(web_socket_event_t type, uint8_t index);
+
+/**
+ * @brief Broadcast an event which only carries a day
+ */
+void web_server_socket_events_broadcast_day(web_socket_event_t type, uint8_t day);
+
+/**
+ * @brief Broadcast an event which carries the day and index of an interval
+ */
+void web_server_socket_events_broadcast_interval(web_socket_event_t type, uint8_t day, uint8_t index);
+
+/**
+ * @brief Broadcast the new start or end of an interval
+ */
+void web_server_socket_events_broadcast_interval_time(web_socket_event_t type, uint8_t day, uint8_t index, scheduler_time_t time);
+
+/**
+ * @brief Broadcast the new identifier of an interval
+ */
+void web_server_socket_events_broadcast_interval_identifier(uint8_t day, uint8_t index, uint8_t identifier);
+
+/**
+ * @brief Broadcast the new alias of a valve
+ */
+void web_server_socket_events_broadcast_valve_rename(uint8_t valve_id, const char *alias);
+
+/**
+ * @brief Broadcast the current timer value of a valve
+ */
+void web_server_socket_events_broadcast_valve_timer(uint8_t valve_id, scheduler_time_t timer);
+
+/**
+ * @brief Get the sequence number of the latest broadcasted event, zero if there was none yet
+ */
+uint32_t web_server_socket_events_last_seq();
+
+/**
+ * @brief Get the epoch of this boot, which sequence numbers are only valid within
+ */
+uint32_t web_server_socket_events_epoch();
+
+/**
+ * @brief Get a copy of the current broadcasting statistics
+ */
+web_server_socket_events_stats_t web_server_socket_events_get_stats();
+
+/**
+ * @brief Get statistics about the server-sent events endpoint
+ */
+web_server_socket_events_sse_stats_t web_server_socket_events_get_sse_stats();
+
 /**
- * @brief Broadcast an event to all connected clients
+ * @brief Get information about all connected clients
  * 
- * Protocol layout:
- * <event>;<arg>
+ * @param out Output buffer, has to fit WEB_SERVER_SOCKET_EVENT_MAX_CLIENTS entries
  * 
- * @param event Event to broadcast
- * @param arg Event argument, leave NULL if not required by the event
+ * @return size_t Number of clients written
  */
-void web_server_socket_events_broadcast(web_socket_event_t event, char *arg);
+size_t web_server_socket_events_get_clients(web_server_socket_events_client_info_t *out);
 
 #endif
\ No newline at end of file
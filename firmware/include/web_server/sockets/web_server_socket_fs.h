@@ -11,11 +11,17 @@
 #include <blvckstd/partial_strdup.h>
 
 #include "untar.h"
+#include "json_writer.h"
+#include "sd_reader.h"
+#include "web_server/web_server_static.h"
 
 #define WEB_SERVER_SOCKET_FS_PATH "/api/fs"
 #define WEB_SERFER_SOCKET_FS_CMD_TASK_PRIO 2
 #define WEB_SERFER_SOCKET_FS_TASK_QUEUE_LEN 10
 #define WEB_SERFER_SOCKET_FS_WRITE_TIMEOUT 1000
+#define WEB_SERFER_SOCKET_FS_MAX_UPLOADS 4
+#define WEB_SERFER_SOCKET_FS_LISTING_ATTEMPTS 3
+#define WEB_SERFER_SOCKET_FS_READ_TIMEOUT 5000
 
 #define _EVALS_WEB_SERVER_SOCKET_FS_RESPONSE(FUN) \
   FUN(WSFS_NON_BINARY_DATA,         0)            \
@@ -43,7 +49,9 @@
   FUN(WSFS_FILE_APPENDED,          22)            \
   FUN(WSFS_UPDATE_FAILED,          23)            \
   FUN(WSFS_UPDATED,                24)            \
-  FUN(WSFS_NOT_A_BIN,              25)             
+  FUN(WSFS_NOT_A_BIN,              25)            \
+  FUN(WSFS_UPLOADS_BUSY,           26)            \
+  FUN(WSFS_DIR_CHANGED,            27)             
 
 ENUM_TYPEDEF_FULL_IMPL(web_server_socket_fs_response, _EVALS_WEB_SERVER_SOCKET_FS_RESPONSE);
 
@@ -61,6 +69,7 @@ ENUM_TYPEDEF_FULL_IMPL(file_req_type, _EVALS_FILE_REQ_TYPE);
 typedef struct file_req_task_arg
 {
   AsyncWebSocketClient *client;
+  uint32_t client_id;
   char *path;
   file_req_type_t type;
   File file;
@@ -77,6 +86,17 @@ typedef struct untar_req_cb_arg {
   char *containing_dir;
 } untar_req_cb_arg_t;
 
+/**
+ * @brief Represents a chunked file upload of a client, which spans over multiple frames
+ */
+typedef struct web_server_socket_fs_upload
+{
+  uint32_t client_id;
+  File file;
+  long remaining;
+  unsigned long last;
+} web_server_socket_fs_upload_t;
+
 /**
  * @brief Initialize the websocket in conjunction with a webserver
  * 
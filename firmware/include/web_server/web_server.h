@@ -3,11 +3,16 @@
 
 #include "web_server/web_server_error.h"
 #include "web_server/web_server_common.h"
+#include "web_server/web_server_router.h"
+#include "web_server/web_server_static.h"
 #include "web_server/routes/web_server_route_not_found.h"
 #include "web_server/routes/web_server_route_scheduler.h"
 #include "web_server/routes/web_server_route_valves.h"
+#include "web_server/routes/web_server_route_state.h"
+#include "web_server/routes/web_server_route_batch.h"
 #include "web_server/routes/web_server_route_any_options.h"
 #include "web_server/routes/web_server_route_memstat.h"
+#include "web_server/routes/web_server_route_metrics.h"
 #include "web_server/sockets/web_server_socket_events.h"
 #include "web_server/sockets/web_server_socket_fs.h"
 
@@ -0,0 +1,84 @@
+#ifndef web_server_admission_h
+#define web_server_admission_h
+
+#include "web_server/web_server_common.h"
+
+#include <blvckstd/compattrs.h>
+#include <blvckstd/dbglog.h>
+#include <ESPAsyncWebServer.h>
+#include <inttypes.h>
+
+/*
+  Admission control sits in front of the route handlers and decides once
+  per request, as soon as the router sees it, whether it's handled at all.
+  A request is turned away if
+
+  - it's client used up it's token bucket (429), which refills at a steady
+    rate and allows for short bursts, buckets are kept per remote IP
+  - the free heap dropped below a watermark (503), so AsyncTCP keeps enough
+    room for it's own buffers and the scheduler keeps running
+  - too many admitted requests are still in flight (503), which lasts until
+    their responses have been sent completely
+
+  Both statuses carry a Retry-After header. Rejections are answered with
+  bodies from flash, so turning a request away neither allocates a document
+  nor touches the scheduler, which keeps the server responsive under load.
+  Requests with a body are decided on their first segment, so rejected bodies
+  are dropped instead of being buffered.
+*/
+
+// Maximum number of admitted requests at once, until their responses have been sent
+#define WEB_SERVER_ADMISSION_MAX_IN_FLIGHT 4
+
+// Number of requests tracked at once, admitted ones and rejected ones awaiting their response
+#define WEB_SERVER_ADMISSION_SLOTS 8
+
+// Free heap in bytes below which requests are turned away
+#define WEB_SERVER_ADMISSION_HEAP_WATERMARK (32 * 1024)
+
+// Number of clients with their own token bucket, least recently seen ones are evicted
+#define WEB_SERVER_ADMISSION_BUCKETS 8
+
+// Tokens refilled per second and maximum tokens a bucket holds, one token per request
+#define WEB_SERVER_ADMISSION_RATE 5
+#define WEB_SERVER_ADMISSION_BURST 10
+
+// Seconds clients are asked to wait when the server is busy or short on heap
+#define WEB_SERVER_ADMISSION_RETRY_BUSY 1
+#define WEB_SERVER_ADMISSION_RETRY_HEAP 2
+
+typedef struct web_server_admission_stats
+{
+  uint32_t admitted;                          // Number of admitted requests
+  uint32_t rate_limited;                      // Number of requests rejected by their client's bucket
+  uint32_t busy;                              // Number of requests rejected due to too many in flight
+  uint32_t low_heap;                          // Number of requests rejected due to low heap
+  uint8_t in_flight;                          // Number of admitted requests currently in flight
+  uint8_t max_in_flight;                      // Highest number of admitted requests in flight at once
+} web_server_admission_stats_t;
+
+/**
+ * @brief Decide whether a request is handled, which is only done once per request and
+ * remembered until it's connection closes
+ * 
+ * @param request Client request
+ * @param first Whether this is the first time the router sees this request
+ * 
+ * @return true The request has been admitted
+ * @return false The request has to be rejected, see web_server_admission_reject
+ */
+bool web_server_admission_enter(AsyncWebServerRequest *request, bool first);
+
+/**
+ * @brief Respond to a request which has not been admitted with a 429 or 503
+ * 
+ * @param request Client request
+ */
+void web_server_admission_reject(AsyncWebServerRequest *request);
+
+/**
+ * @brief Get a copy of the current admission statistics
+ */
+web_server_admission_stats_t web_server_admission_get_stats();
+
+#endif
\ No newline at end of file
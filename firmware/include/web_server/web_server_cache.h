@@ -0,0 +1,111 @@
+#ifndef web_server_cache_h
+#define web_server_cache_h
+
+#include "web_server/web_server_common.h"
+#include "json_writer.h"
+
+#include <blvckstd/compattrs.h>
+#include <blvckstd/mman.h>
+#include <blvckstd/dbglog.h>
+#include <ESPAsyncWebServer.h>
+#include <inttypes.h>
+
+/*
+  Read-mostly GET endpoints keep their serialized bodies in a small cache,
+  keyed by route and argument. Every entry remembers the generation of the
+  state it has been rendered from, and the owning module bumps that
+  generation whenever the state changes, which implicitly invalidates all
+  bodies rendered before. The key and generation also make up the ETag, so
+  clients that already hold the current body get a 304 without any work.
+  Generations start over on every boot, so ETags also carry a random
+  per-boot nonce, which keeps bodies of a previous boot from matching.
+
+  JSON and CBOR bodies of the same resource are cached under separate keys,
+  just like bodies for clients which accept gzip, which are compressed once
+  when rendered if they're long enough.
+*/
+
+// Number of bodies kept in RAM at once, least recently used are evicted
+#define WEB_SERVER_CACHE_SLOTS 8
+
+// Maximum length of a cache key, including the format suffix and terminator
+#define WEB_SERVER_CACHE_KEY_MAXLEN 32
+
+// Maximum length of an ETag, which consists of the quoted key, boot nonce and generation
+#define WEB_SERVER_CACHE_ETAG_MAXLEN (WEB_SERVER_CACHE_KEY_MAXLEN + 24)
+
+// Compact bodies larger than this are streamed instead of being cached
+#define WEB_SERVER_CACHE_MAX_BODY 4096
+
+typedef struct web_server_cache_stats
+{
+  uint32_t hits;                              // Served from a cached body
+  uint32_t misses;                            // Rendered, cached if small enough
+  uint32_t not_modified;                      // Answered with a 304
+} web_server_cache_stats_t;
+
+/**
+ * @brief Respond with a body rendered by a json writer step routine in the negotiated format, served from
+ * the cache if it's still up to date or answered with a 304 if the client's ETag matches
+ * 
+ * @param request Client request
+ * @param route_key Cache key, unique per route and argument
+ * @param generation Generation of the state the body is rendered from
+ * @param step_fn Json writer step routine that emits the body
+ * @param arg Argument of the step routine, a snapshot is taken on a miss
+ * @param arg_len Length of the argument in bytes
+ */
+void web_server_cache_json_resp(
+  AsyncWebServerRequest *request,
+  const char *route_key,
+  uint32_t generation,
+  json_writer_step_t step_fn,
+  const void *arg,
+  size_t arg_len
+);
+
+/**
+ * @brief Respond without rendering anything if possible, that is with a 304 if the client's
+ * ETag matches or with the cached body if it's still up to date, useful to avoid taking
+ * expensive snapshots for web_server_cache_json_resp in the common case
+ * 
+ * @param request Client request
+ * @param route_key Cache key, unique per route and argument
+ * @param generation Generation of the current state
+ * 
+ * @return true The request has been responded to
+ * @return false The body needs to be rendered
+ */
+bool web_server_cache_try_resp(AsyncWebServerRequest *request, const char *route_key, uint32_t generation);
+
+/**
+ * @brief Like web_server_cache_json_resp, but renders from a snapshot the route already took itself,
+ * so it's not copied once more, expects web_server_cache_try_resp to have failed right before
+ * 
+ * @param request Client request
+ * @param route_key Cache key, unique per route and argument
+ * @param generation Generation of the state the snapshot has been taken from
+ * @param step_fn Json writer step routine that emits the body
+ * @param snapshot Argument of the step routine, mman-allocated, ownership is taken over
+ * @param snapshot_len Length of the snapshot in bytes
+ */
+void web_server_cache_snapshot_resp(
+  AsyncWebServerRequest *request,
+  const char *route_key,
+  uint32_t generation,
+  json_writer_step_t step_fn,
+  void *snapshot,
+  size_t snapshot_len
+);
+
+/**
+ * @brief Initialize the cache, has to be called before any route responds from it
+ */
+void web_server_cache_init();
+
+/**
+ * @brief Get a copy of the current cache statistics
+ */
+web_server_cache_stats_t web_server_cache_get_stats();
+
+#endif
\ No newline at end of file
@@ -2,16 +2,89 @@
 #define web_server_common
 
 #include "web_server/web_server_error.h"
+#include "web_server/web_server_gzip.h"
+#include "json_writer.h"
+#include "json_reader.h"
 
 #include <blvckstd/compattrs.h>
 #include <blvckstd/mman.h>
 #include <blvckstd/jsonh.h>
 #include <ESPAsyncWebServer.h>
 #include <SD.h>
+#include <memory>
 
 // Root directory on the SD for web-files, has to have a trailing /
 #define WEB_SERVER_STATIC_PATH "/web/"
 
+// Number of spaces JSON responses are indented by when pretty-printing has been requested
+#define WEB_SERVER_JSON_PRETTY_INDENT 2
+
+// Content-types of the supported document formats, where JSON is the default
+#define WEB_SERVER_TYPE_JSON "application/json"
+#define WEB_SERVER_TYPE_CBOR "application/cbor"
+
+/*
+============================================================================
+                                  Headers                                   
+============================================================================
+*/
+
+/*
+  Browsers only read the allowed methods, headers and max-age from the
+  response to a preflight, all other responses only have to allow the
+  origin. As every header costs a pair of heap allocated strings, the
+  remaining ones are only appended by the preflight handler.
+*/
+
+/**
+ * @brief Append the header that allows cross-origin requests to a response
+ * 
+ * @param resp Response to append to
+ */
+void web_server_append_cors_headers(AsyncWebServerResponse *resp);
+
+/**
+ * @brief Append all headers a response to a CORS preflight request needs
+ * 
+ * @param resp Response to append to
+ */
+void web_server_append_preflight_headers(AsyncWebServerResponse *resp);
+
+/*
+============================================================================
+                                Negotiation                                 
+============================================================================
+*/
+
+/**
+ * @brief Check whether the client requested pretty-printed JSON by passing ?pretty=1,
+ * responses are compact otherwise
+ * 
+ * @param request Client request
+ */
+bool web_server_wants_pretty(AsyncWebServerRequest *request);
+
+/**
+ * @brief Check whether the client accepts CBOR by listing application/cbor within
+ * the Accept header, responses are JSON otherwise
+ * 
+ * @param request Client request
+ */
+bool web_server_wants_cbor(AsyncWebServerRequest *request);
+
+/**
+ * @brief Pick the format of a document response, CBOR if accepted, otherwise JSON
+ * which is pretty-printed if requested
+ * 
+ * @param request Client request
+ */
+json_writer_format_t web_server_negotiate_format(AsyncWebServerRequest *request);
+
+/**
+ * @brief Get the content-type of a document format
+ */
+const char *web_server_format_type(json_writer_format_t format);
+
 /*
 ============================================================================
                                Success routines                               
@@ -34,6 +107,38 @@ void web_server_empty_ok(AsyncWebServerRequest *request);
  */
 void web_server_json_resp(AsyncWebServerRequest *request, int status, htable_t *json);
 
+/**
+ * @brief Stream a JSON response to the client, which is written directly into the
+ * chunks of the response by a json writer step routine, as CBOR if the client accepts it
+ * and gzipped if the client accepts it and the document is long enough
+ * 
+ * @param request Client request
+ * @param status Response's statuscode
+ * @param step_fn Json writer step routine that emits the body
+ * @param arg Argument of the step routine, a snapshot is taken so the body stays consistent
+ * @param arg_len Length of the argument in bytes
+ */
+void web_server_json_stream_resp(
+  AsyncWebServerRequest *request,
+  int status,
+  json_writer_step_t step_fn,
+  const void *arg,
+  size_t arg_len
+);
+
+/**
+ * @brief Create a streamed JSON response without sending it, see web_server_json_stream_resp
+ * 
+ * @return AsyncWebServerResponse* Response with CORS headers, ready to be sent, an error response if out of memory
+ */
+AsyncWebServerResponse *web_server_json_stream_begin(
+  AsyncWebServerRequest *request,
+  int status,
+  json_writer_step_t step_fn,
+  const void *arg,
+  size_t arg_len
+);
+
 /*
 ============================================================================
                                Error routines                               
@@ -50,32 +155,74 @@ void web_server_json_resp(AsyncWebServerRequest *request, int status, htable_t *
  */
 void web_server_error_resp(AsyncWebServerRequest *request, int status, web_server_error_t code, const char *fmt, ...);
 
+/**
+ * @brief Create an OVERLOADED (503) error response from flash without sending it,
+ * for when there's not enough heap left to build the actual response
+ * 
+ * @param request Client request
+ * 
+ * @return AsyncWebServerResponse* Response with CORS headers, ready to be sent
+ */
+AsyncWebServerResponse *web_server_out_of_memory_begin(AsyncWebServerRequest *request);
+
+/**
+ * @brief Send an OVERLOADED (503) error response from flash, see web_server_out_of_memory_begin
+ * 
+ * @param request Client request
+ */
+void web_server_out_of_memory_resp(AsyncWebServerRequest *request);
+
 /*
 ============================================================================
                                 Body Handling                               
 ============================================================================
 */
 
+/*
+  JSON bodies are never collected as a whole. Each segment is fed into a
+  json reader as it arrives, which reads the body straight into the route's
+  struct, so a request only ever holds the reader and that struct, no matter
+  how large the body claims to be. Bodies exceeding the route's maximum
+  length are rejected without reading them.
+
+  Bodies sent with the content-type application/cbor are read as CBOR
+  into the very same structs.
+*/
+
+/**
+ * @brief Describes the JSON body a route expects, passed as the router's body argument
+ */
+typedef struct web_server_json_body
+{
+  const json_reader_schema_t *schema;         // Schema of the object or of all items
+  size_t max_len;                             // Maximum length of the body in bytes
+  json_reader_item_t item_fn;                 // Item callback to read an array of objects, NULL to read a single object
+  size_t doc_len;                             // Size of the document's struct which is passed to the item callback
+} web_server_json_body_t;
+
 /**
- * @brief Body handler routine to collect segmented string request bodies
+ * @brief Body handler routine to read segmented JSON request bodies, expects a
+ * web_server_json_body_t as it's argument
  * 
  * @param request Client request
+ * @param arg Expected body, web_server_json_body_t
  * @param data Current segment data
  * @param len Current segment data length
  * @param index Index of first byte of current segment inside whole message
  * @param total Total amount of bytes
  */
-void web_server_str_body_handler(AsyncWebServerRequest *request, uint8_t *data, size_t len, size_t index, size_t total);
+void web_server_json_body_handler(AsyncWebServerRequest *request, const void *arg, uint8_t *data, size_t len, size_t index, size_t total);
 
 /**
- * @brief Ensure that a valid JSON body is present and parse it
+ * @brief Ensure that a valid JSON body has been read
  * 
  * @param request Client request
- * @param output Jsonh output
+ * @param output Struct the body has been read into, the object for single object bodies
+ * and the document otherwise, lives as long as the request
  * 
- * @return true JSON OK and parsed
+ * @return true JSON OK and read
  * @return false JSON invalid, error response has been sent
  */
-bool web_server_ensure_json_body(AsyncWebServerRequest *request, htable_t **output);
+bool web_server_ensure_json_body(AsyncWebServerRequest *request, void **output);
 
 #endif
\ No newline at end of file
@@ -34,7 +34,10 @@
   FUN(NOT_A_DIR,                       20)       \
   FUN(IS_A_DIR,                        21)       \
   FUN(COULD_NOT_DELETE_FILE,           22)       \
-  FUN(COULD_NOT_DELETE_DIR,            23)       
+  FUN(COULD_NOT_DELETE_DIR,            23)       \
+  /* Admission */                                \
+  FUN(RATE_LIMITED,                    24)       \
+  FUN(OVERLOADED,                      25)       
 
 ENUM_TYPEDEF_FULL_IMPL(web_server_error, _EVALS_WEB_SERVER_ERROR);
 
@@ -0,0 +1,123 @@
+#ifndef web_server_gzip_h
+#define web_server_gzip_h
+
+#include "json_writer.h"
+#include "deflate_stream.h"
+
+#include <blvckstd/compattrs.h>
+#include <blvckstd/mman.h>
+#include <blvckstd/dbglog.h>
+#include <ESPAsyncWebServer.h>
+#include <inttypes.h>
+
+/*
+  Dynamic responses are gzipped on the fly if the client accepts it and the
+  document is long enough for compression to pay off, as short ones barely
+  shrink while still paying for the framing and the CPU time. Streamed
+  documents are measured up front and then compressed chunk by chunk,
+  cached bodies are compressed once when they're rendered.
+
+  Every compressed stream holds it's own window, so only a few of them are
+  in flight at once, further responses are sent uncompressed. Ratio and time
+  spent are tracked per route, to tell which endpoints benefit.
+*/
+
+// Documents shorter than this are sent uncompressed
+#define WEB_SERVER_GZIP_MIN_LEN 512
+
+// Maximum number of responses which are compressed at the same time
+#define WEB_SERVER_GZIP_MAX_STREAMS 2
+
+// Number of routes statistics are kept for
+#define WEB_SERVER_GZIP_STATS_SLOTS 12
+
+// Number of document bytes rendered at once before they're compressed
+#define WEB_SERVER_GZIP_SLAB_LEN 256
+
+typedef struct web_server_gzip_stats
+{
+  const char *endpoint;                       // Route pattern, NULL if the slot is unused
+  uint32_t compressed;                        // Number of compressed bodies
+  uint32_t skipped;                           // Number of bodies which were too short
+  uint32_t busy;                              // Number of bodies sent uncompressed due to too many streams
+  uint32_t bytes_in;                          // Length of all compressed bodies
+  uint32_t bytes_out;                         // Length of all compressed bodies after compression
+  uint64_t total_us;                          // Time spent measuring and compressing
+} web_server_gzip_stats_t;
+
+/**
+ * @brief State of a compressed document stream
+ */
+typedef struct web_server_gzip_stream
+{
+  deflate_stream_t ds;
+  uint8_t slab[WEB_SERVER_GZIP_SLAB_LEN];     // Rendered document bytes
+  size_t slab_len;                            // Number of rendered bytes
+  size_t slab_offs;                           // Number of rendered bytes already compressed
+  const char *endpoint;                       // Route pattern the stream has been started for
+  uint32_t took_us;                           // Time spent so far
+} web_server_gzip_stream_t;
+
+/**
+ * @brief Check whether the client accepts gzip by listing it within the Accept-Encoding header
+ * 
+ * @param request Client request
+ */
+bool web_server_gzip_accepted(AsyncWebServerRequest *request);
+
+/**
+ * @brief Start compressing a streamed document if the client accepts gzip and it's long enough
+ * 
+ * @param request Client request
+ * @param step_fn Json writer step routine that emits the document
+ * @param arg Argument of the step routine
+ * @param format Format the document is emitted in
+ * 
+ * @return web_server_gzip_stream_t* Stream to fill the response from, NULL if it's sent uncompressed
+ */
+web_server_gzip_stream_t *web_server_gzip_stream_begin(
+  AsyncWebServerRequest *request,
+  json_writer_step_t step_fn,
+  void *arg,
+  json_writer_format_t format
+);
+
+/**
+ * @brief Fill an output window with the next compressed bytes of a document
+ * 
+ * @param gs Stream handle
+ * @param jw Writer of the document
+ * @param buf Output window
+ * @param len Length of the output window
+ * 
+ * @return size_t Number of bytes written, zero once the stream is complete
+ */
+size_t web_server_gzip_stream_fill(web_server_gzip_stream_t *gs, json_writer_t *jw, uint8_t *buf, size_t len);
+
+/**
+ * @brief Record a stream's statistics and release it, when it's response is done or aborted
+ */
+void web_server_gzip_stream_free(web_server_gzip_stream_t *gs);
+
+/**
+ * @brief Compress a rendered body if the client accepts gzip and it's long enough
+ * 
+ * @param request Client request
+ * @param body Body to compress
+ * @param len Length of the body
+ * @param gz_len Output length of the compressed body
+ * 
+ * @return uint8_t* Compressed body, mman-allocated, NULL if it's sent uncompressed
+ */
+uint8_t *web_server_gzip_body(AsyncWebServerRequest *request, const uint8_t *body, size_t len, size_t *gz_len);
+
+/**
+ * @brief Get a copy of the per-route compression statistics
+ * 
+ * @param stats Buffer of WEB_SERVER_GZIP_STATS_SLOTS statistics to copy into
+ * 
+ * @return size_t Number of used slots
+ */
+size_t web_server_gzip_get_stats(web_server_gzip_stats_t *stats);
+
+#endif
\ No newline at end of file
@@ -0,0 +1,85 @@
+#ifndef web_server_router_h
+#define web_server_router_h
+
+#include "web_server/web_server_common.h"
+#include "web_server/web_server_admission.h"
+#include "scheduler.h"
+
+#include <blvckstd/compattrs.h>
+#include <blvckstd/dbglog.h>
+#include <ESPAsyncWebServer.h>
+#include <inttypes.h>
+
+/*
+  The router dispatches all API requests through a static trie of path
+  segments instead of matching every request against a list of regular
+  expressions. Each node is either a literal segment or a typed capture:
+
+  {int}      A non-negative decimal number
+  {weekday}  A scheduler_weekday_t name, like WEEKDAY_MO
+
+  Patterns look like /api/valves/{int}/timer and have to be string literals,
+  as nodes point into them instead of copying segments. Literal segments take
+  precedence over captures on the same level. A segment which reaches a
+  capture but fails to convert is answered with a 400, just like route
+  handlers answer malformed identifiers.
+
+  Every request has to pass admission control before it reaches a handler,
+  see web_server_admission.h.
+
+  Preflight requests (OPTIONS) never reach the router, see web_server_route_any_options_init.
+*/
+
+// Maximum number of trie nodes, one per distinct segment of all patterns
+#define WEB_SERVER_ROUTER_MAX_NODES 32
+
+// Maximum number of captures within a single pattern
+#define WEB_SERVER_ROUTER_MAX_CAPTURES 4
+
+// Maximum length of a segment which is converted into a weekday, including the terminator
+#define WEB_SERVER_ROUTER_WEEKDAY_MAXLEN 16
+
+/**
+ * @brief Values of all captures of a matched path, in order of appearance
+ */
+typedef struct web_server_route_args
+{
+  long values[WEB_SERVER_ROUTER_MAX_CAPTURES];        // Number or scheduler_weekday_t
+  uint8_t num_values;                                 // Number of captured values
+} web_server_route_args_t;
+
+typedef void (*web_server_route_handler_t)(AsyncWebServerRequest *request, const web_server_route_args_t *args);
+typedef void (*web_server_route_body_handler_t)(AsyncWebServerRequest *request, const void *arg, uint8_t *data, size_t len, size_t index, size_t total);
+
+/**
+ * @brief Register a handler for a method on a path pattern
+ * 
+ * @param pattern Path pattern, has to outlive the router
+ * @param method Method to handle
+ * @param handler Request handler, invoked with the captured values
+ * @param body_handler Optional handler for the request's body segments
+ * @param body_arg Argument passed to the body handler, like a description of the expected body
+ */
+void web_server_router_on(
+  const char *pattern,
+  WebRequestMethod method,
+  web_server_route_handler_t handler,
+  web_server_route_body_handler_t body_handler = NULL,
+  const void *body_arg = NULL
+);
+
+/**
+ * @brief Get the pattern of the route whose handler is currently running, like
+ * /api/scheduler/{weekday}, which is useful to label per-route statistics
+ * 
+ * @return const char* Pattern or NULL if called outside of a route handler
+ */
+const char *web_server_router_current_pattern();
+
+/**
+ * @brief Attach the router to a webserver, has to be called before attaching other handlers
+ * which could claim API paths (like static file serving)
+ */
+void web_server_router_init(AsyncWebServer *wsrv);
+
+#endif
\ No newline at end of file
@@ -0,0 +1,104 @@
+#ifndef web_server_static_h
+#define web_server_static_h
+
+#include "web_server/web_server_common.h"
+#include "sd_reader.h"
+
+#include <blvckstd/compattrs.h>
+#include <blvckstd/mman.h>
+#include <blvckstd/dbglog.h>
+#include <ESPAsyncWebServer.h>
+#include <SD.h>
+#include <ctype.h>
+
+/*
+  Small static files (index files, icons, stylesheets, runtime chunks, ...)
+  are requested by every client on every UI load. They're kept within a
+  bounded least-recently-used cache in RAM after their first use and served
+  from there without touching the SD bus, until the file system socket
+  changes anything at or above their path on the SD. Single page
+  applications answer every deep link with their index.html, which is
+  served from the same cache.
+
+  All files are served by a handler which prefers a precompressed
+  .gz sibling whenever the client accepts gzip, tags responses with an ETag
+  made up of the file's size and last write time and lets browsers keep
+  hashed bundles (<name>.<hash>.<ext>) forever, as their names change with
+  their content. Files too large for the cache are streamed through the
+  read-ahead SD reader.
+*/
+
+// Index files of the single page applications
+#define WEB_SERVER_STATIC_INDEX_PATH WEB_SERVER_STATIC_PATH "index.html"
+#define WEB_SERVER_STATIC_FILEMAN_INDEX_PATH WEB_SERVER_STATIC_PATH "fileman/index.html"
+
+// Total number of file bytes the cache may hold, can be overridden by a build flag
+#ifndef WEB_SERVER_STATIC_CACHE_BUDGET
+#define WEB_SERVER_STATIC_CACHE_BUDGET (64 * 1024)
+#endif
+
+// Files larger than this are always streamed from the SD, can be overridden by a build flag
+#ifndef WEB_SERVER_STATIC_CACHE_FILE_MAXLEN
+#define WEB_SERVER_STATIC_CACHE_FILE_MAXLEN (16 * 1024)
+#endif
+
+// Maximum number of files the cache may hold at once
+#define WEB_SERVER_STATIC_CACHE_SLOTS 24
+
+// Maximum length of a file's path on the SD, including the precompressed extension
+#define WEB_SERVER_STATIC_PATH_MAXLEN 128
+
+// Extension of precompressed siblings
+#define WEB_SERVER_STATIC_GZIP_EXT ".gz"
+
+// Minimum number of hex digits within a file name's second to last segment to be considered a hash
+#define WEB_SERVER_STATIC_HASH_MINLEN 16
+
+// Maximum length of an ETag, which consists of the quoted size, last write time and encoding
+#define WEB_SERVER_STATIC_ETAG_MAXLEN 40
+
+// Cache policies for hashed bundles and for all other files
+#define WEB_SERVER_STATIC_CACHE_IMMUTABLE "public, max-age=31536000, immutable"
+#define WEB_SERVER_STATIC_CACHE_REVALIDATE "no-cache"
+
+typedef struct web_server_static_stats
+{
+  uint32_t cache_hits;                                // Responses served from RAM
+  uint32_t cache_misses;                              // Responses which had to read from the SD
+  uint32_t cache_evictions;                           // Files dropped to make room for others
+  uint32_t cache_bytes;                               // File bytes currently held in RAM
+  uint32_t files;                                     // File responses with a body
+  uint32_t gzipped;                                   // File responses served from a precompressed sibling
+  uint32_t not_modified;                              // File responses answered with a 304
+  uint32_t bytes;                                     // Body bytes of all file responses
+} web_server_static_stats_t;
+
+/**
+ * @brief Respond with an index file, from the cache if possible
+ * 
+ * @param request Client request
+ * @param path Path of the index file, one of the WEB_SERVER_STATIC_*INDEX_PATH
+ */
+void web_server_static_send_index(AsyncWebServerRequest *request, const char *path);
+
+/**
+ * @brief Drop everything cached at or below a path, call this whenever a file or directory
+ * on the SD is written, created or deleted, safe to be called from any task
+ * 
+ * @param path Absolute path of the changed file or directory
+ */
+void web_server_static_invalidate(const char *path);
+
+/**
+ * @brief Get a copy of the current static file statistics
+ */
+web_server_static_stats_t web_server_static_get_stats();
+
+/**
+ * @brief Initialize the static file caches and attach the static file handler
+ * 
+ * @param wsrv Webserver to attach to
+ */
+void web_server_static_init(AsyncWebServer *wsrv);
+
+#endif
\ No newline at end of file
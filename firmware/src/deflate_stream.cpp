@@ -0,0 +1,361 @@
+#include "deflate_stream.h"
+
+/*
+============================================================================
+                                  Tables
+============================================================================
+*/
+
+// Magic, deflate, no flags, no modification time, no extra flags, unknown OS
+static const uint8_t deflate_stream_gzip_header[] = { 0x1F, 0x8B, 0x08, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0xFF };
+
+// Length of the gzip trailer, which is the CRC32 and length of the input
+#define DEFLATE_STREAM_GZIP_TRAILER_LEN 8
+
+// Maximum number of bytes a single literal or match may occupy, including pending bits
+#define DEFLATE_STREAM_SYMBOL_MAXLEN 8
+
+// Base lengths and extra bits of the length codes 257 to 285
+static const uint16_t deflate_stream_len_base[] = {
+  3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31,
+  35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258
+};
+
+static const uint8_t deflate_stream_len_extra[] = {
+  0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2,
+  3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0
+};
+
+// Base distances and extra bits of the distance codes 0 to 29
+static const uint16_t deflate_stream_dist_base[] = {
+  1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193,
+  257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577
+};
+
+static const uint8_t deflate_stream_dist_extra[] = {
+  0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6,
+  7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13
+};
+
+// CRC32 of every nibble, a full byte table would cost a whole kilobyte
+static const uint32_t deflate_stream_crc_table[] = {
+  0x00000000, 0x1DB71064, 0x3B6E20C8, 0x26D930AC, 0x76DC4190, 0x6B6B51F4, 0x4DB26158, 0x5005713C,
+  0xEDB88320, 0xF00F9344, 0xD6D6A3E8, 0xCB61B38C, 0x9B64C2B0, 0x86D3D2D4, 0xA00AE278, 0xBDBDF21C
+};
+
+/*
+============================================================================
+                                Bit output
+============================================================================
+*/
+
+INLINED static void deflate_stream_byte(deflate_stream_t *ds, uint8_t b)
+{
+  ds->out[ds->out_len++] = b;
+}
+
+/**
+ * @brief Append up to 16 bits, least significant first
+ */
+INLINED static void deflate_stream_bits(deflate_stream_t *ds, uint32_t value, uint8_t num_bits)
+{
+  ds->bits |= value << ds->num_bits;
+  ds->num_bits += num_bits;
+
+  while (ds->num_bits >= 8)
+  {
+    deflate_stream_byte(ds, (uint8_t) ds->bits);
+    ds->bits >>= 8;
+    ds->num_bits -= 8;
+  }
+}
+
+/**
+ * @brief Append a huffman code, which are packed starting with their most significant bit
+ */
+INLINED static void deflate_stream_code(deflate_stream_t *ds, uint16_t code, uint8_t len)
+{
+  uint16_t reversed = 0;
+  for (uint8_t i = 0; i < len; i++)
+  {
+    reversed = (reversed << 1) | (code & 1);
+    code >>= 1;
+  }
+
+  deflate_stream_bits(ds, reversed, len);
+}
+
+/**
+ * @brief Append a literal/length symbol using the fixed huffman codes
+ */
+INLINED static void deflate_stream_symbol(deflate_stream_t *ds, uint16_t symbol)
+{
+  if (symbol < 144)
+    deflate_stream_code(ds, 0x30 + symbol, 8);
+  else if (symbol < 256)
+    deflate_stream_code(ds, 0x190 + (symbol - 144), 9);
+  else if (symbol < 280)
+    deflate_stream_code(ds, symbol - 256, 7);
+  else
+    deflate_stream_code(ds, 0xC0 + (symbol - 280), 8);
+}
+
+INLINED static void deflate_stream_match(deflate_stream_t *ds, size_t len, size_t dist)
+{
+  size_t len_code = sizeof(deflate_stream_len_base) / sizeof(uint16_t) - 1;
+  while (deflate_stream_len_base[len_code] > len)
+    len_code--;
+
+  deflate_stream_symbol(ds, 257 + len_code);
+  deflate_stream_bits(ds, len - deflate_stream_len_base[len_code], deflate_stream_len_extra[len_code]);
+
+  size_t dist_code = sizeof(deflate_stream_dist_base) / sizeof(uint16_t) - 1;
+  while (deflate_stream_dist_base[dist_code] > dist)
+    dist_code--;
+
+  // Distance codes are all five bits long
+  deflate_stream_code(ds, dist_code, 5);
+  deflate_stream_bits(ds, dist - deflate_stream_dist_base[dist_code], deflate_stream_dist_extra[dist_code]);
+}
+
+INLINED static void deflate_stream_u32(deflate_stream_t *ds, uint32_t value)
+{
+  for (size_t i = 0; i < 4; i++)
+    deflate_stream_byte(ds, (uint8_t) (value >> (8 * i)));
+}
+
+/*
+============================================================================
+                                 Matching
+============================================================================
+*/
+
+INLINED static uint16_t deflate_stream_hash(const uint8_t *data)
+{
+  uint32_t value = ((uint32_t) data[0] << 16) | ((uint32_t) data[1] << 8) | data[2];
+  return (uint16_t) ((uint32_t) (value * 2654435761U) >> (32 - DEFLATE_STREAM_HASH_BITS));
+}
+
+/**
+ * @brief Link a position into the chain of it's hash, if there are enough bytes to hash
+ */
+INLINED static void deflate_stream_insert(deflate_stream_t *ds, size_t pos)
+{
+  if (pos + DEFLATE_STREAM_MIN_MATCH > ds->end)
+    return;
+
+  uint16_t hash = deflate_stream_hash(&(ds->window[pos]));
+  ds->prev[pos & (DEFLATE_STREAM_WINDOW - 1)] = ds->head[hash];
+  ds->head[hash] = (uint16_t) (pos + 1);
+}
+
+/**
+ * @brief Find the longest match for the bytes at the current position within the window
+ *
+ * @return size_t Length of the match, zero if there's none worth encoding
+ */
+INLINED static size_t deflate_stream_longest(deflate_stream_t *ds, size_t *dist)
+{
+  size_t pos = ds->pos;
+  size_t max_len = ds->end - pos;
+  if (max_len > DEFLATE_STREAM_MAX_MATCH)
+    max_len = DEFLATE_STREAM_MAX_MATCH;
+
+  if (max_len < DEFLATE_STREAM_MIN_MATCH)
+    return 0;
+
+  const uint8_t *cur = &(ds->window[pos]);
+  uint16_t link = ds->head[deflate_stream_hash(cur)];
+  size_t best = 0;
+
+  for (size_t i = 0; link && i < DEFLATE_STREAM_MAX_CHAIN; i++)
+  {
+    size_t cand = link - 1;
+
+    // Chains only ever lead backwards, and not further than the window reaches
+    if (cand >= pos || pos - cand >= DEFLATE_STREAM_WINDOW)
+      break;
+
+    // Only compare candidates which could possibly beat the best match
+    const uint8_t *other = &(ds->window[cand]);
+    if (other[best] == cur[best])
+    {
+      size_t len = 0;
+      while (len < max_len && other[len] == cur[len])
+        len++;
+
+      if (len > best)
+      {
+        best = len;
+        *dist = pos - cand;
+
+        if (len >= DEFLATE_STREAM_GOOD_MATCH || len == max_len)
+          break;
+      }
+    }
+
+    link = ds->prev[cand & (DEFLATE_STREAM_WINDOW - 1)];
+  }
+
+  return best >= DEFLATE_STREAM_MIN_MATCH ? best : 0;
+}
+
+/**
+ * @brief Drop the older half of the window to make room for more input
+ */
+INLINED static void deflate_stream_slide(deflate_stream_t *ds)
+{
+  memmove(ds->window, &(ds->window[DEFLATE_STREAM_WINDOW]), DEFLATE_STREAM_WINDOW);
+  ds->pos -= DEFLATE_STREAM_WINDOW;
+  ds->end -= DEFLATE_STREAM_WINDOW;
+
+  // Rebase all links, the ones into the dropped half are cut off
+  for (size_t i = 0; i < DEFLATE_STREAM_HASH_SIZE; i++)
+    ds->head[i] = ds->head[i] > DEFLATE_STREAM_WINDOW ? ds->head[i] - DEFLATE_STREAM_WINDOW : 0;
+
+  for (size_t i = 0; i < DEFLATE_STREAM_WINDOW; i++)
+    ds->prev[i] = ds->prev[i] > DEFLATE_STREAM_WINDOW ? ds->prev[i] - DEFLATE_STREAM_WINDOW : 0;
+}
+
+/**
+ * @brief Compress buffered input for as long as there's room for the output
+ */
+INLINED static void deflate_stream_pump(deflate_stream_t *ds)
+{
+  // Keep a full match worth of lookahead until the input ends
+  while (ds->pos < ds->end && (ds->finishing || ds->end - ds->pos >= DEFLATE_STREAM_MAX_MATCH))
+  {
+    if (DEFLATE_STREAM_OUT_LEN - ds->out_len < DEFLATE_STREAM_SYMBOL_MAXLEN)
+      return;
+
+    size_t dist = 0;
+    size_t len = deflate_stream_longest(ds, &dist);
+
+    if (len == 0)
+    {
+      deflate_stream_symbol(ds, ds->window[ds->pos]);
+      deflate_stream_insert(ds, ds->pos++);
+      continue;
+    }
+
+    deflate_stream_match(ds, len, dist);
+    for (size_t i = 0; i < len; i++)
+      deflate_stream_insert(ds, ds->pos++);
+  }
+
+  if (!ds->finishing || ds->finished || ds->pos < ds->end)
+    return;
+
+  if (DEFLATE_STREAM_OUT_LEN - ds->out_len < DEFLATE_STREAM_SYMBOL_MAXLEN + DEFLATE_STREAM_GZIP_TRAILER_LEN)
+    return;
+
+  // End of block, padded to a whole byte
+  deflate_stream_symbol(ds, 256);
+  if (ds->num_bits > 0)
+    deflate_stream_bits(ds, 0, 8 - ds->num_bits);
+
+  deflate_stream_u32(ds, ds->crc ^ 0xFFFFFFFF);
+  deflate_stream_u32(ds, ds->total_in);
+  ds->finished = true;
+}
+
+/*
+============================================================================
+                                 Driving
+============================================================================
+*/
+
+void deflate_stream_init(deflate_stream_t *ds)
+{
+  memset(ds, 0, sizeof(deflate_stream_t));
+  ds->crc = 0xFFFFFFFF;
+
+  memcpy(ds->out, deflate_stream_gzip_header, sizeof(deflate_stream_gzip_header));
+  ds->out_len = sizeof(deflate_stream_gzip_header);
+
+  // A single final block with fixed codes, as the length of the input is unknown
+  deflate_stream_bits(ds, 1, 1);
+  deflate_stream_bits(ds, 1, 2);
+}
+
+size_t deflate_stream_write(deflate_stream_t *ds, const uint8_t *data, size_t len)
+{
+  size_t taken = 0;
+
+  while (taken < len && !ds->finishing)
+  {
+    if (ds->end == sizeof(ds->window))
+    {
+      // The lookahead still reaches into the older half, output has to be read first
+      if (ds->pos < DEFLATE_STREAM_WINDOW)
+        break;
+
+      deflate_stream_slide(ds);
+    }
+
+    size_t room = sizeof(ds->window) - ds->end;
+    size_t num = len - taken < room ? len - taken : room;
+
+    for (size_t i = 0; i < num; i++)
+    {
+      uint8_t b = data[taken + i];
+      ds->window[ds->end + i] = b;
+
+      ds->crc ^= b;
+      ds->crc = (ds->crc >> 4) ^ deflate_stream_crc_table[ds->crc & 0x0F];
+      ds->crc = (ds->crc >> 4) ^ deflate_stream_crc_table[ds->crc & 0x0F];
+    }
+
+    ds->end += num;
+    ds->total_in += num;
+    taken += num;
+
+    deflate_stream_pump(ds);
+  }
+
+  return taken;
+}
+
+void deflate_stream_finish(deflate_stream_t *ds)
+{
+  ds->finishing = true;
+}
+
+size_t deflate_stream_read(deflate_stream_t *ds, uint8_t *buf, size_t len)
+{
+  size_t offs = 0;
+
+  while (offs < len)
+  {
+    // Drained, compress more of the buffered input
+    if (ds->out_offs == ds->out_len)
+    {
+      ds->out_len = 0;
+      ds->out_offs = 0;
+      deflate_stream_pump(ds);
+
+      if (ds->out_len == 0)
+        break;
+    }
+
+    size_t pending = ds->out_len - ds->out_offs;
+    size_t num = len - offs < pending ? len - offs : pending;
+    memcpy(&buf[offs], &(ds->out[ds->out_offs]), num);
+    ds->out_offs += num;
+    offs += num;
+  }
+
+  ds->total_out += offs;
+  return offs;
+}
+
+bool deflate_stream_done(deflate_stream_t *ds)
+{
+  return ds->finished && ds->out_offs == ds->out_len;
+}
+
+size_t deflate_stream_bound(size_t len)
+{
+  // Literals take up to nine bits, plus the framing and a few bits of block overhead
+  return len + (len / 8) + sizeof(deflate_stream_gzip_header) + DEFLATE_STREAM_GZIP_TRAILER_LEN + 8;
+}
\ No newline at end of file
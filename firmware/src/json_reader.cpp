@@ -0,0 +1,990 @@
+#include "json_reader.h"
+
+/*
+============================================================================
+                                  Errors                                    
+============================================================================
+*/
+
+static bool json_reader_fail(json_reader_t *jr, json_reader_error_t error, const char *fmt, ...)
+{
+  va_list ap;
+  va_start(ap, fmt);
+  vsnprintf(jr->err, sizeof(jr->err), fmt, ap);
+  va_end(ap);
+
+  jr->error = error;
+  jr->state = JRS_FAILED;
+  return false;
+}
+
+/**
+ * @brief Take over an mman-allocated error message of a callback
+ */
+static bool json_reader_fail_with(json_reader_t *jr, char *err)
+{
+  json_reader_fail(jr, JRE_SCHEMA, "%s", err ? err : "Invalid value");
+  mman_dealloc(err);
+  return false;
+}
+
+INLINED static const char *json_reader_type_desc(json_reader_type_t type)
+{
+  switch (type) {
+    case JRT_STR:
+      return "a string";
+
+    case JRT_UINT:
+      return "a non-negative integer";
+
+    case JRT_BOOL:
+      return "a boolean";
+  }
+
+  return "?";
+}
+
+/*
+============================================================================
+                                 Objects                                    
+============================================================================
+*/
+
+INLINED static void json_reader_obj_begin(json_reader_t *jr)
+{
+  memset(jr->out, 0, jr->schema->out_len);
+  jr->seen = 0;
+  jr->state = JRS_KEY_OR_OBJ_END;
+}
+
+static bool json_reader_obj_end(json_reader_t *jr)
+{
+  const json_reader_schema_t *schema = jr->schema;
+
+  for (size_t i = 0; i < schema->num_fields; i++)
+  {
+    if (schema->fields[i].required && !(jr->seen & (1UL << i)))
+      return json_reader_fail(jr, JRE_SCHEMA, "Missing key \"%s\"", schema->fields[i].key);
+  }
+
+  char *err = NULL;
+  if (schema->validate && !schema->validate(jr->out, jr->seen, &err))
+    return json_reader_fail_with(jr, err);
+
+  // Single object document
+  if (!jr->item_fn)
+  {
+    jr->state = JRS_END;
+    return true;
+  }
+
+  if (!jr->item_fn(jr->out, jr->seen, jr->item_arg, &err))
+    return json_reader_fail_with(jr, err);
+
+  jr->items++;
+  jr->state = JRS_ARR_COMMA_OR_END;
+  return true;
+}
+
+/**
+ * @brief Look up the field of the current key
+ */
+INLINED static int json_reader_find_field(json_reader_t *jr)
+{
+  // Too long to match any field
+  if (jr->key_len >= JSON_READER_KEY_MAXLEN)
+    return -1;
+
+  jr->key[jr->key_len] = 0;
+
+  for (size_t i = 0; i < jr->schema->num_fields; i++)
+  {
+    if (strcmp(jr->schema->fields[i].key, jr->key) == 0)
+      return i;
+  }
+
+  return -1;
+}
+
+/**
+ * @brief Assign the buffered value to the member of the current field
+ */
+static bool json_reader_assign(json_reader_t *jr, bool is_str)
+{
+  // Value of an unknown key
+  if (jr->field < 0)
+    return true;
+
+  const json_reader_field_t *field = &(jr->schema->fields[jr->field]);
+  uint8_t *member = &(((uint8_t *) jr->out)[field->offset]);
+
+  if (jr->value_len >= JSON_READER_VALUE_MAXLEN)
+    return json_reader_fail(jr, JRE_SCHEMA, "The value of \"%s\" is too long", field->key);
+
+  jr->value[jr->value_len] = 0;
+
+  // Null values are treated like absent keys
+  if (!is_str && strcmp(jr->value, "null") == 0)
+    return true;
+
+  switch (field->type) {
+    case JRT_STR:
+    {
+      if (!is_str)
+        break;
+
+      if (field->convert)
+      {
+        char *err = NULL;
+        if (!field->convert(jr->value, &err, member))
+          return json_reader_fail_with(jr, err);
+      }
+
+      else
+      {
+        if (jr->value_len >= field->size)
+          return json_reader_fail(jr, JRE_SCHEMA, "\"%s\" can have at most %u characters", field->key, (unsigned int) field->size - 1);
+
+        memcpy(member, jr->value, jr->value_len + 1);
+      }
+
+      jr->seen |= 1UL << jr->field;
+      return true;
+    }
+
+    case JRT_UINT:
+    {
+      if (is_str || jr->value_len == 0 || jr->value_len > 10)
+        break;
+
+      uint64_t value = 0;
+      for (size_t i = 0; i < jr->value_len; i++)
+      {
+        char c = jr->value[i];
+        if (c < '0' || c > '9')
+          return json_reader_fail(jr, JRE_SCHEMA, "\"%s\" has to be %s", field->key, json_reader_type_desc(field->type));
+
+        value = value * 10 + (c - '0');
+      }
+
+      uint64_t max = field->size >= 4 ? UINT32_MAX : (1ULL << (8 * field->size)) - 1;
+      if (value > max)
+        return json_reader_fail(jr, JRE_SCHEMA, "\"%s\" has to be at most %lu", field->key, (unsigned long) max);
+
+      if (field->size == 1)
+        *((uint8_t *) member) = value;
+      else if (field->size == 2)
+        *((uint16_t *) member) = value;
+      else
+        *((uint32_t *) member) = value;
+
+      jr->seen |= 1UL << jr->field;
+      return true;
+    }
+
+    case JRT_BOOL:
+    {
+      if (is_str)
+        break;
+
+      if (strcmp(jr->value, "true") == 0)
+        *((bool *) member) = true;
+      else if (strcmp(jr->value, "false") == 0)
+        *((bool *) member) = false;
+      else
+        break;
+
+      jr->seen |= 1UL << jr->field;
+      return true;
+    }
+  }
+
+  return json_reader_fail(jr, JRE_SCHEMA, "\"%s\" has to be %s", field->key, json_reader_type_desc(field->type));
+}
+
+/*
+============================================================================
+                                 Strings                                    
+============================================================================
+*/
+
+INLINED static void json_reader_push(json_reader_t *jr, bool in_key, char c)
+{
+  char *buf = in_key ? jr->key : jr->value;
+  size_t *len = in_key ? &(jr->key_len) : &(jr->value_len);
+  size_t cap = in_key ? JSON_READER_KEY_MAXLEN : JSON_READER_VALUE_MAXLEN;
+
+  // Leave room for the terminator, a length of cap marks an overlong string
+  if (*len < cap - 1)
+    buf[(*len)++] = c;
+  else
+    *len = cap;
+}
+
+/**
+ * @brief Append an escaped code point as UTF-8
+ */
+INLINED static void json_reader_push_unicode(json_reader_t *jr, bool in_key, uint16_t cp)
+{
+  if (cp < 0x80)
+    json_reader_push(jr, in_key, cp);
+
+  else if (cp < 0x800)
+  {
+    json_reader_push(jr, in_key, 0xC0 | (cp >> 6));
+    json_reader_push(jr, in_key, 0x80 | (cp & 0x3F));
+  }
+
+  else
+  {
+    json_reader_push(jr, in_key, 0xE0 | (cp >> 12));
+    json_reader_push(jr, in_key, 0x80 | ((cp >> 6) & 0x3F));
+    json_reader_push(jr, in_key, 0x80 | (cp & 0x3F));
+  }
+}
+
+/**
+ * @brief Process a character within a string
+ *
+ * @return true The string has been terminated by this character
+ */
+static bool json_reader_str_char(json_reader_t *jr, bool in_key, char c)
+{
+  // Within an unicode escape sequence
+  if (jr->unicode_left > 0)
+  {
+    int digit;
+    if (c >= '0' && c <= '9')
+      digit = c - '0';
+    else if (c >= 'a' && c <= 'f')
+      digit = c - 'a' + 10;
+    else if (c >= 'A' && c <= 'F')
+      digit = c - 'A' + 10;
+    else
+      return json_reader_fail(jr, JRE_SYNTAX, "Invalid unicode escape sequence");
+
+    jr->unicode = (jr->unicode << 4) | digit;
+    if (--(jr->unicode_left) == 0)
+      json_reader_push_unicode(jr, in_key, jr->unicode);
+
+    return false;
+  }
+
+  if (jr->escaped)
+  {
+    jr->escaped = false;
+
+    switch (c) {
+      case '"':
+      case '\\':
+      case '/':
+        json_reader_push(jr, in_key, c);
+        break;
+
+      case 'b':
+        json_reader_push(jr, in_key, '\b');
+        break;
+
+      case 'f':
+        json_reader_push(jr, in_key, '\f');
+        break;
+
+      case 'n':
+        json_reader_push(jr, in_key, '\n');
+        break;
+
+      case 'r':
+        json_reader_push(jr, in_key, '\r');
+        break;
+
+      case 't':
+        json_reader_push(jr, in_key, '\t');
+        break;
+
+      case 'u':
+        jr->unicode_left = 4;
+        jr->unicode = 0;
+        break;
+
+      default:
+        return json_reader_fail(jr, JRE_SYNTAX, "Invalid escape sequence \\%c", c);
+    }
+
+    return false;
+  }
+
+  if (c == '\\')
+  {
+    jr->escaped = true;
+    return false;
+  }
+
+  if (c == '"')
+    return true;
+
+  if ((uint8_t) c < 0x20)
+    return json_reader_fail(jr, JRE_SYNTAX, "Unescaped control character within a string");
+
+  json_reader_push(jr, in_key, c);
+  return false;
+}
+
+/*
+============================================================================
+                                Tokenizer                                   
+============================================================================
+*/
+
+INLINED static bool json_reader_is_ws(char c)
+{
+  return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+}
+
+static bool json_reader_char(json_reader_t *jr, char c)
+{
+  // Loops whenever a character terminates a token and has to be processed again in the next state
+  while (true)
+  {
+    switch (jr->state) {
+      case JRS_DOC:
+      {
+        if (json_reader_is_ws(c))
+          return true;
+
+        if (!jr->item_fn && c == '{')
+        {
+          json_reader_obj_begin(jr);
+          return true;
+        }
+
+        if (jr->item_fn && c == '[')
+        {
+          jr->state = JRS_ITEM_OR_ARR_END;
+          return true;
+        }
+
+        return json_reader_fail(jr, JRE_SYNTAX, "Expected an %s", jr->item_fn ? "array" : "object");
+      }
+
+      case JRS_ITEM_OR_ARR_END:
+      case JRS_ITEM:
+      {
+        if (json_reader_is_ws(c))
+          return true;
+
+        if (c == '{')
+        {
+          json_reader_obj_begin(jr);
+          return true;
+        }
+
+        if (c == ']' && jr->state == JRS_ITEM_OR_ARR_END)
+        {
+          jr->state = JRS_END;
+          return true;
+        }
+
+        return json_reader_fail(jr, JRE_SYNTAX, "Expected an object as item %u", (unsigned int) jr->items);
+      }
+
+      case JRS_ARR_COMMA_OR_END:
+      {
+        if (json_reader_is_ws(c))
+          return true;
+
+        if (c == ',')
+        {
+          jr->state = JRS_ITEM;
+          return true;
+        }
+
+        if (c == ']')
+        {
+          jr->state = JRS_END;
+          return true;
+        }
+
+        return json_reader_fail(jr, JRE_SYNTAX, "Expected , or ] after item %u", (unsigned int) jr->items - 1);
+      }
+
+      case JRS_KEY_OR_OBJ_END:
+      case JRS_KEY_START:
+      {
+        if (json_reader_is_ws(c))
+          return true;
+
+        if (c == '"')
+        {
+          jr->key_len = 0;
+          jr->state = JRS_KEY;
+          return true;
+        }
+
+        if (c == '}' && jr->state == JRS_KEY_OR_OBJ_END)
+          return json_reader_obj_end(jr);
+
+        return json_reader_fail(jr, JRE_SYNTAX, "Expected a key");
+      }
+
+      case JRS_KEY:
+      {
+        if (json_reader_str_char(jr, true, c))
+        {
+          jr->field = json_reader_find_field(jr);
+          jr->state = JRS_COLON;
+        }
+
+        return jr->state != JRS_FAILED;
+      }
+
+      case JRS_COLON:
+      {
+        if (json_reader_is_ws(c))
+          return true;
+
+        if (c != ':')
+          return json_reader_fail(jr, JRE_SYNTAX, "Expected : after a key");
+
+        jr->state = JRS_VALUE;
+        return true;
+      }
+
+      case JRS_VALUE:
+      {
+        if (json_reader_is_ws(c))
+          return true;
+
+        jr->value_len = 0;
+
+        if (c == '"')
+        {
+          jr->state = JRS_STR;
+          return true;
+        }
+
+        if (c == '{' || c == '[')
+        {
+          // Known fields are always scalars
+          if (jr->field >= 0)
+          {
+            const json_reader_field_t *field = &(jr->schema->fields[jr->field]);
+            return json_reader_fail(jr, JRE_SCHEMA, "\"%s\" has to be %s", field->key, json_reader_type_desc(field->type));
+          }
+
+          jr->skip_depth = 1;
+          jr->skip_in_str = false;
+          jr->skip_escaped = false;
+          jr->state = JRS_SKIP;
+          return true;
+        }
+
+        jr->state = JRS_LITERAL;
+        continue;
+      }
+
+      case JRS_STR:
+      {
+        if (json_reader_str_char(jr, false, c))
+        {
+          if (!json_reader_assign(jr, true))
+            return false;
+
+          jr->state = JRS_OBJ_COMMA_OR_END;
+        }
+
+        return jr->state != JRS_FAILED;
+      }
+
+      case JRS_LITERAL:
+      {
+        if ((c >= 'a' && c <= 'z') || (c >= '0' && c <= '9') || c == '-' || c == '+' || c == '.' || c == 'E')
+        {
+          json_reader_push(jr, false, c);
+          return true;
+        }
+
+        if (jr->value_len == 0)
+          return json_reader_fail(jr, JRE_SYNTAX, "Expected a value");
+
+        if (!json_reader_assign(jr, false))
+          return false;
+
+        // The terminating character belongs to the next token
+        jr->state = JRS_OBJ_COMMA_OR_END;
+        continue;
+      }
+
+      case JRS_SKIP:
+      {
+        if (jr->skip_in_str)
+        {
+          if (jr->skip_escaped)
+            jr->skip_escaped = false;
+          else if (c == '\\')
+            jr->skip_escaped = true;
+          else if (c == '"')
+            jr->skip_in_str = false;
+
+          return true;
+        }
+
+        if (c == '"')
+          jr->skip_in_str = true;
+        else if (c == '{' || c == '[')
+          jr->skip_depth++;
+        else if ((c == '}' || c == ']') && --(jr->skip_depth) == 0)
+          jr->state = JRS_OBJ_COMMA_OR_END;
+
+        return true;
+      }
+
+      case JRS_OBJ_COMMA_OR_END:
+      {
+        if (json_reader_is_ws(c))
+          return true;
+
+        if (c == ',')
+        {
+          jr->state = JRS_KEY_START;
+          return true;
+        }
+
+        if (c == '}')
+          return json_reader_obj_end(jr);
+
+        return json_reader_fail(jr, JRE_SYNTAX, "Expected , or } after a value");
+      }
+
+      case JRS_END:
+      {
+        if (json_reader_is_ws(c))
+          return true;
+
+        return json_reader_fail(jr, JRE_SYNTAX, "Unexpected content after the end of the document");
+      }
+
+      case JRS_FAILED:
+        return false;
+    }
+
+    return false;
+  }
+}
+
+/*
+============================================================================
+                                   CBOR                                     
+============================================================================
+*/
+
+/*
+  CBOR is processed with the same states as JSON, where JRS_ITEM expects
+  the next item of the document's array, JRS_KEY_START the next key, JRS_KEY
+  and JRS_STR are within the payload of a key's or value's text string and
+  JRS_SKIP is within a value of an unknown key. Scalars are rendered into
+  the value buffer like their JSON counterparts, so they're assigned by the
+  very same routine.
+*/
+
+#define JSON_READER_CBOR_UINT       0
+#define JSON_READER_CBOR_NEGINT     1
+#define JSON_READER_CBOR_BYTES      2
+#define JSON_READER_CBOR_TEXT       3
+#define JSON_READER_CBOR_ARRAY      4
+#define JSON_READER_CBOR_MAP        5
+#define JSON_READER_CBOR_TAG        6
+#define JSON_READER_CBOR_SIMPLE     7
+
+#define JSON_READER_CBOR_FALSE      20
+#define JSON_READER_CBOR_TRUE       21
+#define JSON_READER_CBOR_NULL       22
+#define JSON_READER_CBOR_UNDEFINED  23
+
+#define JSON_READER_CBOR_BREAK      0xFF
+
+static bool json_reader_cbor_obj_end(json_reader_t *jr)
+{
+  if (!json_reader_obj_end(jr))
+    return false;
+
+  // Single object document
+  if (jr->state == JRS_END)
+    return true;
+
+  if (jr->cbor_arr_left != JSON_READER_CBOR_INDEFINITE && --(jr->cbor_arr_left) == 0)
+    jr->state = JRS_END;
+  else
+    jr->state = JRS_ITEM;
+
+  return true;
+}
+
+static bool json_reader_cbor_obj_begin(json_reader_t *jr, uint64_t num_keys)
+{
+  json_reader_obj_begin(jr);
+  jr->state = JRS_KEY_START;
+  jr->cbor_obj_left = num_keys;
+
+  if (num_keys == 0)
+    return json_reader_cbor_obj_end(jr);
+
+  return true;
+}
+
+/**
+ * @brief Called after the value of a key has been processed
+ */
+static bool json_reader_cbor_value_end(json_reader_t *jr)
+{
+  jr->state = JRS_KEY_START;
+
+  if (jr->cbor_obj_left != JSON_READER_CBOR_INDEFINITE && --(jr->cbor_obj_left) == 0)
+    return json_reader_cbor_obj_end(jr);
+
+  return true;
+}
+
+/**
+ * @brief Called after an item within a skipped value has been processed completely
+ */
+static bool json_reader_cbor_skip_end(json_reader_t *jr)
+{
+  while (jr->cbor_skip_depth > 0)
+  {
+    uint64_t *left = &(jr->cbor_skip[jr->cbor_skip_depth - 1]);
+
+    // Indefinite containers are closed by a break
+    if (*left == JSON_READER_CBOR_INDEFINITE)
+      return true;
+
+    if (--(*left) > 0)
+      return true;
+
+    // The container is complete, which completes an item of it's parent
+    jr->cbor_skip_depth--;
+  }
+
+  return json_reader_cbor_value_end(jr);
+}
+
+static bool json_reader_cbor_str_end(json_reader_t *jr)
+{
+  switch (jr->state) {
+    case JRS_KEY:
+      jr->field = json_reader_find_field(jr);
+      jr->state = JRS_VALUE;
+      return true;
+
+    case JRS_STR:
+      if (!json_reader_assign(jr, true))
+        return false;
+      return json_reader_cbor_value_end(jr);
+
+    case JRS_SKIP:
+      return json_reader_cbor_skip_end(jr);
+
+    default:
+      return false;
+  }
+}
+
+static bool json_reader_cbor_str_begin(json_reader_t *jr, uint64_t len)
+{
+  if (len == 0)
+    return json_reader_cbor_str_end(jr);
+
+  jr->cbor_str_left = len;
+  return true;
+}
+
+static bool json_reader_cbor_skip_item(json_reader_t *jr, uint8_t major, uint64_t arg, bool indefinite)
+{
+  if (jr->cbor_head == JSON_READER_CBOR_BREAK)
+  {
+    if (jr->cbor_skip_depth == 0 || jr->cbor_skip[jr->cbor_skip_depth - 1] != JSON_READER_CBOR_INDEFINITE)
+      return json_reader_fail(jr, JRE_SYNTAX, "Unexpected break");
+
+    jr->cbor_skip_depth--;
+    return json_reader_cbor_skip_end(jr);
+  }
+
+  uint64_t num_items;
+  switch (major) {
+    case JSON_READER_CBOR_BYTES:
+    case JSON_READER_CBOR_TEXT:
+    {
+      // Indefinite strings consist of definite chunks, closed by a break
+      if (!indefinite)
+        return json_reader_cbor_str_begin(jr, arg);
+
+      num_items = JSON_READER_CBOR_INDEFINITE;
+      break;
+    }
+
+    case JSON_READER_CBOR_ARRAY:
+    case JSON_READER_CBOR_MAP:
+    {
+      if (indefinite)
+        num_items = JSON_READER_CBOR_INDEFINITE;
+      else
+        num_items = major == JSON_READER_CBOR_MAP ? arg * 2 : arg;
+
+      if (num_items == 0)
+        return json_reader_cbor_skip_end(jr);
+
+      break;
+    }
+
+    default:
+      return json_reader_cbor_skip_end(jr);
+  }
+
+  if (jr->cbor_skip_depth >= JSON_READER_CBOR_MAX_DEPTH)
+    return json_reader_fail(jr, JRE_SYNTAX, "Value nested too deeply");
+
+  jr->cbor_skip[jr->cbor_skip_depth++] = num_items;
+  return true;
+}
+
+static bool json_reader_cbor_value(json_reader_t *jr, uint8_t major, uint64_t arg, bool indefinite)
+{
+  jr->value_len = 0;
+
+  switch (major) {
+    case JSON_READER_CBOR_UINT:
+    {
+      jr->value_len = snprintf(jr->value, sizeof(jr->value), "%" PRIu64, arg);
+      return json_reader_assign(jr, false) && json_reader_cbor_value_end(jr);
+    }
+
+    case JSON_READER_CBOR_NEGINT:
+    {
+      jr->value_len = snprintf(jr->value, sizeof(jr->value), "-%" PRIu64, arg + 1);
+      return json_reader_assign(jr, false) && json_reader_cbor_value_end(jr);
+    }
+
+    case JSON_READER_CBOR_TEXT:
+    {
+      if (indefinite)
+        break;
+
+      jr->state = JRS_STR;
+      return json_reader_cbor_str_begin(jr, arg);
+    }
+
+    case JSON_READER_CBOR_SIMPLE:
+    {
+      if (jr->cbor_head == JSON_READER_CBOR_BREAK)
+        return json_reader_fail(jr, JRE_SYNTAX, "Expected a value");
+
+      // Floats and other simple values don't match any type, but are fine for unknown keys
+      const char *literal = "float";
+      if (arg == JSON_READER_CBOR_FALSE)
+        literal = "false";
+      else if (arg == JSON_READER_CBOR_TRUE)
+        literal = "true";
+      else if (arg == JSON_READER_CBOR_NULL || arg == JSON_READER_CBOR_UNDEFINED)
+        literal = "null";
+
+      jr->value_len = strlen(literal);
+      memcpy(jr->value, literal, jr->value_len);
+      return json_reader_assign(jr, false) && json_reader_cbor_value_end(jr);
+    }
+
+    default:
+      break;
+  }
+
+  // Known fields are always scalars
+  if (jr->field >= 0)
+  {
+    const json_reader_field_t *field = &(jr->schema->fields[jr->field]);
+    return json_reader_fail(jr, JRE_SCHEMA, "\"%s\" has to be %s", field->key, json_reader_type_desc(field->type));
+  }
+
+  jr->cbor_skip_depth = 0;
+  jr->state = JRS_SKIP;
+  return json_reader_cbor_skip_item(jr, major, arg, indefinite);
+}
+
+/**
+ * @brief Process an item whose head has been read completely
+ */
+static bool json_reader_cbor_item(json_reader_t *jr)
+{
+  uint8_t major = jr->cbor_head >> 5;
+  uint64_t arg = jr->cbor_arg;
+  bool indefinite = (jr->cbor_head & 0x1F) == 31;
+  bool is_break = jr->cbor_head == JSON_READER_CBOR_BREAK;
+
+  // Tags only annotate the following item
+  if (major == JSON_READER_CBOR_TAG)
+    return true;
+
+  switch (jr->state) {
+    case JRS_DOC:
+    {
+      if (!jr->item_fn && major == JSON_READER_CBOR_MAP)
+        return json_reader_cbor_obj_begin(jr, arg);
+
+      if (jr->item_fn && major == JSON_READER_CBOR_ARRAY)
+      {
+        jr->cbor_arr_left = arg;
+        jr->state = arg == 0 ? JRS_END : JRS_ITEM;
+        return true;
+      }
+
+      return json_reader_fail(jr, JRE_SYNTAX, "Expected an %s", jr->item_fn ? "array" : "object");
+    }
+
+    case JRS_ITEM:
+    {
+      if (is_break && jr->cbor_arr_left == JSON_READER_CBOR_INDEFINITE)
+      {
+        jr->state = JRS_END;
+        return true;
+      }
+
+      if (major == JSON_READER_CBOR_MAP)
+        return json_reader_cbor_obj_begin(jr, arg);
+
+      return json_reader_fail(jr, JRE_SYNTAX, "Expected an object as item %u", (unsigned int) jr->items);
+    }
+
+    case JRS_KEY_START:
+    {
+      if (is_break && jr->cbor_obj_left == JSON_READER_CBOR_INDEFINITE)
+        return json_reader_cbor_obj_end(jr);
+
+      if (major != JSON_READER_CBOR_TEXT || indefinite)
+        return json_reader_fail(jr, JRE_SYNTAX, "Expected a key");
+
+      jr->key_len = 0;
+      jr->state = JRS_KEY;
+      return json_reader_cbor_str_begin(jr, arg);
+    }
+
+    case JRS_VALUE:
+      return json_reader_cbor_value(jr, major, arg, indefinite);
+
+    case JRS_SKIP:
+      return json_reader_cbor_skip_item(jr, major, arg, indefinite);
+
+    default:
+      return false;
+  }
+}
+
+static bool json_reader_cbor_byte(json_reader_t *jr, uint8_t c)
+{
+  if (jr->state == JRS_FAILED)
+    return false;
+
+  if (jr->state == JRS_END)
+    return json_reader_fail(jr, JRE_SYNTAX, "Unexpected content after the end of the document");
+
+  // Within the payload of a string
+  if (jr->cbor_str_left > 0)
+  {
+    // Skipped strings are only counted
+    if (jr->state != JRS_SKIP)
+      json_reader_push(jr, jr->state == JRS_KEY, (char) c);
+
+    if (--(jr->cbor_str_left) == 0)
+      return json_reader_cbor_str_end(jr);
+
+    return true;
+  }
+
+  // Within the argument of an item's head, which is big endian
+  if (jr->cbor_arg_left > 0)
+  {
+    jr->cbor_arg = (jr->cbor_arg << 8) | c;
+
+    if (--(jr->cbor_arg_left) == 0)
+      return json_reader_cbor_item(jr);
+
+    return true;
+  }
+
+  jr->cbor_head = c;
+  uint8_t info = c & 0x1F;
+
+  // The argument is within the head itself
+  if (info < 24)
+  {
+    jr->cbor_arg = info;
+    return json_reader_cbor_item(jr);
+  }
+
+  // The argument follows in 1, 2, 4 or 8 bytes
+  if (info <= 27)
+  {
+    jr->cbor_arg = 0;
+    jr->cbor_arg_left = 1 << (info - 24);
+    return true;
+  }
+
+  // Indefinite length or break, only valid for strings, containers and simple values
+  uint8_t major = c >> 5;
+  if (info == 31 && major >= JSON_READER_CBOR_BYTES && major != JSON_READER_CBOR_TAG)
+  {
+    jr->cbor_arg = JSON_READER_CBOR_INDEFINITE;
+    return json_reader_cbor_item(jr);
+  }
+
+  return json_reader_fail(jr, JRE_SYNTAX, "Invalid CBOR item 0x%02x", c);
+}
+
+/*
+============================================================================
+                                 Driving                                    
+============================================================================
+*/
+
+void json_reader_init(
+  json_reader_t *jr,
+  const json_reader_schema_t *schema,
+  void *out,
+  json_reader_item_t item_fn,
+  void *item_arg,
+  bool cbor
+)
+{
+  memset(jr, 0, sizeof(json_reader_t));
+  jr->schema = schema;
+  jr->out = out;
+  jr->item_fn = item_fn;
+  jr->item_arg = item_arg;
+  jr->cbor = cbor;
+  jr->state = JRS_DOC;
+  jr->field = -1;
+  jr->error = JRE_NONE;
+}
+
+bool json_reader_feed(json_reader_t *jr, const uint8_t *data, size_t len)
+{
+  for (size_t i = 0; i < len; i++)
+  {
+    bool ok = jr->cbor
+      ? json_reader_cbor_byte(jr, data[i])
+      : json_reader_char(jr, (char) data[i]);
+
+    if (!ok)
+      return false;
+  }
+
+  return true;
+}
+
+bool json_reader_finish(json_reader_t *jr)
+{
+  if (jr->state == JRS_FAILED)
+    return false;
+
+  // A trailing literal is only terminated by the end of the document, which is invalid for objects anyways
+  if (jr->state != JRS_END)
+    return json_reader_fail(jr, JRE_SYNTAX, "Unexpected end of the document");
+
+  return true;
+}
\ No newline at end of file
@@ -0,0 +1,429 @@
+#include "json_writer.h"
+
+/*
+============================================================================
+                                Raw output
+============================================================================
+*/
+
+INLINED static void json_writer_raw(json_writer_t *jw, const char *data, size_t len)
+{
+  // Aborted, the remainder of the document is dropped
+  if (jw->failed)
+    return;
+
+  jw->total += len;
+
+  // Only measuring
+  if (!jw->buf)
+    return;
+
+  // Write as much as possible into the current window
+  size_t room = jw->buf_len - jw->buf_offs;
+  size_t direct = len < room ? len : room;
+  memcpy(&(jw->buf[jw->buf_offs]), data, direct);
+  jw->buf_offs += direct;
+
+  if (direct == len)
+    return;
+
+  // Spill the remainder into the overflow buffer
+  size_t spill = len - direct;
+  size_t spill_room = JSON_WRITER_OVERFLOW_LEN - jw->overflow_len;
+  if (spill > spill_room)
+  {
+    if (!jw->truncated)
+      dbgerr("A json writer step exceeded the overflow buffer, output truncated!");
+
+    jw->truncated = true;
+    spill = spill_room;
+  }
+
+  memcpy(&(jw->overflow[jw->overflow_len]), &data[direct], spill);
+  jw->overflow_len += spill;
+}
+
+INLINED static void json_writer_char(json_writer_t *jw, char c)
+{
+  json_writer_raw(jw, &c, 1);
+}
+
+INLINED static void json_writer_newline(json_writer_t *jw)
+{
+  if (jw->format != JWF_PRETTY)
+    return;
+
+  json_writer_char(jw, '\n');
+  for (size_t i = 0; i < jw->depth * JSON_WRITER_INDENT; i++)
+    json_writer_char(jw, ' ');
+}
+
+/**
+ * @brief Called before every value, takes care of separators and indentation
+ */
+INLINED static void json_writer_prefix(json_writer_t *jw)
+{
+  // CBOR items are self-delimiting
+  if (jw->format == JWF_CBOR)
+    return;
+
+  // Values directly follow their keys
+  if (jw->after_key)
+  {
+    jw->after_key = false;
+    return;
+  }
+
+  // Top level value
+  if (jw->depth == 0)
+    return;
+
+  uint32_t level_bit = 1UL << (jw->depth - 1);
+
+  // Separate from the previous item
+  if (jw->has_items & level_bit)
+    json_writer_char(jw, ',');
+
+  jw->has_items |= level_bit;
+  json_writer_newline(jw);
+}
+
+INLINED static void json_writer_escaped(json_writer_t *jw, const char *str, size_t maxlen)
+{
+  json_writer_char(jw, '"');
+
+  for (size_t i = 0; i < maxlen && str[i]; i++)
+  {
+    char c = str[i];
+
+    if (c == '"' || c == '\\')
+    {
+      char esc[2] = { '\\', c };
+      json_writer_raw(jw, esc, 2);
+      continue;
+    }
+
+    // Control characters need to be escaped as unicode sequences
+    if ((uint8_t) c < 0x20)
+    {
+      char esc[7];
+      snprintf(esc, sizeof(esc), "\\u%04x", (uint8_t) c);
+      json_writer_raw(jw, esc, 6);
+      continue;
+    }
+
+    json_writer_char(jw, c);
+  }
+
+  json_writer_char(jw, '"');
+}
+
+/*
+============================================================================
+                                   CBOR
+============================================================================
+*/
+
+#define JSON_WRITER_CBOR_UINT       0
+#define JSON_WRITER_CBOR_NEGINT     1
+#define JSON_WRITER_CBOR_TEXT       3
+#define JSON_WRITER_CBOR_ARRAY      4
+#define JSON_WRITER_CBOR_MAP        5
+
+#define JSON_WRITER_CBOR_FALSE      0xF4
+#define JSON_WRITER_CBOR_TRUE       0xF5
+#define JSON_WRITER_CBOR_BREAK      0xFF
+
+// Additional information of an indefinite length container
+#define JSON_WRITER_CBOR_INDEFINITE 31
+
+/**
+ * @brief Write the head of an item, which is it's major type and argument in the shortest form
+ */
+INLINED static void json_writer_cbor_head(json_writer_t *jw, uint8_t major, uint64_t arg)
+{
+  uint8_t head[9];
+  size_t arg_len;
+
+  if (arg < 24)
+  {
+    head[0] = (major << 5) | arg;
+    json_writer_raw(jw, (const char *) head, 1);
+    return;
+  }
+
+  if (arg <= UINT8_MAX)
+  {
+    head[0] = (major << 5) | 24;
+    arg_len = 1;
+  }
+
+  else if (arg <= UINT16_MAX)
+  {
+    head[0] = (major << 5) | 25;
+    arg_len = 2;
+  }
+
+  else if (arg <= UINT32_MAX)
+  {
+    head[0] = (major << 5) | 26;
+    arg_len = 4;
+  }
+
+  else
+  {
+    head[0] = (major << 5) | 27;
+    arg_len = 8;
+  }
+
+  // Arguments are big endian
+  for (size_t i = 0; i < arg_len; i++)
+    head[1 + i] = (uint8_t) (arg >> (8 * (arg_len - 1 - i)));
+
+  json_writer_raw(jw, (const char *) head, 1 + arg_len);
+}
+
+INLINED static void json_writer_cbor_text(json_writer_t *jw, const char *str, size_t maxlen)
+{
+  size_t len = strnlen(str, maxlen);
+  json_writer_cbor_head(jw, JSON_WRITER_CBOR_TEXT, len);
+  json_writer_raw(jw, str, len);
+}
+
+/*
+============================================================================
+                                 Driving
+============================================================================
+*/
+
+void json_writer_init(json_writer_t *jw, json_writer_step_t step_fn, void *step_arg, json_writer_format_t format)
+{
+  memset(jw, 0, sizeof(json_writer_t));
+  jw->step_fn = step_fn;
+  jw->step_arg = step_arg;
+  jw->format = format;
+}
+
+size_t json_writer_fill(json_writer_t *jw, uint8_t *buf, size_t len)
+{
+  jw->buf = buf;
+  jw->buf_len = len;
+  jw->buf_offs = 0;
+
+  // Flush what's left over from the last window first
+  if (jw->overflow_offs < jw->overflow_len)
+  {
+    size_t pending = jw->overflow_len - jw->overflow_offs;
+    size_t flushed = pending < len ? pending : len;
+    memcpy(buf, &(jw->overflow[jw->overflow_offs]), flushed);
+    jw->overflow_offs += flushed;
+    jw->buf_offs = flushed;
+
+    // Window already exhausted
+    if (jw->overflow_offs < jw->overflow_len)
+      return jw->buf_offs;
+  }
+
+  // Overflow has been flushed completely
+  jw->overflow_len = 0;
+  jw->overflow_offs = 0;
+
+  // Invoke steps while there's room left in the window
+  while (!jw->done && jw->buf_offs < jw->buf_len)
+    jw->done = !jw->step_fn(jw, jw->step++, jw->step_arg) || jw->failed;
+
+  return jw->buf_offs;
+}
+
+size_t json_writer_measure(json_writer_step_t step_fn, void *step_arg, json_writer_format_t format)
+{
+  json_writer_t jw;
+  json_writer_init(&jw, step_fn, step_arg, format);
+
+  // Invoke all steps without any output window
+  while (!jw.done)
+    jw.done = !jw.step_fn(&jw, jw.step++, jw.step_arg) || jw.failed;
+
+  return jw.total;
+}
+
+/*
+============================================================================
+                                 Emitting
+============================================================================
+*/
+
+INLINED static void json_writer_open(json_writer_t *jw, char c)
+{
+  // Checked before emitting anything, as a container that can't be tracked couldn't be closed properly
+  if (jw->depth >= JSON_WRITER_MAX_DEPTH)
+  {
+    dbgerr("Exceeded the maximum json writer depth, document aborted!");
+    jw->failed = true;
+    return;
+  }
+
+  json_writer_prefix(jw);
+
+  if (jw->format == JWF_CBOR)
+  {
+    uint8_t major = c == '{' ? JSON_WRITER_CBOR_MAP : JSON_WRITER_CBOR_ARRAY;
+    json_writer_char(jw, (char) ((major << 5) | JSON_WRITER_CBOR_INDEFINITE));
+  }
+  else
+    json_writer_char(jw, c);
+
+  jw->depth++;
+  jw->has_items &= ~(1UL << (jw->depth - 1));
+}
+
+INLINED static void json_writer_close(json_writer_t *jw, char c)
+{
+  if (jw->depth == 0)
+    return;
+
+  bool had_items = jw->has_items & (1UL << (jw->depth - 1));
+  jw->depth--;
+
+  if (jw->format == JWF_CBOR)
+  {
+    json_writer_char(jw, (char) JSON_WRITER_CBOR_BREAK);
+    return;
+  }
+
+  // Only break lines for non-empty containers
+  if (had_items)
+    json_writer_newline(jw);
+
+  json_writer_char(jw, c);
+}
+
+void json_writer_obj_begin(json_writer_t *jw)
+{
+  json_writer_open(jw, '{');
+}
+
+void json_writer_obj_end(json_writer_t *jw)
+{
+  json_writer_close(jw, '}');
+}
+
+void json_writer_arr_begin(json_writer_t *jw)
+{
+  json_writer_open(jw, '[');
+}
+
+void json_writer_arr_end(json_writer_t *jw)
+{
+  json_writer_close(jw, ']');
+}
+
+void json_writer_key(json_writer_t *jw, const char *key)
+{
+  if (jw->format == JWF_CBOR)
+  {
+    json_writer_cbor_text(jw, key, strlen(key));
+    return;
+  }
+
+  json_writer_prefix(jw);
+  json_writer_escaped(jw, key, strlen(key));
+
+  if (jw->format == JWF_PRETTY)
+    json_writer_raw(jw, ": ", 2);
+  else
+    json_writer_char(jw, ':');
+
+  jw->after_key = true;
+}
+
+void json_writer_str_n(json_writer_t *jw, const char *value, size_t maxlen)
+{
+  if (jw->format == JWF_CBOR)
+  {
+    json_writer_cbor_text(jw, value, maxlen);
+    return;
+  }
+
+  json_writer_prefix(jw);
+  json_writer_escaped(jw, value, maxlen);
+}
+
+void json_writer_str(json_writer_t *jw, const char *value)
+{
+  json_writer_str_n(jw, value, strlen(value));
+}
+
+void json_writer_int(json_writer_t *jw, long value)
+{
+  // Negative integers are encoded as -1 - n
+  if (jw->format == JWF_CBOR)
+  {
+    if (value < 0)
+      json_writer_cbor_head(jw, JSON_WRITER_CBOR_NEGINT, (uint64_t) (-1 - value));
+    else
+      json_writer_cbor_head(jw, JSON_WRITER_CBOR_UINT, (uint64_t) value);
+    return;
+  }
+
+  char num[24];
+  int num_len = snprintf(num, sizeof(num), "%ld", value);
+
+  json_writer_prefix(jw);
+  json_writer_raw(jw, num, num_len);
+}
+
+void json_writer_uint(json_writer_t *jw, unsigned long value)
+{
+  if (jw->format == JWF_CBOR)
+  {
+    json_writer_cbor_head(jw, JSON_WRITER_CBOR_UINT, value);
+    return;
+  }
+
+  char num[24];
+  int num_len = snprintf(num, sizeof(num), "%lu", value);
+
+  json_writer_prefix(jw);
+  json_writer_raw(jw, num, num_len);
+}
+
+void json_writer_bool(json_writer_t *jw, bool value)
+{
+  if (jw->format == JWF_CBOR)
+  {
+    json_writer_char(jw, (char) (value ? JSON_WRITER_CBOR_TRUE : JSON_WRITER_CBOR_FALSE));
+    return;
+  }
+
+  json_writer_prefix(jw);
+
+  if (value)
+    json_writer_raw(jw, "true", 4);
+  else
+    json_writer_raw(jw, "false", 5);
+}
+
+void json_writer_kv_str(json_writer_t *jw, const char *key, const char *value)
+{
+  json_writer_key(jw, key);
+  json_writer_str(jw, value);
+}
+
+void json_writer_kv_int(json_writer_t *jw, const char *key, long value)
+{
+  json_writer_key(jw, key);
+  json_writer_int(jw, value);
+}
+
+void json_writer_kv_uint(json_writer_t *jw, const char *key, unsigned long value)
+{
+  json_writer_key(jw, key);
+  json_writer_uint(jw, value);
+}
+
+void json_writer_kv_bool(json_writer_t *jw, const char *key, bool value)
+{
+  json_writer_key(jw, key);
+  json_writer_bool(jw, value);
+}
\ No newline at end of file
@@ -10,6 +10,7 @@
 #include "valve_control.h"
 #include "status_led.h"
 #include "sd_handler.h"
+#include "sd_reader.h"
 
 scheduler_t scheduler;
 valve_control_t valvectl;
@@ -56,6 +57,7 @@ void setup()
   dbginf("Initialized status-led!");
 
   sdh_init();
+  sd_reader_init();
 
   // Nothing will work without an active WIFi connection
   // Block until connection succeeds
@@ -113,5 +115,6 @@ void loop()
   web_server_socket_fs_cleanup();
 
   scheduler_tick(&scheduler, &valvectl);
+  web_server_socket_events_publish();
   status_led_set(STATLED_CONNECTED);
 }
\ No newline at end of file
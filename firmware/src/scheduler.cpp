@@ -10,117 +10,154 @@ scheduler_t scheduler_make(scheduler_callback_t callback, scheduler_day_and_time
     .callback = callback,                             // Set the user-provided callback
     .dt_provider = dt_provider,                       // Set the user-provided provider
     .last_tick_time = SCHEDULER_TIME_MIDNIGHT,        // Start out with an arbitrary last tick time
-    .last_tick_day = WEEKDAY_SU                       // Start out with an arbitrary last tick day
+    .last_tick_day = WEEKDAY_SU,                      // Start out with an arbitrary last tick day
+    .generation = 0,                                  // Start out at the initial generation
+    .lock = xSemaphoreCreateMutex()
   };
 }
 
+void scheduler_bump_generation(scheduler_t *scheduler)
+{
+  scheduler->generation++;
+}
+
+void scheduler_lock(scheduler_t *scheduler)
+{
+  xSemaphoreTake(scheduler->lock, portMAX_DELAY);
+}
+
+void scheduler_unlock(scheduler_t *scheduler)
+{
+  xSemaphoreGive(scheduler->lock);
+}
+
 /**
- * @brief Parse an interval's time-property from json by a specific key
- * 
- * @param json JSONH json node
- * @param key Key to fetch from
- * @param err Error output buffer
- * @param out Value output buffer
- * 
- * @return true Parsing success
- * @return false Parsing error, see err
+ * @brief Validate a read interval, the end has to be after the start
  */
-INLINED static bool scheduler_interval_parse_time(
-  htable_t *json,
-  const char *key,
-  char **err,
-  scheduler_time_t *out
-)
+static bool scheduler_interval_validate(void *out, uint32_t seen, char **err)
 {
-  // Get value
-  jsonh_opres_t jopr;
-  char *start_s = NULL;
-  if ((jopr = jsonh_get_str(json, key, &start_s)) != JOPRES_SUCCESS)
+  scheduler_interval_t *interval = (scheduler_interval_t *) out;
+
+  if (scheduler_time_compare(interval->end, interval->start) != 1)
   {
-    *err = jsonh_getter_errstr(key, jopr);
+    *err = strfmt_direct("\"end\" has to be greater than \"start\"");
     return false;
   }
 
-  // Parse value
-  scheduler_time_t res;
-  if (!scheduler_time_parse(start_s, err, &res))
-    return false;
-
-  *out = res;
   return true;
 }
 
-bool scheduler_day_parse(htable_t *json, char **err, scheduler_day_t *out)
+static const json_reader_field_t scheduler_interval_fields[] = {
+  JSON_READER_FIELD("start", JRT_STR, scheduler_interval_t, start, scheduler_time_json_convert, true),
+  JSON_READER_FIELD("end", JRT_STR, scheduler_interval_t, end, scheduler_time_json_convert, true),
+  JSON_READER_FIELD("identifier", JRT_UINT, scheduler_interval_t, identifier, NULL, true),
+  JSON_READER_FIELD("disabled", JRT_BOOL, scheduler_interval_t, disabled, NULL, true),
+};
+
+const json_reader_schema_t scheduler_interval_schema = {
+  scheduler_interval_fields,
+  sizeof(scheduler_interval_fields) / sizeof(json_reader_field_t),
+  sizeof(scheduler_interval_t),
+  scheduler_interval_validate
+};
+
+static const json_reader_field_t scheduler_day_fields[] = {
+  JSON_READER_FIELD("disabled", JRT_BOOL, scheduler_day_t, disabled, NULL, true),
+};
+
+const json_reader_schema_t scheduler_day_schema = {
+  scheduler_day_fields,
+  sizeof(scheduler_day_fields) / sizeof(json_reader_field_t),
+  sizeof(scheduler_day_t),
+  NULL
+};
+
+bool scheduler_weekday_json_convert(const char *str, char **err, void *out)
 {
-  // Get disabled state
-  bool disabled;
-  jsonh_opres_t jopr;
-  if ((jopr = jsonh_get_bool(json, "disabled", &disabled)) != JOPRES_SUCCESS)
+  if (scheduler_weekday_value(str, (scheduler_weekday_t *) out) != ENUMLUT_SUCCESS)
   {
-    *err = jsonh_getter_errstr("disabled", jopr);
+    *err = strfmt_direct("Invalid weekday " QUOTSTR, str);
     return false;
   }
 
-  out->disabled = disabled;
   return true;
 }
 
-bool scheduler_interval_parse(htable_t *json, char **err, scheduler_interval_t *out)
+void scheduler_interval_json_write(json_writer_t *jw, int index, scheduler_interval_t *interval)
 {
-  // Parse start
-  scheduler_time_t start;
-  if (!scheduler_interval_parse_time(json, "start", err, &start))
-    return false;
+  char start_str[SCHEDULER_TIME_STRLEN], end_str[SCHEDULER_TIME_STRLEN];
+  scheduler_time_stringify_buf(&(interval->start), start_str);
+  scheduler_time_stringify_buf(&(interval->end), end_str);
+
+  json_writer_obj_begin(jw);
+  json_writer_kv_str(jw, "start", start_str);
+  json_writer_kv_str(jw, "end", end_str);
+  json_writer_kv_int(jw, "identifier", interval->identifier);
+  json_writer_kv_int(jw, "index", index);
+  json_writer_kv_bool(jw, "active", interval->active);
+  json_writer_kv_bool(jw, "disabled", interval->disabled);
+  json_writer_obj_end(jw);
+}
 
-  // Parse end
-  scheduler_time_t end;
-  if (!scheduler_interval_parse_time(json, "end", err, &end))
-    return false;
+bool scheduler_indexed_interval_json_step(json_writer_t *jw, size_t step, void *indexed)
+{
+  scheduler_indexed_interval_t *targ = (scheduler_indexed_interval_t *) indexed;
+  scheduler_interval_json_write(jw, targ->index, &(targ->interval));
+  return false;
+}
 
-  // Make sure that the end is greater than the start
-  if (scheduler_time_compare(end, start) != 1)
-  {
-    *err = strfmt_direct("\"end\" has to be greater than \"start\"");
-    return false;
-  }
+/**
+ * @brief Get the occupancy bits of all slots starting at a given index
+ */
+INLINED static uint32_t scheduler_day_occupied_from(scheduler_day_t *day, size_t index)
+{
+  if (index >= 32)
+    return 0;
+
+  return day->occupied & (UINT32_MAX << index);
+}
+
+bool scheduler_day_json_step(json_writer_t *jw, size_t step, void *day)
+{
+  scheduler_day_t *targ_day = (scheduler_day_t *) day;
 
-  // Get identifier
-  int identifier;
-  jsonh_opres_t jopr;
-  if ((jopr = jsonh_get_int(json, "identifier", &identifier)) != JOPRES_SUCCESS)
+  // Header
+  if (step == 0)
   {
-    *err = jsonh_getter_errstr("identifier", jopr);
-    return false;
+    json_writer_obj_begin(jw);
+    json_writer_kv_bool(jw, "disabled", targ_day->disabled);
+    json_writer_kv_uint(jw, "slots", SCHEDULER_MAX_INTERVALS_PER_DAY);
+    json_writer_key(jw, "intervals");
+    json_writer_arr_begin(jw);
+    return true;
   }
 
-  // Get disabled state
-  bool disabled;
-  if ((jopr = jsonh_get_bool(json, "disabled", &disabled)) != JOPRES_SUCCESS)
+  // One occupied interval per step, the cursor points past the last written slot
+  uint32_t remaining = scheduler_day_occupied_from(targ_day, jw->cursor);
+  if (remaining)
   {
-    *err = jsonh_getter_errstr("disabled", jopr);
-    return false;
+    size_t index = __builtin_ctz(remaining);
+    jw->cursor = index + 1;
+
+    scheduler_interval_json_write(jw, index, &(targ_day->intervals[index]));
+    return true;
   }
 
-  // Build result
-  *out = scheduler_interval_make(start, end, identifier, disabled);
-  return true;
+  // Footer
+  json_writer_arr_end(jw);
+  json_writer_obj_end(jw);
+  return false;
 }
 
-htable_t *scheduler_interval_jsonify(int index, scheduler_interval_t *interval)
+void scheduler_day_update_occupancy(scheduler_day_t *day, size_t index)
 {
-  scptr char *start_str = scheduler_time_stringify(&(interval->start));
-  scptr char *end_str = scheduler_time_stringify(&(interval->end));
-
-  scptr htable_t *int_jsn = htable_make(6, mman_dealloc_nr);
-
-  jsonh_set_str(int_jsn, "start", (char *) mman_ref(start_str));
-  jsonh_set_str(int_jsn, "end", (char *) mman_ref(end_str));
-  jsonh_set_int(int_jsn, "identifier", interval->identifier);
-  jsonh_set_int(int_jsn, "index", index);
-  jsonh_set_bool(int_jsn, "active", interval->active);
-  jsonh_set_bool(int_jsn, "disabled", interval->disabled);
+  if (index >= SCHEDULER_MAX_INTERVALS_PER_DAY)
+    return;
 
-  return (htable_t *) mman_ref(int_jsn);
+  if (scheduler_interval_empty(day->intervals[index]))
+    day->occupied &= ~(1UL << index);
+  else
+    day->occupied |= 1UL << index;
 }
 
 /**
@@ -161,13 +198,27 @@ scheduler_interval_t scheduler_interval_make(scheduler_time_t start, scheduler_t
 
 static int scheduler_find_interval_slot(scheduler_t *scheduler, scheduler_weekday_t day, scheduler_interval_t interval)
 {
-  // Loop all interval slots for the target day
-  for (size_t i = 0; i < SCHEDULER_MAX_INTERVALS_PER_DAY; i++)
+  scheduler_day_t *targ_day = &(scheduler->daily_schedules[day]);
+
+  // Looking for an empty slot, take the lowest free bit
+  if (scheduler_interval_equals(interval, SCHEDULER_INTERVAL_EMPTY))
   {
-    scheduler_interval_t slot = scheduler->daily_schedules[day].intervals[i];
+    for (size_t i = 0; i < SCHEDULER_MAX_INTERVALS_PER_DAY; i++)
+    {
+      if (!(targ_day->occupied & (1UL << i)))
+        return i;
+    }
+
+    return -1;
+  }
+
+  // Only occupied slots can match a non-empty interval
+  for (uint32_t occ = targ_day->occupied; occ; occ &= occ - 1)
+  {
+    int i = __builtin_ctz(occ);
 
     // Not the target interval
-    if (!scheduler_interval_equals(slot, interval)) continue;
+    if (!scheduler_interval_equals(targ_day->intervals[i], interval)) continue;
 
     return i;
   }
@@ -176,26 +227,6 @@ static int scheduler_find_interval_slot(scheduler_t *scheduler, scheduler_weekda
   return -1;
 }
 
-htable_t *scheduler_weekday_jsonify(scheduler_t *scheduler, scheduler_weekday_t day)
-{
-  scptr htable_t *weekday = htable_make(2, mman_dealloc_nr);
-  scptr dynarr_t *weekday_intervals = dynarr_make_mmf(SCHEDULER_MAX_INTERVALS_PER_DAY);
-
-  if (jsonh_set_arr(weekday, "intervals", (dynarr_t *) mman_ref(weekday_intervals)) != JOPRES_SUCCESS)
-    mman_dealloc(weekday_intervals);
-
-  scheduler_day_t targ_day = scheduler->daily_schedules[day];
-  for (int j = 0; j < SCHEDULER_MAX_INTERVALS_PER_DAY; j++)
-  {
-    scptr htable_t *int_jsn = scheduler_interval_jsonify(j, &(targ_day.intervals[j]));
-    if (jsonh_insert_arr_obj(weekday_intervals, (htable_t *) mman_ref(int_jsn)) != JOPRES_SUCCESS)
-      mman_dealloc(int_jsn);
-  }
-
-  jsonh_set_bool(weekday, "disabled", targ_day.disabled);
-  return (htable_t *) mman_ref(weekday);
-}
-
 bool scheduler_register_interval(scheduler_t *scheduler, scheduler_weekday_t day, scheduler_interval_t interval)
 {
   // Find an empty slot
@@ -206,6 +237,8 @@ bool scheduler_register_interval(scheduler_t *scheduler, scheduler_weekday_t day
 
   // Set the slot
   scheduler->daily_schedules[day].intervals[slot] = interval;
+  scheduler_day_update_occupancy(&(scheduler->daily_schedules[day]), slot);
+  scheduler_bump_generation(scheduler);
   return true;
 }
 
@@ -218,6 +251,8 @@ bool scheduler_unregister_interval(scheduler_t *scheduler, scheduler_weekday_t d
 
   // Unregister by setting the slot to an empty value
   scheduler->daily_schedules[day].intervals[slot] = SCHEDULER_INTERVAL_EMPTY;
+  scheduler_day_update_occupancy(&(scheduler->daily_schedules[day]), slot);
+  scheduler_bump_generation(scheduler);
   return true;
 }
 
@@ -230,23 +265,92 @@ bool scheduler_change_interval(scheduler_t *scheduler, scheduler_weekday_t day,
 
   // Change the interval value
   scheduler->daily_schedules[day].intervals[slot] = to;
+  scheduler_day_update_occupancy(&(scheduler->daily_schedules[day]), slot);
+  scheduler_bump_generation(scheduler);
+  return true;
+}
+
+void scheduler_interval_patch(scheduler_t *scheduler, scheduler_weekday_t day, size_t index, const scheduler_interval_t *interval)
+{
+  scheduler_interval_t *targ_interval = &(scheduler->daily_schedules[day].intervals[index]);
+
+  // Check for deltas and patch disabled
+  if (targ_interval->disabled != interval->disabled)
+  {
+    targ_interval->disabled = interval->disabled;
+
+    web_server_socket_events_broadcast_interval(interval->disabled ? WSE_INTERVAL_DISABLE_ON : WSE_INTERVAL_DISABLE_OFF, day, index);
+  }
+
+  // Check for deltas and patch end
+  if (scheduler_time_compare(targ_interval->end, interval->end) != 0)
+  {
+    targ_interval->end = interval->end;
+
+    web_server_socket_events_broadcast_interval_time(WSE_INTERVAL_END_CHANGE, day, index, interval->end);
+  }
+
+  // Check for deltas and patch start
+  if (scheduler_time_compare(targ_interval->start, interval->start) != 0)
+  {
+    targ_interval->start = interval->start;
+
+    web_server_socket_events_broadcast_interval_time(WSE_INTERVAL_START_CHANGE, day, index, interval->start);
+  }
+
+  // Check for deltas and patch identifier
+  if (targ_interval->identifier != interval->identifier)
+  {
+    targ_interval->identifier = interval->identifier;
+    web_server_socket_events_broadcast_interval_identifier(day, index, interval->identifier);
+  }
+
+  scheduler_day_update_occupancy(&(scheduler->daily_schedules[day]), index);
+  scheduler_bump_generation(scheduler);
+}
+
+bool scheduler_interval_clear(scheduler_t *scheduler, scheduler_weekday_t day, size_t index)
+{
+  scheduler_interval_t *targ = &(scheduler->daily_schedules[day].intervals[index]);
+
+  // Already an empty slot
+  if (scheduler_interval_empty(*targ))
+    return false;
+
+  *targ = SCHEDULER_INTERVAL_EMPTY;
+  scheduler_day_update_occupancy(&(scheduler->daily_schedules[day]), index);
+  scheduler_bump_generation(scheduler);
+
+  web_server_socket_events_broadcast_interval(WSE_INTERVAL_DELETED, day, index);
   return true;
 }
 
+void scheduler_day_patch(scheduler_t *scheduler, scheduler_weekday_t day, const scheduler_day_t *patch)
+{
+  scheduler_day_t *targ_day = &(scheduler->daily_schedules[day]);
+
+  // Check for deltas and disabled state
+  if (targ_day->disabled != patch->disabled)
+  {
+    targ_day->disabled = patch->disabled;
+    scheduler_bump_generation(scheduler);
+
+    web_server_socket_events_broadcast_day(patch->disabled ? WSE_DAY_DISABLE_ON : WSE_DAY_DISABLE_OFF, day);
+  }
+}
+
 /**
  * @brief Tick all intervals of the current day
  */
 INLINED static void scheduler_tick_intervals(scheduler_t *scheduler, scheduler_weekday_t day, scheduler_time_t time)
 {
-  // Loop all intervals of the day
+  // Loop all occupied intervals of the day
   scheduler_day_t *curr_day = &(scheduler->daily_schedules[day]);
-  for (size_t i = 0; i < SCHEDULER_MAX_INTERVALS_PER_DAY; i++)
+  for (uint32_t occ = curr_day->occupied; occ; occ &= occ - 1)
   {
+    int i = __builtin_ctz(occ);
     scheduler_interval_t *interval = &(curr_day->intervals[i]);
 
-    // Skip empty slots
-    if (scheduler_interval_empty(*interval)) continue;
-
     // Interval turned on
     if (
       scheduler_time_compare(time, interval->start) == 1      // Time is after start
@@ -257,11 +361,11 @@ INLINED static void scheduler_tick_intervals(scheduler_t *scheduler, scheduler_w
     )
     {
       interval->active = true;
+      scheduler_bump_generation(scheduler);
       scheduler->callback(EDGE_OFF_TO_ON, interval->identifier, day, time);
 
       // Broadcast scheduler on event
-      scptr char *ev_arg = strfmt_direct("%d", i);
-      web_server_socket_events_broadcast(WSE_INTERVAL_SCHED_ON, ev_arg);
+      web_server_socket_events_broadcast_index(WSE_INTERVAL_SCHED_ON, i);
 
       continue;
     }
@@ -278,11 +382,11 @@ INLINED static void scheduler_tick_intervals(scheduler_t *scheduler, scheduler_w
     )
     {
       interval->active = false;
+      scheduler_bump_generation(scheduler);
       scheduler->callback(EDGE_ON_TO_OFF, interval->identifier, day, time);
 
       // Broadcast scheduler off event
-      scptr char *ev_arg = strfmt_direct("%d", i);
-      web_server_socket_events_broadcast(WSE_INTERVAL_SCHED_OFF, ev_arg);
+      web_server_socket_events_broadcast_index(WSE_INTERVAL_SCHED_OFF, i);
 
       continue;
     }
@@ -315,11 +419,10 @@ INLINED static void scheduler_tick_valve_timers(valve_control_t *valve_ctl, sche
     else if (time_comparison > 0)
     {
       scheduler_time_decrement_bound(&(targ_valve->timer), 1);
+      valve_control_bump_generation(valve_ctl);
     }
 
-    scptr char *time_strval = scheduler_time_stringify(&(targ_valve->timer));
-    scptr char *ev_args = strfmt_direct("%lu;%s", i, time_strval);
-    web_server_socket_events_broadcast(WSE_VALVE_TIMER_UPDATED, ev_args);
+    web_server_socket_events_broadcast_valve_timer(i, targ_valve->timer);
   }
 }
 
@@ -337,12 +440,16 @@ void scheduler_tick(scheduler_t *scheduler, valve_control_t *valve_ctl)
   )
     return;
 
+  scheduler_lock(scheduler);
+
   scheduler_tick_valve_timers(valve_ctl, day, time);
   scheduler_tick_intervals(scheduler, day, time);
 
   // Update last tick day and time
   scheduler->last_tick_day = day;
   scheduler->last_tick_time = time;
+
+  scheduler_unlock(scheduler);
 }
 
 INLINED static void scheduler_file_write_time(File f, scheduler_time_t *time)
@@ -425,8 +532,11 @@ void scheduler_file_load(scheduler_t *scheduler)
       // Read start- and end time
       scheduler_file_read_time(f, &(interval->start));
       scheduler_file_read_time(f, &(interval->end));
+
+      scheduler_day_update_occupancy(day, j);
     }
   }
 
   f.close();
+  scheduler_bump_generation(scheduler);
 }
\ No newline at end of file
@@ -5,6 +5,11 @@ char *scheduler_time_stringify(const scheduler_time_t *time)
   return strfmt_direct("%02d:%02d:%02d", time->hours, time->minutes, time->seconds);
 }
 
+void scheduler_time_stringify_buf(const scheduler_time_t *time, char *buf)
+{
+  snprintf(buf, SCHEDULER_TIME_STRLEN, "%02d:%02d:%02d", time->hours, time->minutes, time->seconds);
+}
+
 void scheduler_time_decrement_bound(scheduler_time_t *time, size_t seconds)
 {
   // Calculate hours, minutes and seconds deltas
@@ -149,4 +154,9 @@ int scheduler_time_compare(scheduler_time_t a, scheduler_time_t b)
 
   // All values equal, times are equal
   return 0;
+}
+
+bool scheduler_time_json_convert(const char *str, char **err, void *out)
+{
+  return scheduler_time_parse(str, err, (scheduler_time_t *) out);
 }
\ No newline at end of file
@@ -0,0 +1,292 @@
+#include "sd_reader.h"
+
+static sd_reader_t readers[SD_READER_POOL_LEN];
+static SemaphoreHandle_t readers_lock = NULL;
+static TaskHandle_t reader_task = NULL;
+
+/*
+============================================================================
+                                  Filling                                   
+============================================================================
+*/
+
+/**
+ * @brief Free a reader's resources and hand it back to the pool, expects the lock to be held
+ */
+INLINED static void sd_reader_release(sd_reader_t *reader)
+{
+  reader->f.close();
+  reader->f = File(NULL);
+
+  for (uint8_t i = 0; i < 2; i++)
+  {
+    mman_dealloc(reader->bufs[i]);
+    reader->bufs[i] = NULL;
+  }
+
+  reader->in_use = false;
+  reader->closing = false;
+}
+
+/**
+ * @brief Queue a buffer to be filled by the reader task, expects the lock to be held
+ */
+INLINED static void sd_reader_queue(sd_reader_t *reader, uint8_t buf_index)
+{
+  reader->queued[buf_index] = true;
+  xTaskNotifyGive(reader_task);
+}
+
+/**
+ * @brief Fill the next queued buffer of a reader
+ * 
+ * @return true A buffer has been filled
+ * @return false The reader had nothing to fill
+ */
+static bool sd_reader_fill(sd_reader_t *reader)
+{
+  xSemaphoreTake(readers_lock, portMAX_DELAY);
+
+  uint8_t buf_index = reader->fill_next;
+  if (!reader->in_use || !reader->queued[buf_index])
+  {
+    xSemaphoreGive(readers_lock);
+    return false;
+  }
+
+  // Released by it's consumer in the meantime
+  if (reader->closing)
+  {
+    reader->queued[0] = reader->queued[1] = false;
+    sd_reader_release(reader);
+    xSemaphoreGive(readers_lock);
+    return false;
+  }
+
+  uint8_t *buf = reader->bufs[buf_index];
+  xSemaphoreGive(readers_lock);
+
+  // Read without holding the lock, the buffer isn't touched by the consumer until it's ready
+  int read = reader->f.read(buf, SD_READER_CHUNK_LEN);
+
+  xSemaphoreTake(readers_lock, portMAX_DELAY);
+
+  reader->lens[buf_index] = read < 0 ? 0 : read;
+  reader->ready[buf_index] = true;
+  reader->queued[buf_index] = false;
+  reader->fill_next = buf_index ^ 1;
+
+  if (reader->closing && !reader->queued[reader->fill_next])
+    sd_reader_release(reader);
+
+  else if (reader->waiter)
+  {
+    xTaskNotifyGive(reader->waiter);
+    reader->waiter = NULL;
+  }
+
+  xSemaphoreGive(readers_lock);
+  return true;
+}
+
+static void sd_reader_task(void *arg)
+{
+  while (true)
+  {
+    // One chunk per reader and round, so concurrent streams share the bus
+    bool filled = false;
+    for (size_t i = 0; i < SD_READER_POOL_LEN; i++)
+      filled |= sd_reader_fill(&(readers[i]));
+
+    // Sleep until the next buffer is queued
+    if (!filled)
+      ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+  }
+}
+
+/*
+============================================================================
+                                 Consuming                                  
+============================================================================
+*/
+
+sd_reader_t *sd_reader_open(File f)
+{
+  if (!reader_task)
+    return NULL;
+
+  xSemaphoreTake(readers_lock, portMAX_DELAY);
+
+  sd_reader_t *reader = NULL;
+  for (size_t i = 0; i < SD_READER_POOL_LEN; i++)
+  {
+    if (!readers[i].in_use)
+    {
+      reader = &(readers[i]);
+      break;
+    }
+  }
+
+  // Pool exhausted, the caller has to read directly
+  if (!reader)
+  {
+    xSemaphoreGive(readers_lock);
+    return NULL;
+  }
+
+  // Nothing is queued yet, so the reader task leaves this reader alone until the first chunk is in
+  reader->in_use = true;
+  reader->closing = false;
+  reader->front = 0;
+  reader->fill_next = 1;
+  reader->front_offs = 0;
+  reader->waiter = NULL;
+
+  for (uint8_t i = 0; i < 2; i++)
+  {
+    reader->lens[i] = 0;
+    reader->ready[i] = false;
+    reader->queued[i] = false;
+  }
+
+  xSemaphoreGive(readers_lock);
+
+  uint8_t *bufs[2];
+  for (uint8_t i = 0; i < 2; i++)
+    bufs[i] = (uint8_t *) mman_alloc(sizeof(uint8_t), SD_READER_CHUNK_LEN, NULL);
+
+  // Out of memory, the caller has to read directly, just like when the pool is exhausted
+  if (!bufs[0] || !bufs[1])
+  {
+    dbgerr("Could not allocate the chunk buffers of an SD reader!");
+
+    for (uint8_t i = 0; i < 2; i++)
+    {
+      if (bufs[i])
+        mman_dealloc(bufs[i]);
+    }
+
+    xSemaphoreTake(readers_lock, portMAX_DELAY);
+    reader->in_use = false;
+    xSemaphoreGive(readers_lock);
+    return NULL;
+  }
+
+  // The first chunk is read right away, so a response can start sending without waiting on the reader task
+  int read = f.read(bufs[0], SD_READER_CHUNK_LEN);
+
+  xSemaphoreTake(readers_lock, portMAX_DELAY);
+
+  reader->f = f;
+  reader->bufs[0] = bufs[0];
+  reader->bufs[1] = bufs[1];
+  reader->lens[0] = read < 0 ? 0 : read;
+  reader->ready[0] = true;
+
+  // Prefetch the second chunk, unless the first one already reached the end of the file
+  if (reader->lens[0] == SD_READER_CHUNK_LEN)
+    sd_reader_queue(reader, 1);
+
+  xSemaphoreGive(readers_lock);
+  return reader;
+}
+
+size_t sd_reader_read(sd_reader_t *reader, uint8_t *buf, size_t len, uint32_t timeout_ms)
+{
+  xSemaphoreTake(readers_lock, portMAX_DELAY);
+
+  uint8_t b = reader->front;
+  while (!reader->ready[b])
+  {
+    // Neither ready nor queued, so the previous chunk has been the last one
+    if (!reader->queued[b])
+    {
+      xSemaphoreGive(readers_lock);
+      return 0;
+    }
+
+    if (timeout_ms == 0)
+    {
+      xSemaphoreGive(readers_lock);
+      return SD_READER_PENDING;
+    }
+
+    // Wait for the reader task to complete this chunk
+    reader->waiter = xTaskGetCurrentTaskHandle();
+    xSemaphoreGive(readers_lock);
+
+    bool notified = ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(timeout_ms)) > 0;
+
+    xSemaphoreTake(readers_lock, portMAX_DELAY);
+    reader->waiter = NULL;
+
+    if (!notified && !reader->ready[b])
+    {
+      xSemaphoreGive(readers_lock);
+      return SD_READER_PENDING;
+    }
+  }
+
+  // Empty chunk, the end of the file has been reached
+  size_t remaining = reader->lens[b] - reader->front_offs;
+  if (remaining == 0)
+  {
+    xSemaphoreGive(readers_lock);
+    return 0;
+  }
+
+  size_t n = remaining < len ? remaining : len;
+  memcpy(buf, &(reader->bufs[b][reader->front_offs]), n);
+  reader->front_offs += n;
+
+  // Chunk consumed, refill it unless it has been the last one and move on to the other
+  if (reader->front_offs == reader->lens[b])
+  {
+    reader->ready[b] = false;
+    reader->front_offs = 0;
+    reader->front = b ^ 1;
+
+    if (reader->lens[b] == SD_READER_CHUNK_LEN)
+      sd_reader_queue(reader, b);
+  }
+
+  xSemaphoreGive(readers_lock);
+  return n;
+}
+
+void sd_reader_close(sd_reader_t *reader)
+{
+  xSemaphoreTake(readers_lock, portMAX_DELAY);
+
+  // The reader task releases it after it's current read
+  if (reader->queued[0] || reader->queued[1])
+    reader->closing = true;
+  else
+    sd_reader_release(reader);
+
+  xSemaphoreGive(readers_lock);
+}
+
+/*
+============================================================================
+                              Initialization                                
+============================================================================
+*/
+
+void sd_reader_init()
+{
+  readers_lock = xSemaphoreCreateMutex();
+
+  // Read on core 1, the network is handled on core 0
+  xTaskCreatePinnedToCore(
+    sd_reader_task,                               // Task entry point
+    "sd_reader",                                  // Task name
+    SD_READER_TASK_STACK,                         // Stack size
+    NULL,                                         // Parameter to the entry point
+    SD_READER_TASK_PRIO,                          // Priority
+    &reader_task,                                 // Task handle output, to notify it
+    1                                             // On core 1 (main loop)
+  );
+
+  dbginf("Started the SD reader task!");
+}
\ No newline at end of file
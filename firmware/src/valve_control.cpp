@@ -1,5 +1,8 @@
 #include "valve_control.h"
 
+// Renaming events carry the whole alias
+static_assert(VALVE_CONTROL_ALIAS_MAXLEN <= WEB_SERVER_SOCKET_EVENT_ALIAS_MAXLEN, "Valve aliases don't fit into events");
+
 valve_t valve_control_valve_make(const char *alias, bool disabled)
 {
   valve_t res = { { 0 }, false, disabled, SCHEDULER_TIME_MIDNIGHT, false };
@@ -20,9 +23,15 @@ valve_control_t valve_control_make()
     *valve = valve_control_valve_make("?", false);
   }
 
+  vc.generation = 0;
   return vc;
 }
 
+void valve_control_bump_generation(valve_control_t *vc)
+{
+  vc->generation++;
+}
+
 INLINED static void valve_control_apply_state(valve_control_t *vc)
 {
   // Enable all bits that correspond to active valves within the state number
@@ -41,12 +50,64 @@ void valve_control_toggle(valve_control_t *vc, size_t valve_id, bool state)
     return;
 
   // Broadcast valve on/off event
-  scptr char *ev_arg = strfmt_direct("%d", valve_id);
-  web_server_socket_events_broadcast(state ? WSE_VALVE_ON : WSE_VALVE_OFF, ev_arg);
+  web_server_socket_events_broadcast_index(state ? WSE_VALVE_ON : WSE_VALVE_OFF, valve_id);
 
   // Set the valve's state and apply it to the output
   vc->valves[valve_id].state = state;
   valve_control_apply_state(vc);
+  valve_control_bump_generation(vc);
+}
+
+int valve_control_find_alias(valve_control_t *vc, size_t valve_id, const char *alias)
+{
+  for (size_t i = 0; i < VALVE_CONTROL_NUM_VALVES; i++)
+  {
+    // Skip self
+    if (i == valve_id)
+      continue;
+
+    // Name collision
+    if (strncasecmp(vc->valves[i].alias, alias, VALVE_CONTROL_ALIAS_MAXLEN) == 0)
+      return i;
+  }
+
+  return -1;
+}
+
+void valve_control_valve_patch(valve_control_t *vc, size_t valve_id, const valve_t *patch)
+{
+  valve_t *targ_valve = &(vc->valves[valve_id]);
+
+  // Check for deltas and patch name
+  if (strncmp(targ_valve->alias, patch->alias, VALVE_CONTROL_ALIAS_MAXLEN) != 0)
+  {
+    strncpy(targ_valve->alias, patch->alias, VALVE_CONTROL_ALIAS_MAXLEN);
+
+    web_server_socket_events_broadcast_valve_rename(valve_id, patch->alias);
+  }
+
+  // Check for deltas and patch disabled state
+  if (targ_valve->disabled != patch->disabled)
+  {
+    targ_valve->disabled = patch->disabled;
+
+    web_server_socket_events_broadcast_index(patch->disabled ? WSE_VALVE_DISABLE_ON : WSE_VALVE_DISABLE_OFF, valve_id);
+  }
+
+  valve_control_bump_generation(vc);
+}
+
+void valve_control_timer_start(valve_control_t *vc, size_t valve_id, scheduler_time_t timer)
+{
+  valve_t *targ_valve = &(vc->valves[valve_id]);
+
+  // Set timer and turn on valve
+  targ_valve->timer = timer;
+  targ_valve->has_timer = true;
+  valve_control_toggle(vc, valve_id, true);
+
+  web_server_socket_events_broadcast_valve_timer(valve_id, timer);
+  web_server_socket_events_broadcast_index(WSE_VALVE_ON, valve_id);
 }
 
 void valve_control_file_load(valve_control_t *vc)
@@ -76,6 +137,7 @@ void valve_control_file_load(valve_control_t *vc)
   }
 
   f.close();
+  valve_control_bump_generation(vc);
 }
 
 void valve_control_file_save(valve_control_t *vc)
@@ -106,67 +168,86 @@ void valve_control_file_save(valve_control_t *vc)
   f.close();
 }
 
-htable_t *valve_control_valve_jsonify(valve_control_t *vc, size_t valve_id)
+INLINED static void valve_control_valve_write(json_writer_t *jw, valve_t *valve, size_t valve_id)
+{
+  char timer_str[SCHEDULER_TIME_STRLEN];
+  scheduler_time_stringify_buf(&(valve->timer), timer_str);
+
+  json_writer_obj_begin(jw);
+  json_writer_key(jw, "alias");
+  json_writer_str_n(jw, valve->alias, VALVE_CONTROL_ALIAS_MAXLEN);
+  json_writer_kv_str(jw, "timer", timer_str);
+  json_writer_kv_bool(jw, "state", valve->state);
+  json_writer_kv_bool(jw, "disabled", valve->disabled);
+  json_writer_kv_int(jw, "identifier", valve_id);
+  json_writer_obj_end(jw);
+}
+
+void valve_control_valve_json_write(json_writer_t *jw, valve_control_t *vc, size_t valve_id)
 {
   // Index out of range
   if (valve_id >= VALVE_CONTROL_NUM_VALVES)
-    return NULL;
-
-  // Create a new node
-  scptr htable_t *res = htable_make(5, mman_dealloc_nr);
-  valve_t valve = vc->valves[valve_id];
-
-  // Set alias string
-  scptr char *alias = strclone_s(valve.alias, VALVE_CONTROL_ALIAS_MAXLEN);
-  if (jsonh_set_str(res, "alias", (char *) mman_ref(alias)) != JOPRES_SUCCESS)
-    mman_dealloc(alias);
-
-  // Set timer string
-  scptr char *timer = scheduler_time_stringify(&(valve.timer));
-  if (jsonh_set_str(res, "timer", (char *) mman_ref(timer)) != JOPRES_SUCCESS)
-    mman_dealloc(timer);
+    return;
 
-  jsonh_set_bool(res, "state", valve.state);
-  jsonh_set_bool(res, "disabled", valve.disabled);
-  jsonh_set_int(res, "identifier", valve_id);
+  valve_control_valve_write(jw, &(vc->valves[valve_id]), valve_id);
+}
 
-  return (htable_t *) mman_ref(res);
+bool valve_control_indexed_valve_json_step(json_writer_t *jw, size_t step, void *indexed)
+{
+  valve_control_indexed_valve_t *targ = (valve_control_indexed_valve_t *) indexed;
+  valve_control_valve_write(jw, &(targ->valve), targ->valve_id);
+  return false;
 }
 
-bool valve_control_valve_parse(htable_t *json, char **err, valve_t *out)
+bool valve_control_json_step(json_writer_t *jw, size_t step, void *vc)
 {
-  // Get the alias string
-  jsonh_opres_t jopr;
-  char *alias_s = NULL;
-  if ((jopr = jsonh_get_str(json, "alias", &alias_s)) != JOPRES_SUCCESS)
+  // Header
+  if (step == 0)
   {
-    *err = jsonh_getter_errstr("alias", jopr);
-    return false;
+    json_writer_obj_begin(jw);
+    json_writer_key(jw, "items");
+    json_writer_arr_begin(jw);
+    return true;
   }
 
-  // Check for empty aliases
-  size_t al = strlen(alias_s);
-  if (al == 0)
+  // One valve per step
+  size_t valve_id = step - 1;
+  if (valve_id < VALVE_CONTROL_NUM_VALVES)
   {
-    *err = strfmt_direct("Empty aliases are not allowed");
-    return false;
+    valve_control_valve_json_write(jw, (valve_control_t *) vc, valve_id);
+    return true;
   }
 
-  // Check for aliases that are too long to store
-  if (al >= VALVE_CONTROL_ALIAS_MAXLEN)
-  {
-    *err = strfmt_direct("The alias has to have a length between 1 and %d characters", VALVE_CONTROL_ALIAS_MAXLEN);
-    return false;
-  }
+  // Footer
+  json_writer_arr_end(jw);
+  json_writer_obj_end(jw);
+  return false;
+}
+
+/**
+ * @brief Validate a read valve, aliases may not be empty
+ */
+static bool valve_control_valve_validate(void *out, uint32_t seen, char **err)
+{
+  valve_t *valve = (valve_t *) out;
 
-  // Get the disabled state
-  bool disabled_b = NULL;
-  if ((jopr = jsonh_get_bool(json, "disabled", &disabled_b)) != JOPRES_SUCCESS)
+  if (valve->alias[0] == 0)
   {
-    *err = jsonh_getter_errstr("disabled", jopr);
+    *err = strfmt_direct("Empty aliases are not allowed");
     return false;
   }
 
-  *out = valve_control_valve_make(alias_s, disabled_b);
   return true;
-}
\ No newline at end of file
+}
+
+static const json_reader_field_t valve_control_valve_fields[] = {
+  JSON_READER_FIELD("alias", JRT_STR, valve_t, alias, NULL, true),
+  JSON_READER_FIELD("disabled", JRT_BOOL, valve_t, disabled, NULL, true),
+};
+
+const json_reader_schema_t valve_control_valve_schema = {
+  valve_control_valve_fields,
+  sizeof(valve_control_valve_fields) / sizeof(json_reader_field_t),
+  sizeof(valve_t),
+  valve_control_valve_validate
+};
\ No newline at end of file
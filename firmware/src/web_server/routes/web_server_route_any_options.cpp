@@ -8,5 +8,38 @@
 
 void web_server_route_any_options(AsyncWebServerRequest *request)
 {
-  web_server_empty_ok(request);
+  AsyncWebServerResponse *resp = request->beginResponse(204);
+  web_server_append_preflight_headers(resp);
+  request->send(resp);
+}
+
+/**
+ * @brief Claims every OPTIONS request, no matter the path, as the
+ * response to a preflight is the same for all of them
+ */
+class WebServerPreflightHandler : public AsyncWebHandler
+{
+  public:
+    bool canHandle(AsyncWebServerRequest *request) override
+    {
+      return request->method() == HTTP_OPTIONS;
+    }
+
+    void handleRequest(AsyncWebServerRequest *request) override
+    {
+      web_server_route_any_options(request);
+    }
+};
+
+static WebServerPreflightHandler preflight_handler;
+
+/*
+============================================================================
+                              Initialization                                
+============================================================================
+*/
+
+void web_server_route_any_options_init(AsyncWebServer *wsrv)
+{
+  wsrv->addHandler(&preflight_handler);
 }
\ No newline at end of file
@@ -0,0 +1,335 @@
+#include "web_server/routes/web_server_route_batch.h"
+
+ENUM_LUT_FULL_IMPL(web_server_route_batch_op_type, _EVALS_WEB_SERVER_ROUTE_BATCH_OP);
+
+// Every operation emits a handful of events at most, which all have to fit the queue until they're published
+static_assert(
+  WEB_SERVER_SOCKET_EVENT_QUEUE_LEN >= WEB_SERVER_ROUTE_BATCH_MAX_OPS * 4,
+  "The event queue has to hold all events of a full batch"
+);
+
+static scheduler_t *sched = NULL;
+static valve_control_t *valvectl = NULL;
+
+/*
+============================================================================
+                                  Schema                                    
+============================================================================
+*/
+
+static bool web_server_route_batch_op_convert(const char *str, char **err, void *out)
+{
+  if (web_server_route_batch_op_type_value(str, (web_server_route_batch_op_type_t *) out) != ENUMLUT_SUCCESS)
+  {
+    *err = strfmt_direct("Unknown operation " QUOTSTR, str);
+    return false;
+  }
+
+  return true;
+}
+
+// Bits of the fields within the seen-mask, in the order of the field table
+#define BATCH_F_OP          (1UL << 0)
+#define BATCH_F_DAY         (1UL << 1)
+#define BATCH_F_INDEX       (1UL << 2)
+#define BATCH_F_VALVE       (1UL << 3)
+#define BATCH_F_START       (1UL << 4)
+#define BATCH_F_END         (1UL << 5)
+#define BATCH_F_IDENTIFIER  (1UL << 6)
+#define BATCH_F_DISABLED    (1UL << 7)
+#define BATCH_F_ALIAS       (1UL << 8)
+#define BATCH_F_DURATION    (1UL << 9)
+
+static const json_reader_field_t batch_op_fields[] = {
+  JSON_READER_FIELD("op", JRT_STR, web_server_route_batch_op_t, op, web_server_route_batch_op_convert, true),
+  JSON_READER_FIELD("day", JRT_STR, web_server_route_batch_op_t, day, scheduler_weekday_json_convert, false),
+  JSON_READER_FIELD("index", JRT_UINT, web_server_route_batch_op_t, index, NULL, false),
+  JSON_READER_FIELD("valve", JRT_UINT, web_server_route_batch_op_t, valve, NULL, false),
+  JSON_READER_FIELD("start", JRT_STR, web_server_route_batch_op_t, start, scheduler_time_json_convert, false),
+  JSON_READER_FIELD("end", JRT_STR, web_server_route_batch_op_t, end, scheduler_time_json_convert, false),
+  JSON_READER_FIELD("identifier", JRT_UINT, web_server_route_batch_op_t, identifier, NULL, false),
+  JSON_READER_FIELD("disabled", JRT_BOOL, web_server_route_batch_op_t, disabled, NULL, false),
+  JSON_READER_FIELD("alias", JRT_STR, web_server_route_batch_op_t, alias, NULL, false),
+  JSON_READER_FIELD("duration", JRT_STR, web_server_route_batch_op_t, duration, scheduler_time_json_convert, false),
+};
+
+#define BATCH_NUM_FIELDS (sizeof(batch_op_fields) / sizeof(json_reader_field_t))
+
+/**
+ * @brief Fields every type of operation requires, indexed by the operation's type
+ */
+static const uint32_t batch_op_required[] = {
+  /* BATCH_INTERVAL_SET    */ BATCH_F_OP | BATCH_F_DAY | BATCH_F_INDEX | BATCH_F_START | BATCH_F_END | BATCH_F_IDENTIFIER | BATCH_F_DISABLED,
+  /* BATCH_INTERVAL_DELETE */ BATCH_F_OP | BATCH_F_DAY | BATCH_F_INDEX,
+  /* BATCH_DAY_SET         */ BATCH_F_OP | BATCH_F_DAY | BATCH_F_DISABLED,
+  /* BATCH_VALVE_SET       */ BATCH_F_OP | BATCH_F_VALVE | BATCH_F_ALIAS | BATCH_F_DISABLED,
+  /* BATCH_TIMER_SET       */ BATCH_F_OP | BATCH_F_VALVE | BATCH_F_DURATION,
+};
+
+/**
+ * @brief Validate an operation on it's own, independent of the current state
+ */
+static bool web_server_route_batch_validate(void *out, uint32_t seen, char **err)
+{
+  web_server_route_batch_op_t *op = (web_server_route_batch_op_t *) out;
+
+  // Every operation has it's own set of required fields
+  uint32_t missing = batch_op_required[op->op] & ~seen;
+  if (missing)
+  {
+    *err = strfmt_direct("Missing key \"%s\"", batch_op_fields[__builtin_ctz(missing)].key);
+    return false;
+  }
+
+  if ((seen & BATCH_F_INDEX) && op->index >= SCHEDULER_MAX_INTERVALS_PER_DAY)
+  {
+    *err = strfmt_direct("\"index\" has to be less than %d", SCHEDULER_MAX_INTERVALS_PER_DAY);
+    return false;
+  }
+
+  if ((seen & BATCH_F_VALVE) && op->valve >= VALVE_CONTROL_NUM_VALVES)
+  {
+    *err = strfmt_direct("\"valve\" has to be less than %d", VALVE_CONTROL_NUM_VALVES);
+    return false;
+  }
+
+  switch (op->op) {
+    case BATCH_INTERVAL_SET:
+    {
+      if (scheduler_time_compare(op->end, op->start) != 1)
+      {
+        *err = strfmt_direct("\"end\" has to be greater than \"start\"");
+        return false;
+      }
+      break;
+    }
+
+    case BATCH_VALVE_SET:
+    {
+      if (op->alias[0] == 0)
+      {
+        *err = strfmt_direct("Empty aliases are not allowed");
+        return false;
+      }
+      break;
+    }
+
+    case BATCH_TIMER_SET:
+    {
+      if (scheduler_time_compare(op->duration, SCHEDULER_TIME_MIDNIGHT) == 0)
+      {
+        *err = strfmt_direct("\"duration\" cannot be zero");
+        return false;
+      }
+      break;
+    }
+
+    default:
+      break;
+  }
+
+  return true;
+}
+
+static const json_reader_schema_t batch_op_schema = {
+  batch_op_fields, BATCH_NUM_FIELDS, sizeof(web_server_route_batch_op_t), web_server_route_batch_validate
+};
+
+/**
+ * @brief Append a read operation to the batch
+ */
+static bool web_server_route_batch_item(void *item, uint32_t seen, void *arg, char **err)
+{
+  web_server_route_batch_t *batch = (web_server_route_batch_t *) arg;
+
+  if (batch->num_ops >= WEB_SERVER_ROUTE_BATCH_MAX_OPS)
+  {
+    *err = strfmt_direct("A batch can have at most %d operations", WEB_SERVER_ROUTE_BATCH_MAX_OPS);
+    return false;
+  }
+
+  batch->ops[batch->num_ops++] = *((web_server_route_batch_op_t *) item);
+  return true;
+}
+
+static const web_server_json_body_t batch_body = {
+  &batch_op_schema, WEB_SERVER_ROUTE_BATCH_BODY_MAXLEN, web_server_route_batch_item, sizeof(web_server_route_batch_t)
+};
+
+/*
+============================================================================
+                                 Routines                                   
+============================================================================
+*/
+
+/**
+ * @brief Check all state-dependent conditions of the operations in order, against a
+ * shadow of the valve table, without touching anything. Expects the scheduler to be locked
+ * 
+ * @return true All operations can be applied
+ * @return false An operation would fail, the response has already been sent
+ */
+static bool web_server_route_batch_check(AsyncWebServerRequest *request, web_server_route_batch_t *batch)
+{
+  char aliases[VALVE_CONTROL_NUM_VALVES][VALVE_CONTROL_ALIAS_MAXLEN];
+  bool has_timer[VALVE_CONTROL_NUM_VALVES];
+
+  for (size_t i = 0; i < VALVE_CONTROL_NUM_VALVES; i++)
+  {
+    memcpy(aliases[i], valvectl->valves[i].alias, VALVE_CONTROL_ALIAS_MAXLEN);
+    has_timer[i] = scheduler_time_compare(valvectl->valves[i].timer, SCHEDULER_TIME_MIDNIGHT) != 0;
+  }
+
+  for (size_t i = 0; i < batch->num_ops; i++)
+  {
+    web_server_route_batch_op_t *op = &(batch->ops[i]);
+
+    switch (op->op) {
+      case BATCH_VALVE_SET:
+      {
+        // Aliases have to be unique after every single operation, ignoring casing
+        for (size_t j = 0; j < VALVE_CONTROL_NUM_VALVES; j++)
+        {
+          if (j == op->valve || strncasecmp(aliases[j], op->alias, VALVE_CONTROL_ALIAS_MAXLEN) != 0)
+            continue;
+
+          web_server_error_resp(request, 409, VALVE_ALIAS_DUP, "Operation %u: The alias " QUOTSTR " is already in use", (unsigned int) i, op->alias);
+          return false;
+        }
+
+        strncpy(aliases[op->valve], op->alias, VALVE_CONTROL_ALIAS_MAXLEN);
+        break;
+      }
+
+      case BATCH_TIMER_SET:
+      {
+        if (has_timer[op->valve])
+        {
+          web_server_error_resp(request, 409, VALVE_TIMER_ALREADY_ACTIVE, "Operation %u: This valve already has an active timer", (unsigned int) i);
+          return false;
+        }
+
+        has_timer[op->valve] = true;
+        break;
+      }
+
+      default:
+        break;
+    }
+  }
+
+  return true;
+}
+
+/**
+ * @brief Apply a checked operation, expects the scheduler to be locked
+ */
+static void web_server_route_batch_apply(web_server_route_batch_op_t *op)
+{
+  switch (op->op) {
+    case BATCH_INTERVAL_SET:
+    {
+      scheduler_interval_t interval = scheduler_interval_make(op->start, op->end, op->identifier, op->disabled);
+      scheduler_interval_patch(sched, op->day, op->index, &interval);
+      break;
+    }
+
+    case BATCH_INTERVAL_DELETE:
+    {
+      scheduler_interval_clear(sched, op->day, op->index);
+      break;
+    }
+
+    case BATCH_DAY_SET:
+    {
+      scheduler_day_t patch;
+      patch.disabled = op->disabled;
+      scheduler_day_patch(sched, op->day, &patch);
+      break;
+    }
+
+    case BATCH_VALVE_SET:
+    {
+      valve_t patch = valve_control_valve_make(op->alias, op->disabled);
+      valve_control_valve_patch(valvectl, op->valve, &patch);
+      break;
+    }
+
+    case BATCH_TIMER_SET:
+    {
+      valve_control_timer_start(valvectl, op->valve, op->duration);
+      break;
+    }
+  }
+}
+
+/*
+============================================================================
+                                POST /batch                                 
+============================================================================
+*/
+
+static void web_server_route_batch(AsyncWebServerRequest *request, const web_server_route_args_t *args)
+{
+  // Operations as read and validated from the json body
+  void *body = NULL;
+  if (!web_server_ensure_json_body(request, &body))
+    return;
+
+  web_server_route_batch_t *batch = (web_server_route_batch_t *) body;
+  int64_t start_us = esp_timer_get_time();
+
+  scheduler_lock(sched);
+
+  if (!web_server_route_batch_check(request, batch))
+  {
+    scheduler_unlock(sched);
+    return;
+  }
+
+  bool sched_changed = false, valves_changed = false;
+  for (size_t i = 0; i < batch->num_ops; i++)
+  {
+    web_server_route_batch_op_t *op = &(batch->ops[i]);
+    web_server_route_batch_apply(op);
+
+    // Timers are not persisted
+    if (op->op == BATCH_VALVE_SET)
+      valves_changed = true;
+    else if (op->op != BATCH_TIMER_SET)
+      sched_changed = true;
+  }
+
+  scheduler_unlock(sched);
+
+  // Persist every affected table once
+  if (sched_changed)
+    scheduler_file_save(sched);
+
+  if (valves_changed)
+    valve_control_file_save(valvectl);
+
+  // Publish all events of this batch right away, so the returned sequence number already covers them
+  uint32_t seq = web_server_socket_events_publish_now();
+
+  scptr htable_t *res = htable_make(4, mman_dealloc_nr);
+  jsonh_set_int(res, "operations", batch->num_ops);
+  jsonh_set_int(res, "epoch", web_server_socket_events_epoch());
+  jsonh_set_int(res, "seq", seq);
+  jsonh_set_int(res, "took_us", (int) (esp_timer_get_time() - start_us));
+  web_server_json_resp(request, 200, res);
+}
+
+/*
+============================================================================
+                              Initialization                                
+============================================================================
+*/
+
+void web_server_route_batch_init(scheduler_t *scheduler_ref, valve_control_t *valvectl_ref)
+{
+  sched = scheduler_ref;
+  valvectl = valvectl_ref;
+
+  web_server_router_on("/api/batch", HTTP_POST, web_server_route_batch, web_server_json_body_handler, &batch_body);
+}
\ No newline at end of file
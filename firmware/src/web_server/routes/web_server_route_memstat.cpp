@@ -6,7 +6,7 @@
 ============================================================================
 */
 
-static void web_server_route_memstat(AsyncWebServerRequest *request)
+static void web_server_route_memstat(AsyncWebServerRequest *request, const web_server_route_args_t *args)
 {
   size_t mac = mman_get_alloc_count(), mdeac = mman_get_dealloc_count();
   scptr char *resp = strfmt_direct("%lu %lu %lu\n", esp_get_free_heap_size(), mac, mdeac);
@@ -19,9 +19,8 @@ static void web_server_route_memstat(AsyncWebServerRequest *request)
 ============================================================================
 */
 
-void web_server_route_memstat_init(AsyncWebServer *wsrv)
+void web_server_route_memstat_init()
 {
   // /memstat, Memory statistics for debugging purposes
-  wsrv->on("/api/memstat", HTTP_GET, web_server_route_memstat);
-  wsrv->on("/api/memstat", HTTP_OPTIONS, web_server_route_any_options);
+  web_server_router_on("/api/memstat", HTTP_GET, web_server_route_memstat);
 }
\ No newline at end of file
@@ -0,0 +1,214 @@
+#include "web_server/routes/web_server_route_metrics.h"
+
+/**
+ * @brief Snapshot of all metrics, taken when the request arrives
+ */
+typedef struct web_server_metrics
+{
+  uint32_t heap_free;
+  uint32_t heap_min_free;
+  size_t mman_allocs;
+  size_t mman_deallocs;
+  web_server_cache_stats_t cache;
+  web_server_static_stats_t statics;
+  web_server_admission_stats_t admission;
+  web_server_gzip_stats_t gzip[WEB_SERVER_GZIP_STATS_SLOTS];
+  size_t num_gzip;
+  web_server_socket_events_stats_t events;
+  web_server_socket_events_sse_stats_t sse;
+  web_server_socket_events_client_info_t clients[WEB_SERVER_SOCKET_EVENT_MAX_CLIENTS];
+  size_t num_clients;
+} web_server_metrics_t;
+
+// Number of steps used to emit the sections in front of the compression list
+#define WEB_SERVER_METRICS_SECTION_STEPS 5
+
+/*
+============================================================================
+                                  Routines                                  
+============================================================================
+*/
+
+INLINED static void web_server_metrics_write_ratio(json_writer_t *jw, const char *key, uint32_t part, uint32_t total)
+{
+  // Percentage, zero as long as there's no data
+  json_writer_kv_uint(jw, key, total == 0 ? 0 : (unsigned long) (((uint64_t) part * 100) / total));
+}
+
+static bool web_server_metrics_json_step(json_writer_t *jw, size_t step, void *arg)
+{
+  web_server_metrics_t *metrics = (web_server_metrics_t *) arg;
+
+  // One section per step, so no step gets close to the writer's overflow buffer
+  switch (step) {
+    case 0:
+    {
+      json_writer_obj_begin(jw);
+
+      json_writer_key(jw, "heap");
+      json_writer_obj_begin(jw);
+      json_writer_kv_uint(jw, "free", metrics->heap_free);
+      json_writer_kv_uint(jw, "minFree", metrics->heap_min_free);
+      json_writer_kv_uint(jw, "mmanAllocs", metrics->mman_allocs);
+      json_writer_kv_uint(jw, "mmanDeallocs", metrics->mman_deallocs);
+      json_writer_obj_end(jw);
+      return true;
+    }
+
+    case 1:
+    {
+      json_writer_key(jw, "responseCache");
+      json_writer_obj_begin(jw);
+      json_writer_kv_uint(jw, "hits", metrics->cache.hits);
+      json_writer_kv_uint(jw, "misses", metrics->cache.misses);
+      json_writer_kv_uint(jw, "notModified", metrics->cache.not_modified);
+
+      // Both 304s and cached bodies avoid serialization
+      uint32_t avoided = metrics->cache.hits + metrics->cache.not_modified;
+      web_server_metrics_write_ratio(jw, "hitRatio", avoided, avoided + metrics->cache.misses);
+      json_writer_obj_end(jw);
+      return true;
+    }
+
+    case 2:
+    {
+      json_writer_key(jw, "static");
+      json_writer_obj_begin(jw);
+      json_writer_kv_uint(jw, "cacheHits", metrics->statics.cache_hits);
+      json_writer_kv_uint(jw, "cacheMisses", metrics->statics.cache_misses);
+      web_server_metrics_write_ratio(jw, "cacheHitRatio", metrics->statics.cache_hits, metrics->statics.cache_hits + metrics->statics.cache_misses);
+      json_writer_kv_uint(jw, "cacheEvictions", metrics->statics.cache_evictions);
+      json_writer_kv_uint(jw, "cacheBytes", metrics->statics.cache_bytes);
+      json_writer_kv_uint(jw, "cacheBudget", WEB_SERVER_STATIC_CACHE_BUDGET);
+      json_writer_kv_uint(jw, "files", metrics->statics.files);
+      json_writer_kv_uint(jw, "gzipped", metrics->statics.gzipped);
+      json_writer_kv_uint(jw, "notModified", metrics->statics.not_modified);
+      json_writer_kv_uint(jw, "bytes", metrics->statics.bytes);
+      json_writer_obj_end(jw);
+      return true;
+    }
+
+    case 3:
+    {
+      json_writer_key(jw, "admission");
+      json_writer_obj_begin(jw);
+      json_writer_kv_uint(jw, "admitted", metrics->admission.admitted);
+      json_writer_kv_uint(jw, "rateLimited", metrics->admission.rate_limited);
+      json_writer_kv_uint(jw, "busy", metrics->admission.busy);
+      json_writer_kv_uint(jw, "lowHeap", metrics->admission.low_heap);
+      json_writer_kv_uint(jw, "inFlight", metrics->admission.in_flight);
+      json_writer_kv_uint(jw, "maxInFlight", metrics->admission.max_in_flight);
+      json_writer_kv_uint(jw, "inFlightLimit", WEB_SERVER_ADMISSION_MAX_IN_FLIGHT);
+      json_writer_kv_uint(jw, "heapWatermark", WEB_SERVER_ADMISSION_HEAP_WATERMARK);
+      json_writer_obj_end(jw);
+      return true;
+    }
+
+    case 4:
+    {
+      json_writer_key(jw, "compression");
+      json_writer_arr_begin(jw);
+      return true;
+    }
+  }
+
+  // One compressed route per step after the sections
+  size_t gzip_index = step - WEB_SERVER_METRICS_SECTION_STEPS;
+  if (gzip_index < metrics->num_gzip)
+  {
+    web_server_gzip_stats_t *gzip = &(metrics->gzip[gzip_index]);
+    json_writer_obj_begin(jw);
+    json_writer_kv_str(jw, "endpoint", gzip->endpoint);
+    json_writer_kv_uint(jw, "compressed", gzip->compressed);
+    json_writer_kv_uint(jw, "skipped", gzip->skipped);
+    json_writer_kv_uint(jw, "busy", gzip->busy);
+    json_writer_kv_uint(jw, "bytesIn", gzip->bytes_in);
+    json_writer_kv_uint(jw, "bytesOut", gzip->bytes_out);
+    web_server_metrics_write_ratio(jw, "ratio", gzip->bytes_out, gzip->bytes_in);
+    json_writer_kv_uint(jw, "avgUs", gzip->compressed == 0 ? 0 : (unsigned long) (gzip->total_us / gzip->compressed));
+    json_writer_obj_end(jw);
+    return true;
+  }
+
+  if (gzip_index == metrics->num_gzip)
+  {
+    json_writer_arr_end(jw);
+
+    json_writer_key(jw, "events");
+    json_writer_obj_begin(jw);
+    json_writer_kv_uint(jw, "broadcasts", metrics->events.broadcasts);
+    json_writer_kv_uint(jw, "sharedBuffers", metrics->events.buffers);
+    json_writer_kv_uint(jw, "batches", metrics->events.batches);
+    json_writer_kv_uint(jw, "dropped", metrics->events.dropped);
+    json_writer_kv_uint(jw, "avgBatchUs", metrics->events.batches == 0 ? 0 : (unsigned long) (metrics->events.total_us / metrics->events.batches));
+    json_writer_kv_uint(jw, "maxBatchUs", metrics->events.max_us);
+    json_writer_kv_uint(jw, "staged", metrics->events.staged);
+    json_writer_kv_uint(jw, "coalesced", metrics->events.coalesced);
+    json_writer_kv_uint(jw, "resyncs", metrics->events.resyncs);
+    json_writer_kv_uint(jw, "evicted", metrics->events.evicted);
+    json_writer_kv_uint(jw, "sseClients", metrics->sse.clients);
+    json_writer_kv_uint(jw, "sseAvgWaiting", metrics->sse.avg_waiting);
+
+    json_writer_key(jw, "clients");
+    json_writer_arr_begin(jw);
+    return true;
+  }
+
+  // One client per step after the compression list
+  size_t client_index = step - WEB_SERVER_METRICS_SECTION_STEPS - metrics->num_gzip - 1;
+  if (client_index < metrics->num_clients)
+  {
+    web_server_socket_events_client_info_t *client = &(metrics->clients[client_index]);
+    json_writer_obj_begin(jw);
+    json_writer_kv_uint(jw, "id", client->id);
+    json_writer_kv_uint(jw, "rttUs", client->rtt_us);
+    json_writer_kv_bool(jw, "binary", client->binary);
+    json_writer_kv_uint(jw, "staged", client->num_staged);
+    json_writer_obj_end(jw);
+    return true;
+  }
+
+  // Footer
+  json_writer_arr_end(jw);
+  json_writer_obj_end(jw);
+  json_writer_obj_end(jw);
+  return false;
+}
+
+/*
+============================================================================
+                                GET /metrics                                
+============================================================================
+*/
+
+static void web_server_route_metrics(AsyncWebServerRequest *request, const web_server_route_args_t *args)
+{
+  web_server_metrics_t metrics = {
+    .heap_free = esp_get_free_heap_size(),
+    .heap_min_free = esp_get_minimum_free_heap_size(),
+    .mman_allocs = mman_get_alloc_count(),
+    .mman_deallocs = mman_get_dealloc_count(),
+    .cache = web_server_cache_get_stats(),
+    .statics = web_server_static_get_stats(),
+    .admission = web_server_admission_get_stats(),
+    .events = web_server_socket_events_get_stats(),
+    .sse = web_server_socket_events_get_sse_stats(),
+  };
+
+  metrics.num_gzip = web_server_gzip_get_stats(metrics.gzip);
+  metrics.num_clients = web_server_socket_events_get_clients(metrics.clients);
+
+  web_server_json_stream_resp(request, 200, web_server_metrics_json_step, &metrics, sizeof(metrics));
+}
+
+/*
+============================================================================
+                              Initialization                                
+============================================================================
+*/
+
+void web_server_route_metrics_init()
+{
+  // /metrics, Runtime statistics of the webserver
+  web_server_router_on("/api/metrics", HTTP_GET, web_server_route_metrics);
+}
\ No newline at end of file
@@ -30,16 +30,14 @@ static void web_server_route_not_found(AsyncWebServerRequest *request)
   }
 
   // Start out with the default web-root index.html
-  const char *path = WEB_SERVER_STATIC_PATH "index.html";
+  const char *path = WEB_SERVER_STATIC_INDEX_PATH;
 
   // File manager request, respond with the file manager's index.html
   if (url.startsWith("/fileman"))
-    path = WEB_SERVER_STATIC_PATH "fileman/index.html";
+    path = WEB_SERVER_STATIC_FILEMAN_INDEX_PATH;
 
-  // File requested, fall back to index.html (used for Angular)
-  File index = SD.open(path);
-  request->send(200, "text/html", index.readString());
-  index.close();
+  // Deep link, fall back to index.html (used for Angular)
+  web_server_static_send_index(request, path);
 }
 
 /*
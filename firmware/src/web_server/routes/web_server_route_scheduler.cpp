@@ -2,68 +2,58 @@
 
 static scheduler_t *sched = NULL;
 
+static const web_server_json_body_t day_body = {
+  &scheduler_day_schema, WEB_SERVER_ROUTE_SCHEDULER_BODY_MAXLEN, NULL, 0
+};
+
+static const web_server_json_body_t interval_body = {
+  &scheduler_interval_schema, WEB_SERVER_ROUTE_SCHEDULER_BODY_MAXLEN, NULL, 0
+};
+
 /*
 ============================================================================
                                  Routines                                   
 ============================================================================
 */
 
-INLINED static bool web_server_parse_scheduler_day(AsyncWebServerRequest *request, const char *day_str, scheduler_weekday_t *day)
-{
-  // Parse weekday from path arg
-  if (scheduler_weekday_value(day_str, day) != ENUMLUT_SUCCESS)
-  {
-    web_server_error_resp(request, 400, INVALID_WEEKDAY, "Invalid weekday specified (%s)!", day_str);
-    return false;
-  }
-
-  return true;
-}
-
 INLINED static bool web_server_route_scheduler_day_index_parse(
   AsyncWebServerRequest *request,
+  const web_server_route_args_t *args,
   scheduler_weekday_t *day,
   long *index
 )
 {
-  // Parse weekday from path arg
-  if (!web_server_parse_scheduler_day(request, request->pathArg(0).c_str(), day))
-    return false;
-
-  // Parse numeric index
-  const char *index_str = request->pathArg(1).c_str();
-  if (longp(index, index_str, 10) != LONGP_SUCCESS)
-  {
-    web_server_error_resp(request, 400, NON_NUM_ID, "Invalid non-numeric index (%s)!", index_str);
-    return false;
-  }
+  // The router already converted both the weekday and the numeric index
+  *day = (scheduler_weekday_t) args->values[0];
+  *index = args->values[1];
 
   // Check index validity
   if (*index < 0 || *index >= SCHEDULER_MAX_INTERVALS_PER_DAY)
   {
-    web_server_error_resp(request, 400, OUT_OF_RANGE_ID, "Invalid out-of-range index (%s)!", index_str);
+    web_server_error_resp(request, 400, OUT_OF_RANGE_ID, "Invalid out-of-range index (%ld)!", *index);
     return false;
   }
 
   return true;
 }
 
-
 /*
 ============================================================================
                             GET /scheduler/{day}                            
 ============================================================================
 */
 
-static void web_server_route_scheduler_day(AsyncWebServerRequest *request)
+static void web_server_route_scheduler_day(AsyncWebServerRequest *request, const web_server_route_args_t *args)
 {
-  // Parse weekday from path arg
-  scheduler_weekday_t day;
-  if (!web_server_parse_scheduler_day(request, request->pathArg(0).c_str(), &day))
-    return;
+  // Weekday from the path
+  scheduler_weekday_t day = (scheduler_weekday_t) args->values[0];
+
+  // Respond with the day, only re-rendered after changes
+  char key[WEB_SERVER_CACHE_KEY_MAXLEN];
+  snprintf(key, sizeof(key), "scheduler/%s", scheduler_weekday_name(day));
 
-  scptr htable_t *weekday_schedule = scheduler_weekday_jsonify(sched, day);
-  web_server_json_resp(request, 200, weekday_schedule);
+  scheduler_day_t *targ_day = &(sched->daily_schedules[day]);
+  web_server_cache_json_resp(request, key, sched->generation, scheduler_day_json_step, targ_day, sizeof(scheduler_day_t));
 }
 
 /*
@@ -72,43 +62,26 @@ static void web_server_route_scheduler_day(AsyncWebServerRequest *request)
 ============================================================================
 */
 
-static void web_server_route_scheduler_day_edit(AsyncWebServerRequest *request)
+static void web_server_route_scheduler_day_edit(AsyncWebServerRequest *request, const web_server_route_args_t *args)
 {
-  // Parse weekday from path arg
-  scheduler_weekday_t day;
-  if (!web_server_parse_scheduler_day(request, request->pathArg(0).c_str(), &day))
-    return;
+  // Weekday from the path
+  scheduler_weekday_t day = (scheduler_weekday_t) args->values[0];
 
-  scptr htable_t *body = NULL;
+  // Day as read from the json body
+  void *body = NULL;
   if (!web_server_ensure_json_body(request, &body))
     return;
 
-  // Parse day from json
-  scptr char *err = NULL;
-  scheduler_day_t sched_day;
-  if (!scheduler_day_parse(body, &err, &sched_day))
-  {
-    web_server_error_resp(request, 400, BODY_MALFORMED, "Body data malformed: %s", err);
-    return;
-  }
+  scheduler_day_t *sched_day = (scheduler_day_t *) body;
 
   // Update the day and save it persistently
-  scheduler_day_t *targ_day = &(sched->daily_schedules[day]);
-
-  // Check for deltas and disabled state
-  if (targ_day->disabled != sched_day.disabled)
-  {
-    targ_day->disabled = sched_day.disabled;
-
-    scptr char *ev_args = strfmt_direct("%s", scheduler_weekday_name(day));
-    web_server_socket_events_broadcast(sched_day.disabled ? WSE_DAY_DISABLE_ON : WSE_DAY_DISABLE_OFF, ev_args);
-  }
-
+  scheduler_day_patch(sched, day, sched_day);
   scheduler_file_save(sched);
 
+  scheduler_day_t *targ_day = &(sched->daily_schedules[day]);
+
   // Respond with the updated day
-  scptr htable_t *day_jsn = scheduler_weekday_jsonify(sched, day);
-  web_server_json_resp(request, 200, day_jsn);
+  web_server_json_stream_resp(request, 200, scheduler_day_json_step, targ_day, sizeof(scheduler_day_t));
 }
 
 /*
@@ -117,16 +90,16 @@ static void web_server_route_scheduler_day_edit(AsyncWebServerRequest *request)
 ============================================================================
 */
 
-static void web_server_route_scheduler_day_index(AsyncWebServerRequest *request)
+static void web_server_route_scheduler_day_index(AsyncWebServerRequest *request, const web_server_route_args_t *args)
 {
   scheduler_weekday_t day;
   long index;
 
-  if (!web_server_route_scheduler_day_index_parse(request, &day, &index))
+  if (!web_server_route_scheduler_day_index_parse(request, args, &day, &index))
     return;
 
-  scptr htable_t *int_jsn = scheduler_interval_jsonify(index, &(sched->daily_schedules[day].intervals[index]));
-  web_server_json_resp(request, 200, int_jsn);
+  scheduler_indexed_interval_t targ = { (int) index, sched->daily_schedules[day].intervals[index] };
+  web_server_json_stream_resp(request, 200, scheduler_indexed_interval_json_step, &targ, sizeof(targ));
 }
 
 /*
@@ -135,70 +108,28 @@ static void web_server_route_scheduler_day_index(AsyncWebServerRequest *request)
 ============================================================================
 */
 
-static void web_server_route_scheduler_day_index_edit(AsyncWebServerRequest *request)
+static void web_server_route_scheduler_day_index_edit(AsyncWebServerRequest *request, const web_server_route_args_t *args)
 {
   scheduler_weekday_t day;
   long index;
 
-  if (!web_server_route_scheduler_day_index_parse(request, &day, &index))
+  if (!web_server_route_scheduler_day_index_parse(request, args, &day, &index))
     return;
 
-  scptr htable_t *body = NULL;
+  // Interval as read and validated from the json body
+  void *body = NULL;
   if (!web_server_ensure_json_body(request, &body))
     return;
 
-  // Parse interval from json
-  scptr char *err = NULL;
-  scheduler_interval_t interval;
-  if (!scheduler_interval_parse(body, &err, &interval))
-  {
-    web_server_error_resp(request, 400, BODY_MALFORMED, "Body data malformed: %s", err);
-    return;
-  }
+  scheduler_interval_t *interval = (scheduler_interval_t *) body;
 
   // Update the entry and save it persistently
-  scheduler_interval_t *targ_interval = &(sched->daily_schedules[day].intervals[index]);
-
-  // Check for deltas and patch disabled
-  if (targ_interval->disabled != interval.disabled)
-  {
-    targ_interval->disabled = interval.disabled;
-
-    scptr char *ev_args = strfmt_direct("%s;%ld", scheduler_weekday_name(day), index);
-    web_server_socket_events_broadcast(interval.disabled ? WSE_INTERVAL_DISABLE_ON : WSE_INTERVAL_DISABLE_OFF, ev_args);
-  }
-
-  // Check for deltas and patch end
-  if (scheduler_time_compare(targ_interval->end, interval.end) != 0)
-  {
-    targ_interval->end = interval.end;
-
-    scptr char *ev_args = strfmt_direct("%s;%ld;%s", scheduler_weekday_name(day), index, scheduler_time_stringify(&(interval.end)));
-    web_server_socket_events_broadcast(WSE_INTERVAL_END_CHANGE, ev_args);
-  }
-
-  // Check for deltas and patch start
-  if (scheduler_time_compare(targ_interval->start, interval.start) != 0)
-  {
-    targ_interval->start = interval.start;
-
-    scptr char *ev_args = strfmt_direct("%s;%ld;%s", scheduler_weekday_name(day), index, scheduler_time_stringify(&(interval.start)));
-    web_server_socket_events_broadcast(WSE_INTERVAL_START_CHANGE, ev_args);
-  }
-
-  // Check for deltas and patch identifier
-  if (targ_interval->identifier != interval.identifier)
-  {
-    targ_interval->identifier = interval.identifier;
-    scptr char *ev_args = strfmt_direct("%s;%ld;%u", scheduler_weekday_name(day), index, interval.identifier);
-    web_server_socket_events_broadcast(WSE_INTERVAL_IDENTIFIER_CHANGE, ev_args);
-  }
-
+  scheduler_interval_patch(sched, day, index, interval);
   scheduler_file_save(sched);
 
   // Respond with the updated entry
-  scptr htable_t *int_jsn = scheduler_interval_jsonify(index, targ_interval);
-  web_server_json_resp(request, 200, int_jsn);
+  scheduler_indexed_interval_t targ = { (int) index, sched->daily_schedules[day].intervals[index] };
+  web_server_json_stream_resp(request, 200, scheduler_indexed_interval_json_step, &targ, sizeof(targ));
 }
 
 /*
@@ -207,30 +138,22 @@ static void web_server_route_scheduler_day_index_edit(AsyncWebServerRequest *req
 ============================================================================
 */
 
-static void web_server_route_scheduler_day_index_delete(AsyncWebServerRequest *request)
+static void web_server_route_scheduler_day_index_delete(AsyncWebServerRequest *request, const web_server_route_args_t *args)
 {
   scheduler_weekday_t day;
   long index;
 
-  if (!web_server_route_scheduler_day_index_parse(request, &day, &index))
+  if (!web_server_route_scheduler_day_index_parse(request, args, &day, &index))
     return;
 
-  scheduler_interval_t *targ = &(sched->daily_schedules[day].intervals[index]);
-
-  // Already an empty slot
-  if (scheduler_interval_empty(*targ))
+  // Clear slot and save persistently
+  if (!scheduler_interval_clear(sched, day, index))
   {
     web_server_error_resp(request, 404, INDEX_EMPTY, "This index is already empty");
     return;
   }
 
-  // Clear slot and save persistently
-  *targ = SCHEDULER_INTERVAL_EMPTY;
   scheduler_file_save(sched);
-
-  scptr char *ev_args = strfmt_direct("%s;%ld", scheduler_weekday_name(day), index);
-  web_server_socket_events_broadcast(WSE_INTERVAL_DELETED, ev_args);
-
   web_server_empty_ok(request);
 }
 
@@ -240,20 +163,18 @@ static void web_server_route_scheduler_day_index_delete(AsyncWebServerRequest *r
 ============================================================================
 */
 
-void web_server_route_scheduler_init(scheduler_t *scheduler_ref, AsyncWebServer *wsrv)
+void web_server_route_scheduler_init(scheduler_t *scheduler_ref)
 {
   sched = scheduler_ref;
 
   // /scheduler/{day}
-  const char *p_sched_day = "^\\/api\\/scheduler\\/([A-Za-z0-9_]+)$";
-  wsrv->on(p_sched_day, HTTP_GET, web_server_route_scheduler_day);
-  wsrv->on(p_sched_day, HTTP_PUT, web_server_route_scheduler_day_edit, NULL, web_server_str_body_handler);
-  wsrv->on(p_sched_day, HTTP_OPTIONS, web_server_route_any_options);
-
-  // /scheduler/{day}/index
-  const char *p_sched_day_index = "^\\/api\\/scheduler\\/([A-Za-z0-9_]+)\\/([0-9]+)$";
-  wsrv->on(p_sched_day_index, HTTP_GET, web_server_route_scheduler_day_index);
-  wsrv->on(p_sched_day_index, HTTP_PUT, web_server_route_scheduler_day_index_edit, NULL, web_server_str_body_handler);
-  wsrv->on(p_sched_day_index, HTTP_DELETE, web_server_route_scheduler_day_index_delete);
-  wsrv->on(p_sched_day_index, HTTP_OPTIONS, web_server_route_any_options);
+  const char *p_sched_day = "/api/scheduler/{weekday}";
+  web_server_router_on(p_sched_day, HTTP_GET, web_server_route_scheduler_day);
+  web_server_router_on(p_sched_day, HTTP_PUT, web_server_route_scheduler_day_edit, web_server_json_body_handler, &day_body);
+
+  // /scheduler/{day}/{index}
+  const char *p_sched_day_index = "/api/scheduler/{weekday}/{int}";
+  web_server_router_on(p_sched_day_index, HTTP_GET, web_server_route_scheduler_day_index);
+  web_server_router_on(p_sched_day_index, HTTP_PUT, web_server_route_scheduler_day_index_edit, web_server_json_body_handler, &interval_body);
+  web_server_router_on(p_sched_day_index, HTTP_DELETE, web_server_route_scheduler_day_index_delete);
 }
\ No newline at end of file
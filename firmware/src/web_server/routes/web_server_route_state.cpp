@@ -0,0 +1,150 @@
+#include "web_server/routes/web_server_route_state.h"
+
+static scheduler_t *sched = NULL;
+static valve_control_t *valvectl = NULL;
+
+/**
+ * @brief Snapshot of the whole state, taken when the request arrives
+ */
+typedef struct web_server_state
+{
+  uint32_t generation;
+  uint32_t epoch;
+  uint32_t seq;
+  scheduler_day_t days[7];
+  valve_control_t valves;
+} web_server_state_t;
+
+/*
+============================================================================
+                                  Routines                                  
+============================================================================
+*/
+
+/**
+ * @brief Combined generation of the scheduler and the valves, changes whenever either of them does
+ */
+INLINED static uint32_t web_server_state_generation()
+{
+  return sched->generation + valvectl->generation;
+}
+
+/**
+ * @brief Emits the whole state by delegating to the step routines of days and valves:
+ * 
+ * {
+ *   "generation": <integer>,
+ *   "epoch": <epoch the sequence number belongs to>,
+ *   "seq": <sequence number of the latest event included>,
+ *   "scheduler": { "<weekday>": <day>, ... },
+ *   "valves": <valves>
+ * }
+ */
+static bool web_server_state_json_step(json_writer_t *jw, size_t step, void *arg)
+{
+  web_server_state_t *state = (web_server_state_t *) arg;
+
+  // Header
+  if (step == 0)
+  {
+    json_writer_obj_begin(jw);
+    json_writer_kv_uint(jw, "generation", state->generation);
+    json_writer_kv_uint(jw, "epoch", state->epoch);
+    json_writer_kv_uint(jw, "seq", state->seq);
+    json_writer_key(jw, "scheduler");
+    json_writer_obj_begin(jw);
+    return true;
+  }
+
+  // A day takes a header, one step per occupied interval and a footer
+  size_t offs = 1;
+  for (int i = 0; i < 7; i++)
+  {
+    scheduler_day_t *day = &(state->days[i]);
+    size_t day_steps = __builtin_popcount(day->occupied) + 2;
+
+    if (step >= offs + day_steps)
+    {
+      offs += day_steps;
+      continue;
+    }
+
+    // Start of a new day, reset the day's interval cursor
+    size_t day_step = step - offs;
+    if (day_step == 0)
+    {
+      jw->cursor = 0;
+      json_writer_key(jw, scheduler_weekday_name((scheduler_weekday_t) i));
+    }
+
+    scheduler_day_json_step(jw, day_step, day);
+    return true;
+  }
+
+  // All days written
+  if (step == offs)
+  {
+    json_writer_obj_end(jw);
+    json_writer_key(jw, "valves");
+  }
+
+  if (valve_control_json_step(jw, step - offs, &(state->valves)))
+    return true;
+
+  // Footer
+  json_writer_obj_end(jw);
+  return false;
+}
+
+/*
+============================================================================
+                                 GET /state                                 
+============================================================================
+*/
+
+static void web_server_route_state(AsyncWebServerRequest *request, const web_server_route_args_t *args)
+{
+  // Read the sequence number first, events after it are to be replayed on top of the snapshot
+  uint32_t seq = web_server_socket_events_last_seq();
+  uint32_t generation = web_server_state_generation();
+
+  // The body also carries the sequence number, so new events invalidate it as well
+  uint32_t body_generation = generation + seq;
+
+  // Avoid taking the snapshot if the body doesn't need to be rendered
+  if (web_server_cache_try_resp(request, "state", body_generation))
+    return;
+
+  // Taken once, the cache renders from it directly instead of copying it again
+  web_server_state_t *state = (web_server_state_t *) mman_alloc(sizeof(web_server_state_t), 1, NULL);
+  if (!state)
+  {
+    dbgerr("Could not allocate a snapshot of the state!");
+    web_server_out_of_memory_resp(request);
+    return;
+  }
+
+  state->generation = generation;
+  state->epoch = web_server_socket_events_epoch();
+  state->seq = seq;
+  memcpy(state->days, sched->daily_schedules, sizeof(state->days));
+  memcpy(&(state->valves), valvectl, sizeof(valve_control_t));
+
+  // Respond with everything at once, only re-rendered after changes
+  web_server_cache_snapshot_resp(request, "state", body_generation, web_server_state_json_step, state, sizeof(web_server_state_t));
+}
+
+/*
+============================================================================
+                              Initialization                                
+============================================================================
+*/
+
+void web_server_route_state_init(scheduler_t *scheduler_ref, valve_control_t *valvectl_ref)
+{
+  sched = scheduler_ref;
+  valvectl = valvectl_ref;
+
+  // /state, Snapshot of all days and valves
+  web_server_router_on("/api/state", HTTP_GET, web_server_route_state);
+}
\ No newline at end of file
@@ -2,27 +2,37 @@
 
 static valve_control_t *valvectl = NULL;
 
+static const json_reader_field_t timer_fields[] = {
+  { "duration", JRT_STR, 0, sizeof(scheduler_time_t), scheduler_time_json_convert, true },
+};
+
+static const json_reader_schema_t timer_schema = {
+  timer_fields, sizeof(timer_fields) / sizeof(json_reader_field_t), sizeof(scheduler_time_t), NULL
+};
+
+static const web_server_json_body_t valve_body = {
+  &valve_control_valve_schema, WEB_SERVER_ROUTE_VALVES_BODY_MAXLEN, NULL, 0
+};
+
+static const web_server_json_body_t timer_body = {
+  &timer_schema, WEB_SERVER_ROUTE_VALVES_BODY_MAXLEN, NULL, 0
+};
+
 /*
 ============================================================================
                                   Routines                                  
 ============================================================================
 */
 
-INLINED static bool valves_parse_id(AsyncWebServerRequest *request, size_t *valve_id)
+INLINED static bool valves_parse_id(AsyncWebServerRequest *request, const web_server_route_args_t *args, size_t *valve_id)
 {
-  // Parse numeric identifier
-  const char *id_str = request->pathArg(0).c_str();
-  long valve_id_l;
-  if (longp(&valve_id_l, id_str, 10) != LONGP_SUCCESS)
-  {
-    web_server_error_resp(request, 400, NON_NUM_ID, "Invalid non-numeric identifier (%s)!", id_str);
-    return false;
-  }
+  // The router already made sure it's numeric
+  long valve_id_l = args->values[0];
 
   // Check identifier validity
   if (valve_id_l < 0 || valve_id_l >= VALVE_CONTROL_NUM_VALVES)
   {
-    web_server_error_resp(request, 400, OUT_OF_RANGE_ID, "Invalid out-of-range identifier (%s)!", id_str);
+    web_server_error_resp(request, 400, OUT_OF_RANGE_ID, "Invalid out-of-range identifier (%ld)!", valve_id_l);
     return false;
   }
 
@@ -36,25 +46,10 @@ INLINED static bool valves_parse_id(AsyncWebServerRequest *request, size_t *valv
 ============================================================================
 */
 
-static void web_server_route_valves(AsyncWebServerRequest *request)
+static void web_server_route_valves(AsyncWebServerRequest *request, const web_server_route_args_t *args)
 {
-  scptr htable_t *resp = htable_make(1, mman_dealloc_nr);
-
-  // Create a list of all available valves
-  scptr dynarr_t *valves = dynarr_make(VALVE_CONTROL_NUM_VALVES, VALVE_CONTROL_NUM_VALVES, mman_dealloc_nr);
-  for (size_t i = 0; i < VALVE_CONTROL_NUM_VALVES; i++)
-  {
-    scptr htable_t *valve = valve_control_valve_jsonify(valvectl, i);
-
-    if (!valve)
-      continue;
-
-    if (jsonh_insert_arr_obj(valves, (htable_t *) mman_ref(valve)) != JOPRES_SUCCESS)
-      mman_dealloc(valve);
-  }
-
-  jsonh_set_arr(resp, "items", valves);
-  web_server_json_resp(request, 200, resp);
+  // Respond with a list of all available valves, only re-rendered after changes
+  web_server_cache_json_resp(request, "valves", valvectl->generation, valve_control_json_step, valvectl, sizeof(valve_control_t));
 }
 
 /*
@@ -63,66 +58,33 @@ static void web_server_route_valves(AsyncWebServerRequest *request)
 ============================================================================
 */
 
-static void web_server_route_valves_edit(AsyncWebServerRequest *request)
+static void web_server_route_valves_edit(AsyncWebServerRequest *request, const web_server_route_args_t *args)
 {
   size_t valve_id = 0;
-  if (!valves_parse_id(request, &valve_id))
+  if (!valves_parse_id(request, args, &valve_id))
     return;
 
-  scptr htable_t *body = NULL;
+  // Valve as read and validated from the json body
+  void *body = NULL;
   if (!web_server_ensure_json_body(request, &body))
     return;
 
-  // Parse valve from json
-  scptr char *err = NULL;
-  valve_t valve;
-  if (!valve_control_valve_parse(body, &err, &valve))
-  {
-    web_server_error_resp(request, 400, BODY_MALFORMED, "Body data malformed: %s", err);
-    return;
-  }
+  valve_t valve = *((valve_t *) body);
 
   // Check if that name is already in use, ignore casing
-  for (size_t i = 0; i < VALVE_CONTROL_NUM_VALVES; i++)
+  if (valve_control_find_alias(valvectl, valve_id, valve.alias) >= 0)
   {
-    // Skip self
-    if (i == valve_id)
-      continue;
-
-    // Name collision
-    if (strncasecmp(valvectl->valves[i].alias, valve.alias, VALVE_CONTROL_ALIAS_MAXLEN) == 0)
-    {
-      web_server_error_resp(request, 409, VALVE_ALIAS_DUP, "The alias " QUOTSTR " is already in use", valve.alias);
-      return;
-    }
-  }
-
-  // Get the target valve and patch it, then save
-  valve_t *targ_valve = &(valvectl->valves[valve_id]);
-
-  // Check for deltas and patch name
-  if (strncmp(targ_valve->alias, valve.alias, VALVE_CONTROL_ALIAS_MAXLEN) != 0)
-  {
-    strncpy(targ_valve->alias, valve.alias, VALVE_CONTROL_ALIAS_MAXLEN);
-
-    scptr char *ev_arg = strfmt_direct("%d;%s", valve_id, valve.alias);
-    web_server_socket_events_broadcast(WSE_VALVE_RENAME, ev_arg);
-  }
-
-  // Check for deltas and patch disabled state
-  if (targ_valve->disabled != valve.disabled)
-  {
-    targ_valve->disabled = valve.disabled;
-
-    scptr char *ev_arg = strfmt_direct("%d", valve_id);
-    web_server_socket_events_broadcast(valve.disabled ? WSE_VALVE_DISABLE_ON : WSE_VALVE_DISABLE_OFF, ev_arg);
+    web_server_error_resp(request, 409, VALVE_ALIAS_DUP, "The alias " QUOTSTR " is already in use", valve.alias);
+    return;
   }
 
+  // Patch the target valve, then save
+  valve_control_valve_patch(valvectl, valve_id, &valve);
   valve_control_file_save(valvectl);
 
   // Respond with the updated valve
-  scptr htable_t *valve_jsn = valve_control_valve_jsonify(valvectl, valve_id);
-  web_server_json_resp(request, 200, valve_jsn);
+  valve_control_indexed_valve_t targ = { valve_id, valvectl->valves[valve_id] };
+  web_server_json_stream_resp(request, 200, valve_control_indexed_valve_json_step, &targ, sizeof(targ));
 }
 
 /*
@@ -131,10 +93,10 @@ static void web_server_route_valves_edit(AsyncWebServerRequest *request)
 ============================================================================
 */
 
-static void web_server_route_valves_activate(AsyncWebServerRequest *request)
+static void web_server_route_valves_activate(AsyncWebServerRequest *request, const web_server_route_args_t *args)
 {
   size_t valve_id;
-  if (!valves_parse_id(request, &valve_id))
+  if (!valves_parse_id(request, args, &valve_id))
     return;
 
   // Check the target valve
@@ -155,10 +117,10 @@ static void web_server_route_valves_activate(AsyncWebServerRequest *request)
 ============================================================================
 */
 
-static void web_server_route_valves_deactivate(AsyncWebServerRequest *request)
+static void web_server_route_valves_deactivate(AsyncWebServerRequest *request, const web_server_route_args_t *args)
 {
   size_t valve_id;
-  if (!valves_parse_id(request, &valve_id))
+  if (!valves_parse_id(request, args, &valve_id))
     return;
 
   valve_t *targ_valve = &(valvectl->valves[valve_id]);
@@ -188,34 +150,18 @@ static void web_server_route_valves_deactivate(AsyncWebServerRequest *request)
 ============================================================================
 */
 
-static void web_server_route_valves_timer_set(AsyncWebServerRequest *request)
+static void web_server_route_valves_timer_set(AsyncWebServerRequest *request, const web_server_route_args_t *args)
 {
   size_t valve_id = 0;
-  if (!valves_parse_id(request, &valve_id))
+  if (!valves_parse_id(request, args, &valve_id))
     return;
 
-  scptr htable_t *body = NULL;
+  // Duration as read and parsed from the json body
+  void *body = NULL;
   if (!web_server_ensure_json_body(request, &body))
     return;
 
-  // Get timer value from json
-  jsonh_opres_t jopr;
-  char *timer_str = NULL;
-  if ((jopr = jsonh_get_str(body, "duration", &timer_str)) != JOPRES_SUCCESS)
-  {
-    scptr char *err = jsonh_getter_errstr("duration", jopr);
-    web_server_error_resp(request, 400, BODY_MALFORMED, "Body data malformed: %s", err);
-    return;
-  }
-
-  // Parse timer string
-  scptr char *err = NULL;
-  scheduler_time_t timer;
-  if (!scheduler_time_parse(timer_str, &err, &timer))
-  {
-    web_server_error_resp(request, 400, BODY_MALFORMED, "Body data malformed: %s", err);
-    return;
-  }
+  scheduler_time_t timer = *((scheduler_time_t *) body);
 
   // Ensure the timer is not empty
   if (scheduler_time_compare(timer, SCHEDULER_TIME_MIDNIGHT) == 0)
@@ -233,17 +179,7 @@ static void web_server_route_valves_timer_set(AsyncWebServerRequest *request)
     return;
   }
 
-  // Set timer and turn on valve
-  targ_valve->timer = timer;
-  targ_valve->has_timer = true;
-  valve_control_toggle(valvectl, valve_id, true);
-
-  scptr char *timer_strval = scheduler_time_stringify(&timer);
-  scptr char *ev_args_timer = strfmt_direct("%lu;%s", valve_id, timer_strval);
-  web_server_socket_events_broadcast(WSE_VALVE_TIMER_UPDATED, ev_args_timer);
-
-  scptr char *ev_args_off = strfmt_direct("%lu", valve_id);
-  web_server_socket_events_broadcast(WSE_VALVE_ON, ev_args_off);
+  valve_control_timer_start(valvectl, valve_id, timer);
 
   web_server_empty_ok(request);
 }
@@ -254,10 +190,10 @@ static void web_server_route_valves_timer_set(AsyncWebServerRequest *request)
 ============================================================================
 */
 
-static void web_server_route_valves_timer_clear(AsyncWebServerRequest *request)
+static void web_server_route_valves_timer_clear(AsyncWebServerRequest *request, const web_server_route_args_t *args)
 {
   size_t valve_id;
-  if (!valves_parse_id(request, &valve_id))
+  if (!valves_parse_id(request, args, &valve_id))
     return;
 
   valve_t *targ_valve = &(valvectl->valves[valve_id]);
@@ -274,10 +210,8 @@ static void web_server_route_valves_timer_clear(AsyncWebServerRequest *request)
   targ_valve->has_timer = false;
   valve_control_toggle(valvectl, valve_id, false);
 
-  scptr char *timer_strval = scheduler_time_stringify(&SCHEDULER_TIME_MIDNIGHT);
-  scptr char *ev_args = strfmt_direct("%lu;%s", valve_id, timer_strval);
-  web_server_socket_events_broadcast(WSE_VALVE_TIMER_UPDATED, ev_args);
-  web_server_socket_events_broadcast(WSE_VALVE_OFF, ev_args);
+  web_server_socket_events_broadcast_valve_timer(valve_id, SCHEDULER_TIME_MIDNIGHT);
+  web_server_socket_events_broadcast_index(WSE_VALVE_OFF, valve_id);
 
   web_server_empty_ok(request);
 }
@@ -288,25 +222,21 @@ static void web_server_route_valves_timer_clear(AsyncWebServerRequest *request)
 ============================================================================
 */
 
-void web_server_route_valves_init(valve_control_t *valvectl_ref, AsyncWebServer *wsrv)
+void web_server_route_valves_init(valve_control_t *valvectl_ref)
 {
   valvectl = valvectl_ref;
 
   // /valves
-  const char *p_valves = "^\\/api\\/valves$";
-  wsrv->on(p_valves, HTTP_GET, web_server_route_valves);
-  wsrv->on(p_valves, HTTP_OPTIONS, web_server_route_any_options);
+  web_server_router_on("/api/valves", HTTP_GET, web_server_route_valves);
 
   // /valves/{id}
-  const char *p_valves_id = "^\\/api\\/valves\\/([0-9]+)$";
-  wsrv->on(p_valves_id, HTTP_PUT, web_server_route_valves_edit, NULL, web_server_str_body_handler);
-  wsrv->on(p_valves_id, HTTP_POST, web_server_route_valves_activate);
-  wsrv->on(p_valves_id, HTTP_DELETE, web_server_route_valves_deactivate);
-  wsrv->on(p_valves_id, HTTP_OPTIONS, web_server_route_any_options);
-
-  // /valves/id/timer
-  const char *p_valves_id_timer = "^\\/api\\/valves\\/([0-9]+)\\/timer$";
-  wsrv->on(p_valves_id_timer, HTTP_POST, web_server_route_valves_timer_set, NULL, web_server_str_body_handler);
-  wsrv->on(p_valves_id_timer, HTTP_DELETE, web_server_route_valves_timer_clear);
-  wsrv->on(p_valves_id_timer, HTTP_OPTIONS, web_server_route_any_options);
+  const char *p_valves_id = "/api/valves/{int}";
+  web_server_router_on(p_valves_id, HTTP_PUT, web_server_route_valves_edit, web_server_json_body_handler, &valve_body);
+  web_server_router_on(p_valves_id, HTTP_POST, web_server_route_valves_activate);
+  web_server_router_on(p_valves_id, HTTP_DELETE, web_server_route_valves_deactivate);
+
+  // /valves/{id}/timer
+  const char *p_valves_id_timer = "/api/valves/{int}/timer";
+  web_server_router_on(p_valves_id_timer, HTTP_POST, web_server_route_valves_timer_set, web_server_json_body_handler, &timer_body);
+  web_server_router_on(p_valves_id_timer, HTTP_DELETE, web_server_route_valves_timer_clear);
 }
\ No newline at end of file
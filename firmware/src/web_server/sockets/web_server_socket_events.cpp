@@ -1,8 +1,1134 @@
 #include "web_server/sockets/web_server_socket_events.h"
+#include "scheduler.h"
 
 ENUM_LUT_FULL_IMPL(web_socket_event, _EVALS_WEB_SERVER_SOCKET_EVENT);
 
+/**
+ * @brief Layout of an event's parameters
+ */
+typedef enum web_server_socket_event_shape
+{
+  WSE_SHAPE_NONE,                   // No parameters
+  WSE_SHAPE_INDEX,                  // <index>
+  WSE_SHAPE_DAY,                    // <day>
+  WSE_SHAPE_DAY_INDEX,              // <day><index>
+  WSE_SHAPE_DAY_INDEX_TIME,         // <day><index><time>
+  WSE_SHAPE_DAY_INDEX_IDENTIFIER,   // <day><index><identifier>
+  WSE_SHAPE_INDEX_ALIAS,            // <index><alias>
+  WSE_SHAPE_INDEX_TIME,             // <index><time>
+  WSE_SHAPE_EPOCH                   // <epoch>, taken from this boot rather than the event
+} web_server_socket_event_shape_t;
+
+typedef struct web_server_socket_events_client
+{
+  bool used;                        // Whether this slot is in use
+  uint32_t id;                      // Id of the websocket client
+  bool binary;                      // Whether the client negotiated binary framing
+  uint8_t topics;                   // Subscribed topics, see web_server_socket_event_topic_t
+  uint32_t valves;                  // Bit per subscribed valve id
+
+  // Events held back while the client's queue is full, at most one per coalescing key
+  web_server_socket_event_t staged[WEB_SERVER_SOCKET_EVENT_STAGING_LEN];
+  uint8_t num_staged;
+  bool resync;                      // Whether staged events have been lost and the client needs to resync
+
+  int64_t last_ping_us;             // When the client has last been pinged, or connected
+  int64_t ping_sent_us;             // When the outstanding ping has been sent, zero if there's none
+  uint32_t rtt_us;                  // Latest round trip time
+} web_server_socket_events_client_t;
+
 static AsyncWebSocket ws(WEB_SERVER_SOCKET_EVENT_PATH);
+static AsyncEventSource sse(WEB_SERVER_SOCKET_EVENT_SSE_PATH);
+
+// Connected clients and their negotiated options
+static web_server_socket_events_client_t clients[WEB_SERVER_SOCKET_EVENT_MAX_CLIENTS];
+
+// Replay ring, the event with sequence number n lives at n % WEB_SERVER_SOCKET_EVENT_REPLAY_LEN
+static web_server_socket_event_t replay[WEB_SERVER_SOCKET_EVENT_REPLAY_LEN];
+static uint32_t last_seq = 0;
+
+// Random number picked at boot, as sequence numbers of different boots would overlap
+static uint32_t epoch = 0;
+
+static web_server_socket_events_stats_t stats;
+
+// Events are sent by the publisher as well as replayed on connect, this keeps their order intact on the wire
+static SemaphoreHandle_t events_lock = NULL;
+
+// Replays from before this sequence number are incomplete, as events have been dropped
+static uint32_t replay_floor = 0;
+
+// Scratch buffers batches are dequeued and encoded into, guarded by the lock
+static web_server_socket_event_t pending[WEB_SERVER_SOCKET_EVENT_BATCH_LEN];
+static uint8_t batch_buf[WEB_SERVER_SOCKET_EVENT_BATCH_LEN * WEB_SERVER_SOCKET_EVENT_MSG_MAXLEN];
+
+typedef struct web_server_socket_events_queue_slot
+{
+  uint32_t turn;                    // Position this slot is free at, or that position plus one once filled
+  web_server_socket_event_t ev;     // Queued event
+} web_server_socket_events_queue_slot_t;
+
+static_assert(
+  (WEB_SERVER_SOCKET_EVENT_QUEUE_LEN & (WEB_SERVER_SOCKET_EVENT_QUEUE_LEN - 1)) == 0,
+  "The event queue length has to be a power of two"
+);
+
+// Events waiting to be published, see web_server_socket_events_enqueue
+static web_server_socket_events_queue_slot_t queue[WEB_SERVER_SOCKET_EVENT_QUEUE_LEN];
+static uint32_t queue_head = 0;     // Next position to be claimed by a producer
+static uint32_t queue_tail = 0;     // Next position to be consumed, under the lock
+static bool queue_overflowed = false;
+
+static TaskHandle_t publisher = NULL;
+
+/*
+============================================================================
+                               Subscriptions                                
+============================================================================
+*/
+
+INLINED static uint8_t web_server_socket_events_topic(web_socket_event_t type)
+{
+  switch (type)
+  {
+    case WSE_VALVE_ON:
+    case WSE_VALVE_OFF:
+    case WSE_VALVE_RENAME:
+    case WSE_VALVE_DISABLE_ON:
+    case WSE_VALVE_DISABLE_OFF:
+      return WSE_TOPIC_VALVES;
+
+    case WSE_VALVE_TIMER_UPDATED:
+      return WSE_TOPIC_TIMERS;
+
+    case WSE_DAY_DISABLE_ON:
+    case WSE_DAY_DISABLE_OFF:
+    case WSE_INTERVAL_DISABLE_ON:
+    case WSE_INTERVAL_DISABLE_OFF:
+    case WSE_INTERVAL_START_CHANGE:
+    case WSE_INTERVAL_END_CHANGE:
+    case WSE_INTERVAL_IDENTIFIER_CHANGE:
+    case WSE_INTERVAL_DELETED:
+      return WSE_TOPIC_SCHEDULE;
+
+    case WSE_INTERVAL_SCHED_ON:
+    case WSE_INTERVAL_SCHED_OFF:
+      return WSE_TOPIC_INTERVALS;
+
+    // Not subject to subscriptions
+    default:
+      return WSE_TOPIC_ALL;
+  }
+}
+
+/**
+ * @brief Check whether a client subscribed to an event, which boils down to two mask tests
+ */
+INLINED static bool web_server_socket_events_subscribed(web_server_socket_events_client_t *cl, const web_server_socket_event_t *ev)
+{
+  uint8_t topic = web_server_socket_events_topic(ev->type);
+  if (!(cl->topics & topic))
+    return false;
+
+  // The index of valve events is the valve's id
+  if (topic == WSE_TOPIC_VALVES || topic == WSE_TOPIC_TIMERS)
+    return ev->index < 32 && (cl->valves & (1UL << ev->index));
+
+  return true;
+}
+
+/**
+ * @brief Parse a subscription mask from a decimal string
+ */
+INLINED static bool web_server_socket_events_parse_mask(const char *str, uint32_t *mask)
+{
+  long mask_l;
+  if (longp(&mask_l, str, 10) != LONGP_SUCCESS || mask_l < 0)
+    return false;
+
+  *mask = (uint32_t) mask_l;
+  return true;
+}
+
+/*
+============================================================================
+                                  Encoding                                  
+============================================================================
+*/
+
+INLINED static web_server_socket_event_shape_t web_server_socket_events_shape(web_socket_event_t type)
+{
+  switch (type)
+  {
+    case WSE_INTERVAL_SCHED_ON:
+    case WSE_INTERVAL_SCHED_OFF:
+    case WSE_VALVE_ON:
+    case WSE_VALVE_OFF:
+    case WSE_VALVE_DISABLE_ON:
+    case WSE_VALVE_DISABLE_OFF:
+      return WSE_SHAPE_INDEX;
+
+    case WSE_DAY_DISABLE_ON:
+    case WSE_DAY_DISABLE_OFF:
+      return WSE_SHAPE_DAY;
+
+    case WSE_INTERVAL_DISABLE_ON:
+    case WSE_INTERVAL_DISABLE_OFF:
+    case WSE_INTERVAL_DELETED:
+      return WSE_SHAPE_DAY_INDEX;
+
+    case WSE_INTERVAL_START_CHANGE:
+    case WSE_INTERVAL_END_CHANGE:
+      return WSE_SHAPE_DAY_INDEX_TIME;
+
+    case WSE_INTERVAL_IDENTIFIER_CHANGE:
+      return WSE_SHAPE_DAY_INDEX_IDENTIFIER;
+
+    case WSE_VALVE_RENAME:
+      return WSE_SHAPE_INDEX_ALIAS;
+
+    case WSE_VALVE_TIMER_UPDATED:
+      return WSE_SHAPE_INDEX_TIME;
+
+    case WSE_EPOCH:
+      return WSE_SHAPE_EPOCH;
+
+    default:
+      return WSE_SHAPE_NONE;
+  }
+}
+
+/**
+ * @brief Serialize an event into it's text framing
+ * 
+ * @return size_t Length of the message, without terminator
+ */
+static size_t web_server_socket_events_encode_text(const web_server_socket_event_t *ev, char *buf)
+{
+  const char *type = web_socket_event_name(ev->type);
+  const char *day = scheduler_weekday_name((scheduler_weekday_t) ev->day);
+
+  char time[SCHEDULER_TIME_STRLEN];
+  scheduler_time_stringify_buf(&(ev->time), time);
+
+  size_t n = WEB_SERVER_SOCKET_EVENT_MSG_MAXLEN;
+  int len = 0;
+
+  switch (web_server_socket_events_shape(ev->type))
+  {
+    case WSE_SHAPE_INDEX:
+      len = snprintf(buf, n, "%" PRIu32 ";%s;%u", ev->seq, type, ev->index);
+      break;
+
+    case WSE_SHAPE_DAY:
+      len = snprintf(buf, n, "%" PRIu32 ";%s;%s", ev->seq, type, day);
+      break;
+
+    case WSE_SHAPE_DAY_INDEX:
+      len = snprintf(buf, n, "%" PRIu32 ";%s;%s;%u", ev->seq, type, day, ev->index);
+      break;
+
+    case WSE_SHAPE_DAY_INDEX_TIME:
+      len = snprintf(buf, n, "%" PRIu32 ";%s;%s;%u;%s", ev->seq, type, day, ev->index, time);
+      break;
+
+    case WSE_SHAPE_DAY_INDEX_IDENTIFIER:
+      len = snprintf(buf, n, "%" PRIu32 ";%s;%s;%u;%u", ev->seq, type, day, ev->index, ev->identifier);
+      break;
+
+    case WSE_SHAPE_INDEX_ALIAS:
+      len = snprintf(buf, n, "%" PRIu32 ";%s;%u;%.*s", ev->seq, type, ev->index, WEB_SERVER_SOCKET_EVENT_ALIAS_MAXLEN, ev->alias);
+      break;
+
+    case WSE_SHAPE_INDEX_TIME:
+      len = snprintf(buf, n, "%" PRIu32 ";%s;%u;%s", ev->seq, type, ev->index, time);
+      break;
+
+    case WSE_SHAPE_EPOCH:
+      len = snprintf(buf, n, "%" PRIu32 ";%s;%" PRIu32, ev->seq, type, epoch);
+      break;
+
+    case WSE_SHAPE_NONE:
+      len = snprintf(buf, n, "%" PRIu32 ";%s;", ev->seq, type);
+      break;
+  }
+
+  // All parameters are bounded, so this can only be hit if the limits don't add up
+  if (len >= (int) n)
+  {
+    dbgerr("Event %s exceeded the maximum event length!", type);
+    len = n - 1;
+  }
+
+  return len;
+}
+
+INLINED static size_t web_server_socket_events_put_u32(uint8_t *buf, uint32_t value)
+{
+  buf[0] = value & 0xFF;
+  buf[1] = (value >> 8) & 0xFF;
+  buf[2] = (value >> 16) & 0xFF;
+  buf[3] = (value >> 24) & 0xFF;
+  return 4;
+}
+
+INLINED static size_t web_server_socket_events_put_time(uint8_t *buf, const scheduler_time_t *time)
+{
+  uint32_t secs = time->hours * 3600UL + time->minutes * 60UL + time->seconds;
+  return web_server_socket_events_put_u32(buf, secs);
+}
+
+/**
+ * @brief Serialize an event into it's binary framing
+ * 
+ * @return size_t Length of the message
+ */
+static size_t web_server_socket_events_encode_binary(const web_server_socket_event_t *ev, uint8_t *buf)
+{
+  size_t len = 0;
+  buf[len++] = (uint8_t) ev->type;
+  len += web_server_socket_events_put_u32(&buf[len], ev->seq);
+
+  switch (web_server_socket_events_shape(ev->type))
+  {
+    case WSE_SHAPE_INDEX:
+      buf[len++] = ev->index;
+      break;
+
+    case WSE_SHAPE_DAY:
+      buf[len++] = ev->day;
+      break;
+
+    case WSE_SHAPE_DAY_INDEX:
+      buf[len++] = ev->day;
+      buf[len++] = ev->index;
+      break;
+
+    case WSE_SHAPE_DAY_INDEX_TIME:
+      buf[len++] = ev->day;
+      buf[len++] = ev->index;
+      len += web_server_socket_events_put_time(&buf[len], &(ev->time));
+      break;
+
+    case WSE_SHAPE_DAY_INDEX_IDENTIFIER:
+      buf[len++] = ev->day;
+      buf[len++] = ev->index;
+      buf[len++] = ev->identifier;
+      break;
+
+    case WSE_SHAPE_INDEX_ALIAS:
+    {
+      size_t alias_len = strnlen(ev->alias, WEB_SERVER_SOCKET_EVENT_ALIAS_MAXLEN);
+      buf[len++] = ev->index;
+      buf[len++] = (uint8_t) alias_len;
+      memcpy(&buf[len], ev->alias, alias_len);
+      len += alias_len;
+      break;
+    }
+
+    case WSE_SHAPE_INDEX_TIME:
+      buf[len++] = ev->index;
+      len += web_server_socket_events_put_time(&buf[len], &(ev->time));
+      break;
+
+    case WSE_SHAPE_EPOCH:
+      len += web_server_socket_events_put_u32(&buf[len], epoch);
+      break;
+
+    case WSE_SHAPE_NONE:
+      break;
+  }
+
+  return len;
+}
+
+/**
+ * @brief Send an event to a single client, using the framing it negotiated
+ */
+static void web_server_socket_events_send(AsyncWebSocketClient *client, bool binary, const web_server_socket_event_t *ev)
+{
+  if (binary)
+  {
+    uint8_t buf[WEB_SERVER_SOCKET_EVENT_BIN_MAXLEN];
+    size_t len = web_server_socket_events_encode_binary(ev, buf);
+    client->binary(buf, len);
+    return;
+  }
+
+  char buf[WEB_SERVER_SOCKET_EVENT_MSG_MAXLEN];
+  size_t len = web_server_socket_events_encode_text(ev, buf);
+  client->binary(buf, len);
+}
+
+/**
+ * @brief Encode all events of a batch a client is subscribed to into a single
+ * refcounted message buffer, which can be queued for any number of clients with
+ * the same framing and subscriptions without being copied again, expects the lock to be held
+ * 
+ * @return AsyncWebSocketMessageBuffer* Locked buffer, NULL if there's nothing to send or out of memory
+ */
+static AsyncWebSocketMessageBuffer *web_server_socket_events_make_batch(
+  web_server_socket_events_client_t *cl,
+  const web_server_socket_event_t *batch,
+  size_t num_events
+)
+{
+  size_t len = 0;
+  for (size_t i = 0; i < num_events; i++)
+  {
+    if (!web_server_socket_events_subscribed(cl, &(batch[i])))
+      continue;
+
+    if (cl->binary)
+    {
+      len += web_server_socket_events_encode_binary(&(batch[i]), &batch_buf[len]);
+      continue;
+    }
+
+    // Text framed events are separated by line breaks
+    if (len > 0)
+      batch_buf[len++] = '\n';
+    len += web_server_socket_events_encode_text(&(batch[i]), (char *) &batch_buf[len]);
+  }
+
+  if (len == 0)
+    return NULL;
+
+  AsyncWebSocketMessageBuffer *buf = ws.makeBuffer(batch_buf, len);
+  if (!buf)
+  {
+    dbgerr("Could not allocate a message buffer for a batch of %lu events!", (unsigned long) num_events);
+    return NULL;
+  }
+
+  // Keep the buffer alive until all clients have been handed a reference
+  buf->lock();
+  stats.buffers++;
+  return buf;
+}
+
+/*
+============================================================================
+                                  Staging                                   
+============================================================================
+*/
+
+/*
+  The async websocket library closes clients whose queue overflows, so events
+  for a client with a full queue are staged instead. Events which describe the
+  latest state of something (a valve being on, it's timer, ...) replace older
+  staged events of the same key, as only the final state matters. Edits can't
+  be coalesced, so staging one of them - or running out of staging slots -
+  drops everything staged in favor of a single WSE_RESYNC_REQUIRED.
+*/
+
+/**
+ * @brief Get the coalescing class of an event type, events of the same class
+ * and index supersede each other
+ * 
+ * @return int Class, -1 if the event can't be coalesced
+ */
+INLINED static int web_server_socket_events_coalesce_class(web_socket_event_t type)
+{
+  switch (type)
+  {
+    case WSE_VALVE_ON:
+    case WSE_VALVE_OFF:
+      return 0;
+
+    case WSE_VALVE_DISABLE_ON:
+    case WSE_VALVE_DISABLE_OFF:
+      return 1;
+
+    case WSE_VALVE_RENAME:
+      return 2;
+
+    case WSE_VALVE_TIMER_UPDATED:
+      return 3;
+
+    case WSE_INTERVAL_SCHED_ON:
+    case WSE_INTERVAL_SCHED_OFF:
+      return 4;
+
+    default:
+      return -1;
+  }
+}
+
+/**
+ * @brief Stage an event for a client which can't take it right now, expects the lock to be held
+ */
+static void web_server_socket_events_stage(web_server_socket_events_client_t *cl, const web_server_socket_event_t *ev)
+{
+  // Everything staged will be replaced by a resync anyways
+  if (cl->resync)
+    return;
+
+  int cls = web_server_socket_events_coalesce_class(ev->type);
+  if (cls >= 0)
+  {
+    // Supersede the older state of the same key
+    for (size_t i = 0; i < cl->num_staged; i++)
+    {
+      web_server_socket_event_t *staged = &(cl->staged[i]);
+      if (web_server_socket_events_coalesce_class(staged->type) == cls && staged->index == ev->index)
+      {
+        *staged = *ev;
+        stats.coalesced++;
+        return;
+      }
+    }
+
+    if (cl->num_staged < WEB_SERVER_SOCKET_EVENT_STAGING_LEN)
+    {
+      cl->staged[cl->num_staged++] = *ev;
+      stats.staged++;
+      return;
+    }
+  }
+
+  // Lost track of the client's state
+  cl->num_staged = 0;
+  cl->resync = true;
+  stats.resyncs++;
+}
+
+/**
+ * @brief Send as many staged events as the client's queue takes, in order of
+ * their sequence numbers, expects the lock to be held
+ */
+static void web_server_socket_events_flush(AsyncWebSocketClient *client, web_server_socket_events_client_t *cl)
+{
+  if (cl->resync)
+  {
+    if (client->queueIsFull())
+      return;
+
+    web_server_socket_event_t resync = { .type = WSE_RESYNC_REQUIRED, .seq = last_seq };
+    web_server_socket_events_send(client, cl->binary, &resync);
+    cl->resync = false;
+  }
+
+  while (cl->num_staged > 0 && !client->queueIsFull())
+  {
+    // Clients drop events which are older than the latest they've seen
+    size_t oldest = 0;
+    for (size_t i = 1; i < cl->num_staged; i++)
+    {
+      if (cl->staged[i].seq < cl->staged[oldest].seq)
+        oldest = i;
+    }
+
+    web_server_socket_events_send(client, cl->binary, &(cl->staged[oldest]));
+    cl->staged[oldest] = cl->staged[--cl->num_staged];
+  }
+}
+
+/**
+ * @brief Whether events for a client have to be staged, as it's queue is full or
+ * older events are still waiting, expects the lock to be held
+ */
+INLINED static bool web_server_socket_events_must_stage(AsyncWebSocketClient *client, web_server_socket_events_client_t *cl)
+{
+  if (cl->resync || cl->num_staged > 0)
+    web_server_socket_events_flush(client, cl);
+
+  return cl->resync || cl->num_staged > 0 || client->queueIsFull();
+}
+
+/*
+============================================================================
+                                  Clients                                   
+============================================================================
+*/
+
+INLINED static web_server_socket_events_client_t *web_server_socket_events_find_client(uint32_t id)
+{
+  for (size_t i = 0; i < WEB_SERVER_SOCKET_EVENT_MAX_CLIENTS; i++)
+  {
+    if (clients[i].used && clients[i].id == id)
+      return &(clients[i]);
+  }
+
+  return NULL;
+}
+
+INLINED static web_server_socket_events_client_t *web_server_socket_events_alloc_client(uint32_t id)
+{
+  for (size_t i = 0; i < WEB_SERVER_SOCKET_EVENT_MAX_CLIENTS; i++)
+  {
+    if (clients[i].used)
+      continue;
+
+    memset(&(clients[i]), 0, sizeof(web_server_socket_events_client_t));
+    clients[i].used = true;
+    clients[i].id = id;
+    clients[i].topics = WSE_TOPIC_ALL;
+    clients[i].valves = WEB_SERVER_SOCKET_EVENT_VALVES_ALL;
+    return &(clients[i]);
+  }
+
+  return NULL;
+}
+
+/**
+ * @brief Apply the initial subscription masks passed as query parameters, if any
+ */
+INLINED static void web_server_socket_events_parse_subscription(web_server_socket_events_client_t *cl, AsyncWebServerRequest *request)
+{
+  if (!request)
+    return;
+
+  uint32_t mask;
+  if (request->hasParam(WEB_SERVER_SOCKET_EVENT_TOPICS_PARAM))
+  {
+    if (web_server_socket_events_parse_mask(request->getParam(WEB_SERVER_SOCKET_EVENT_TOPICS_PARAM)->value().c_str(), &mask))
+      cl->topics = (uint8_t) mask;
+  }
+
+  if (request->hasParam(WEB_SERVER_SOCKET_EVENT_VALVES_PARAM))
+  {
+    if (web_server_socket_events_parse_mask(request->getParam(WEB_SERVER_SOCKET_EVENT_VALVES_PARAM)->value().c_str(), &mask))
+      cl->valves = mask;
+  }
+}
+
+INLINED static bool web_server_socket_events_wants_binary(AsyncWebServerRequest *request)
+{
+  if (!request || !request->hasHeader("Sec-WebSocket-Protocol"))
+    return false;
+
+  // The protocol header is echoed back as is, so it has to be the only one requested
+  return request->header("Sec-WebSocket-Protocol") == WEB_SERVER_SOCKET_EVENT_PROTO_BIN;
+}
+
+/*
+============================================================================
+                                   Replay                                   
+============================================================================
+*/
+
+/**
+ * @brief Sequence number of the oldest event still held by the replay ring
+ */
+INLINED static uint32_t web_server_socket_events_oldest_seq()
+{
+  uint32_t oldest = 1;
+  if (last_seq >= WEB_SERVER_SOCKET_EVENT_REPLAY_LEN)
+    oldest = last_seq - WEB_SERVER_SOCKET_EVENT_REPLAY_LEN + 1;
+
+  // Events before the floor might have been dropped
+  if (oldest <= replay_floor)
+    oldest = replay_floor + 1;
+
+  return oldest;
+}
+
+/**
+ * @brief Whether all events after a given sequence number of a given epoch are
+ * still held by the replay ring, expects the lock to be held
+ */
+INLINED static bool web_server_socket_events_can_replay(uint32_t since_epoch, uint32_t since)
+{
+  // The client's numbers stem from before a reboot
+  if (since_epoch != epoch)
+    return false;
+
+  return since <= last_seq && since + 1 >= web_server_socket_events_oldest_seq();
+}
+
+/**
+ * @brief Send all events after a given sequence number to a reconnecting client,
+ * or tell it to resync if they're not available anymore, expects the lock to be held
+ */
+static void web_server_socket_events_replay(AsyncWebSocketClient *client, web_server_socket_events_client_t *cl, uint32_t since_epoch, uint32_t since)
+{
+  bool binary = cl->binary;
+
+  if (!web_server_socket_events_can_replay(since_epoch, since))
+  {
+    web_server_socket_event_t resync = { .type = WSE_RESYNC_REQUIRED, .seq = last_seq };
+    web_server_socket_events_send(client, binary, &resync);
+    return;
+  }
+
+  for (uint32_t seq = since + 1; seq <= last_seq; seq++)
+  {
+    web_server_socket_event_t *ev = &(replay[seq % WEB_SERVER_SOCKET_EVENT_REPLAY_LEN]);
+    if (!web_server_socket_events_subscribed(cl, ev))
+      continue;
+
+    // Long replays may exceed the client's queue
+    if (web_server_socket_events_must_stage(client, cl))
+      web_server_socket_events_stage(cl, ev);
+    else
+      web_server_socket_events_send(client, binary, ev);
+  }
+}
+
+/**
+ * @brief Parse the epoch and sequence number a client wants to be caught up from
+ * 
+ * @return true The client reconnected and requested a replay
+ * @return false Fresh connection, nothing to catch up on
+ */
+INLINED static bool web_server_socket_events_parse_since(AsyncWebServerRequest *request, uint32_t *since_epoch, uint32_t *since)
+{
+  if (!request || !request->hasParam(WEB_SERVER_SOCKET_EVENT_SINCE_PARAM))
+    return false;
+
+  const char *since_str = request->getParam(WEB_SERVER_SOCKET_EVENT_SINCE_PARAM)->value().c_str();
+  const char *delim = strchr(since_str, ':');
+
+  // Lacks the epoch, so there's no telling which boot the number stems from
+  if (!delim)
+  {
+    *since_epoch = UINT32_MAX;
+    *since = 0;
+    return true;
+  }
+
+  char epoch_str[12];
+  size_t epoch_len = delim - since_str;
+  if (epoch_len >= sizeof(epoch_str))
+  {
+    dbgerr("Invalid event epoch to replay from (%s)!", since_str);
+    return false;
+  }
+
+  memcpy(epoch_str, since_str, epoch_len);
+  epoch_str[epoch_len] = 0;
+
+  long epoch_l, since_l;
+  if (
+    longp(&epoch_l, epoch_str, 10) != LONGP_SUCCESS || epoch_l < 0
+    || longp(&since_l, delim + 1, 10) != LONGP_SUCCESS || since_l < 0
+  )
+  {
+    dbgerr("Invalid event sequence number to replay from (%s)!", since_str);
+    return false;
+  }
+
+  *since_epoch = (uint32_t) epoch_l;
+  *since = (uint32_t) since_l;
+  return true;
+}
+
+/*
+============================================================================
+                             Server-sent events                             
+============================================================================
+*/
+
+/**
+ * @brief Pack the epoch and sequence number into a numeric SSE id, see web_server_socket_events.h
+ */
+INLINED static uint32_t web_server_socket_events_sse_id(uint32_t seq)
+{
+  return (epoch << 16) | (seq & 0xFFFF);
+}
+
+/**
+ * @brief Send an event to a single server-sent events client, or to all of them
+ * 
+ * @param client Target client, NULL to send to every connected client
+ */
+static void web_server_socket_events_sse_send(AsyncEventSourceClient *client, const web_server_socket_event_t *ev)
+{
+  char msg[WEB_SERVER_SOCKET_EVENT_MSG_MAXLEN];
+  web_server_socket_events_encode_text(ev, msg);
+  const char *name = web_socket_event_name(ev->type);
+
+  uint32_t id = web_server_socket_events_sse_id(ev->seq);
+  if (client)
+    client->send(msg, name, id);
+  else
+    sse.send(msg, name, id);
+}
+
+/**
+ * @brief Catch up a server-sent events client which reconnected with a Last-Event-ID
+ */
+static void web_server_socket_events_sse_on_connect(AsyncEventSourceClient *client)
+{
+  uint32_t id = client->lastId();
+
+  // Fresh connection, nothing to catch up on
+  if (id == 0)
+    return;
+
+  xSemaphoreTake(events_lock, portMAX_DELAY);
+
+  // Only the lower bits of the sequence number are carried, the client can't be further behind than the replay ring anyways
+  uint32_t since = last_seq - ((last_seq - id) & 0xFFFF);
+
+  if (!web_server_socket_events_can_replay(id >> 16, since))
+  {
+    web_server_socket_event_t resync = { .type = WSE_RESYNC_REQUIRED, .seq = last_seq };
+    web_server_socket_events_sse_send(client, &resync);
+  }
+  else
+  {
+    for (uint32_t seq = since + 1; seq <= last_seq; seq++)
+      web_server_socket_events_sse_send(client, &(replay[seq % WEB_SERVER_SOCKET_EVENT_REPLAY_LEN]));
+  }
+
+  xSemaphoreGive(events_lock);
+}
+
+/*
+============================================================================
+                                Publication                                 
+============================================================================
+*/
+
+/*
+  Producers (the scheduler tick, request handlers) never touch the network,
+  they only push events into a bounded lock-free multi-producer single-consumer
+  ring. Every slot carries a turn, which tells whether it's free for a producer
+  at a given position or filled and ready for the publisher. The publisher task
+  drains the ring whenever it's woken up and sends all events that accumulated
+  as one frame per client.
+*/
+
+/**
+ * @brief Push an event into the queue, safe to be called from any task
+ * 
+ * @return true The event has been queued
+ * @return false The queue is full
+ */
+static bool web_server_socket_events_enqueue(const web_server_socket_event_t *ev)
+{
+  uint32_t pos = __atomic_load_n(&queue_head, __ATOMIC_RELAXED);
+
+  while (true)
+  {
+    web_server_socket_events_queue_slot_t *slot = &(queue[pos % WEB_SERVER_SOCKET_EVENT_QUEUE_LEN]);
+    uint32_t turn = __atomic_load_n(&(slot->turn), __ATOMIC_ACQUIRE);
+    int32_t diff = (int32_t) (turn - pos);
+
+    // Slot is free, try to claim the position, a failed exchange reloads pos
+    if (diff == 0)
+    {
+      if (!__atomic_compare_exchange_n(&queue_head, &pos, pos + 1, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+        continue;
+
+      slot->ev = *ev;
+      __atomic_store_n(&(slot->turn), pos + 1, __ATOMIC_RELEASE);
+      return true;
+    }
+
+    // The publisher didn't consume this slot's previous lap yet
+    if (diff < 0)
+      return false;
+
+    // Another producer claimed this position in the meantime
+    pos = __atomic_load_n(&queue_head, __ATOMIC_RELAXED);
+  }
+}
+
+/**
+ * @brief Pop the oldest event off the queue, expects the lock to be held, as there may only be one consumer at a time
+ * 
+ * @return true An event has been popped
+ * @return false The queue is empty
+ */
+static bool web_server_socket_events_dequeue(web_server_socket_event_t *ev)
+{
+  web_server_socket_events_queue_slot_t *slot = &(queue[queue_tail % WEB_SERVER_SOCKET_EVENT_QUEUE_LEN]);
+  if (__atomic_load_n(&(slot->turn), __ATOMIC_ACQUIRE) != queue_tail + 1)
+    return false;
+
+  *ev = slot->ev;
+
+  // Hand the slot to the producer of the next lap
+  __atomic_store_n(&(slot->turn), queue_tail + WEB_SERVER_SOCKET_EVENT_QUEUE_LEN, __ATOMIC_RELEASE);
+  queue_tail++;
+  return true;
+}
+
+/**
+ * @brief Whether two clients receive exactly the same frames
+ */
+INLINED static bool web_server_socket_events_same_frames(web_server_socket_events_client_t *a, web_server_socket_events_client_t *b)
+{
+  return a->binary == b->binary && a->topics == b->topics && a->valves == b->valves;
+}
+
+/**
+ * @brief Stamp a batch of events, remember them for replays and send them to
+ * all subscribed clients, expects the lock to be held
+ */
+static void web_server_socket_events_publish_batch(web_server_socket_event_t *batch, size_t num_events)
+{
+  int64_t start_us = esp_timer_get_time();
+
+  for (size_t i = 0; i < num_events; i++)
+  {
+    batch[i].seq = ++last_seq;
+    replay[last_seq % WEB_SERVER_SOCKET_EVENT_REPLAY_LEN] = batch[i];
+  }
+
+  // Frame per client, shared with all later clients that receive the same one
+  AsyncWebSocketMessageBuffer *shared[WEB_SERVER_SOCKET_EVENT_MAX_CLIENTS] = { NULL };
+
+  for (size_t i = 0; i < WEB_SERVER_SOCKET_EVENT_MAX_CLIENTS; i++)
+  {
+    web_server_socket_events_client_t *cl = &(clients[i]);
+    if (!cl->used)
+      continue;
+
+    AsyncWebSocketClient *client = ws.client(cl->id);
+    if (!client || client->status() != WS_CONNECTED)
+      continue;
+
+    // Never block on or overflow a slow client, only it's latest state is kept
+    if (web_server_socket_events_must_stage(client, cl))
+    {
+      for (size_t j = 0; j < num_events; j++)
+      {
+        if (web_server_socket_events_subscribed(cl, &(batch[j])))
+          web_server_socket_events_stage(cl, &(batch[j]));
+      }
+      continue;
+    }
+
+    AsyncWebSocketMessageBuffer *frame = NULL;
+    for (size_t j = 0; j < i && !frame; j++)
+    {
+      if (shared[j] && web_server_socket_events_same_frames(&(clients[j]), cl))
+        frame = shared[j];
+    }
+
+    if (!frame)
+      frame = shared[i] = web_server_socket_events_make_batch(cl, batch, num_events);
+
+    if (frame)
+      client->binary(frame);
+  }
+
+  // Release the buffers to the client queues, which free them once everything has been sent
+  for (size_t i = 0; i < WEB_SERVER_SOCKET_EVENT_MAX_CLIENTS; i++)
+  {
+    if (shared[i])
+      shared[i]->unlock();
+  }
+
+  ws._cleanBuffers();
+
+  // Server-sent events have no subscriptions and are encoded per message by the library
+  if (sse.count() > 0)
+  {
+    for (size_t i = 0; i < num_events; i++)
+      web_server_socket_events_sse_send(NULL, &(batch[i]));
+  }
+
+  uint32_t took_us = (uint32_t) (esp_timer_get_time() - start_us);
+  stats.broadcasts += num_events;
+  stats.batches++;
+  stats.total_us += took_us;
+  if (took_us > stats.max_us)
+    stats.max_us = took_us;
+}
+
+/**
+ * @brief Tell all clients to resync after events have been dropped, expects the lock to be held
+ */
+static void web_server_socket_events_resync_all()
+{
+  replay_floor = last_seq;
+
+  for (size_t i = 0; i < WEB_SERVER_SOCKET_EVENT_MAX_CLIENTS; i++)
+  {
+    web_server_socket_events_client_t *cl = &(clients[i]);
+    if (!cl->used)
+      continue;
+
+    cl->num_staged = 0;
+    cl->resync = true;
+    stats.resyncs++;
+
+    AsyncWebSocketClient *client = ws.client(cl->id);
+    if (client && client->status() == WS_CONNECTED)
+      web_server_socket_events_flush(client, cl);
+  }
+}
+
+/**
+ * @brief Publish everything that's queued in batches, expects the lock to be held
+ */
+static void web_server_socket_events_drain()
+{
+  while (true)
+  {
+    size_t num_events = 0;
+    while (num_events < WEB_SERVER_SOCKET_EVENT_BATCH_LEN && web_server_socket_events_dequeue(&(pending[num_events])))
+      num_events++;
+
+    bool overflowed = __atomic_exchange_n(&queue_overflowed, false, __ATOMIC_ACQ_REL);
+    if (num_events == 0 && !overflowed)
+      break;
+
+    if (num_events > 0)
+      web_server_socket_events_publish_batch(pending, num_events);
+
+    if (overflowed)
+      web_server_socket_events_resync_all();
+  }
+}
+
+static void web_server_socket_events_publisher_task(void *arg)
+{
+  while (true)
+  {
+    // Woken up after every tick, handler events are picked up by the next one at the latest
+    ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(WEB_SERVER_SOCKET_EVENT_PUBLISH_INTERVAL_MS));
+
+    xSemaphoreTake(events_lock, portMAX_DELAY);
+    web_server_socket_events_drain();
+    xSemaphoreGive(events_lock);
+  }
+}
+
+/*
+============================================================================
+                                 Heartbeat                                  
+============================================================================
+*/
+
+/**
+ * @brief Ping a client if it's due, expects the lock to be held
+ * 
+ * @return true The client didn't answer it's last ping in time and has to be evicted
+ * @return false The client is alive
+ */
+static bool web_server_socket_events_heartbeat(AsyncWebSocketClient *client, web_server_socket_events_client_t *cl, int64_t now_us)
+{
+  // Waiting for the pong
+  if (cl->ping_sent_us != 0)
+    return now_us - cl->ping_sent_us >= WEB_SERVER_SOCKET_EVENT_PONG_TIMEOUT_MS * 1000LL;
+
+  if (now_us - cl->last_ping_us < WEB_SERVER_SOCKET_EVENT_PING_INTERVAL_MS * 1000LL)
+    return false;
+
+  cl->last_ping_us = now_us;
+  cl->ping_sent_us = now_us;
+  client->ping();
+  return false;
+}
+
+/*
+============================================================================
+                                  Handling                                  
+============================================================================
+*/
+
+static void web_server_socket_events_on_connect(AsyncWebSocketClient *client, AsyncWebServerRequest *request)
+{
+  xSemaphoreTake(events_lock, portMAX_DELAY);
+
+  web_server_socket_events_client_t *slot = web_server_socket_events_alloc_client(client->id());
+  if (!slot)
+  {
+    xSemaphoreGive(events_lock);
+    dbgerr("No event client slots remaining, rejecting client %" PRIu32 "!", client->id());
+    client->close();
+    return;
+  }
+
+  slot->last_ping_us = esp_timer_get_time();
+  slot->binary = web_server_socket_events_wants_binary(request);
+  web_server_socket_events_parse_subscription(slot, request);
+
+  // Announce the epoch first, which the client has to reconnect with
+  web_server_socket_event_t hello = { .type = WSE_EPOCH, .seq = last_seq };
+  web_server_socket_events_send(client, slot->binary, &hello);
+
+  uint32_t since_epoch, since;
+  if (web_server_socket_events_parse_since(request, &since_epoch, &since))
+    web_server_socket_events_replay(client, slot, since_epoch, since);
+
+  xSemaphoreGive(events_lock);
+}
+
+/**
+ * @brief Handle a message received from a client, which is either a subscription
+ * change (sub;<topics>;<valves>) or a connection probe, anything else is ignored
+ */
+static void web_server_socket_events_on_data(AsyncWebSocketClient *client, AwsFrameInfo *info, uint8_t *data, size_t len)
+{
+  // Only short messages within a single frame are expected
+  if (!info->final || info->index != 0 || info->len != len || len >= WEB_SERVER_SOCKET_EVENT_RX_MAXLEN)
+    return;
+
+  char msg[WEB_SERVER_SOCKET_EVENT_RX_MAXLEN];
+  memcpy(msg, data, len);
+  msg[len] = 0;
+
+  // Connection probe, the reply is sent as text so it can't be confused with binary framed events
+  if (strcmp(msg, WEB_SERVER_SOCKET_EVENT_PROBE) == 0)
+  {
+    client->text(WEB_SERVER_SOCKET_EVENT_PROBE);
+    return;
+  }
+
+  size_t prefix_len = strlen(WEB_SERVER_SOCKET_EVENT_SUB_PREFIX);
+  if (strncmp(msg, WEB_SERVER_SOCKET_EVENT_SUB_PREFIX, prefix_len) != 0)
+    return;
+
+  // Split up the topics and valves masks
+  char *topics_str = &msg[prefix_len];
+  char *valves_str = strchr(topics_str, ';');
+  if (!valves_str)
+    return;
+  *(valves_str++) = 0;
+
+  uint32_t topics, valves;
+  if (
+    !web_server_socket_events_parse_mask(topics_str, &topics)
+    || !web_server_socket_events_parse_mask(valves_str, &valves)
+  )
+  {
+    dbgerr("Invalid event subscription received (%s;%s)!", topics_str, valves_str);
+    return;
+  }
+
+  xSemaphoreTake(events_lock, portMAX_DELAY);
+
+  web_server_socket_events_client_t *slot = web_server_socket_events_find_client(client->id());
+  if (slot)
+  {
+    slot->topics = (uint8_t) topics;
+    slot->valves = valves;
+  }
+
+  xSemaphoreGive(events_lock);
+}
+
+static void web_server_socket_events_on_pong(AsyncWebSocketClient *client)
+{
+  xSemaphoreTake(events_lock, portMAX_DELAY);
+
+  web_server_socket_events_client_t *slot = web_server_socket_events_find_client(client->id());
+  if (slot && slot->ping_sent_us != 0)
+  {
+    slot->rtt_us = (uint32_t) (esp_timer_get_time() - slot->ping_sent_us);
+    slot->ping_sent_us = 0;
+  }
+
+  xSemaphoreGive(events_lock);
+}
+
+static void web_server_socket_events_on_disconnect(AsyncWebSocketClient *client)
+{
+  xSemaphoreTake(events_lock, portMAX_DELAY);
+
+  web_server_socket_events_client_t *slot = web_server_socket_events_find_client(client->id());
+  if (slot)
+    slot->used = false;
+
+  xSemaphoreGive(events_lock);
+}
 
 static void onEvent(
   AsyncWebSocket *server,
@@ -13,17 +1139,32 @@ static void onEvent(
   size_t len
 ) {
   switch (type) {
-    // No data will ever be received, this is transmission-only
-    // Thus, just echo back what has been received - used for connection probing
+    // Clients only send subscriptions and connection probes
     case WS_EVT_DATA:
     {
-      client->binary(data, len);
+      web_server_socket_events_on_data(client, (AwsFrameInfo *) arg, data, len);
       break;
     }
 
+    // The upgrade request is passed along on connect
     case WS_EVT_CONNECT:
+    {
+      web_server_socket_events_on_connect(client, (AsyncWebServerRequest *) arg);
+      break;
+    }
+
     case WS_EVT_DISCONNECT:
+    {
+      web_server_socket_events_on_disconnect(client);
+      break;
+    }
+
     case WS_EVT_PONG:
+    {
+      web_server_socket_events_on_pong(client);
+      break;
+    }
+
     case WS_EVT_ERROR:
       break;
   }
@@ -31,19 +1172,207 @@ static void onEvent(
 
 void web_server_socket_events_init(AsyncWebServer *wsrv)
 {
+  events_lock = xSemaphoreCreateMutex();
+  epoch = esp_random() & ((1UL << WEB_SERVER_SOCKET_EVENT_EPOCH_BITS) - 1);
+
+  // Every slot starts out free for the first lap
+  for (size_t i = 0; i < WEB_SERVER_SOCKET_EVENT_QUEUE_LEN; i++)
+    queue[i].turn = i;
+
+  // Publish on core 1, next to the main loop which emits most events
+  xTaskCreatePinnedToCore(
+    web_server_socket_events_publisher_task,      // Task entry point
+    "wse_publisher",                              // Task name
+    WEB_SERVER_SOCKET_EVENT_PUBLISHER_STACK,      // Stack size
+    NULL,                                         // Parameter to the entry point
+    WEB_SERVER_SOCKET_EVENT_PUBLISHER_PRIO,       // Priority
+    &publisher,                                   // Task handle output, to notify it
+    1                                             // On core 1 (main loop)
+  );
+
   ws.onEvent(onEvent);
   wsrv->addHandler(&ws);
   dbginf("Started the websocket server for " WEB_SERVER_SOCKET_EVENT_PATH "!");
+
+  sse.onConnect(web_server_socket_events_sse_on_connect);
+  wsrv->addHandler(&sse);
+  dbginf("Started the server-sent events endpoint " WEB_SERVER_SOCKET_EVENT_SSE_PATH "!");
 }
 
 void web_server_socket_events_cleanup()
 {
   ws.cleanupClients();
+
+  // Clients are evicted after releasing the lock, as that invokes the disconnect handler
+  uint32_t evict[WEB_SERVER_SOCKET_EVENT_MAX_CLIENTS];
+  size_t num_evict = 0;
+  int64_t now_us = esp_timer_get_time();
+
+  xSemaphoreTake(events_lock, portMAX_DELAY);
+
+  for (size_t i = 0; i < WEB_SERVER_SOCKET_EVENT_MAX_CLIENTS; i++)
+  {
+    web_server_socket_events_client_t *cl = &(clients[i]);
+    if (!cl->used)
+      continue;
+
+    AsyncWebSocketClient *client = ws.client(cl->id);
+    if (!client || client->status() != WS_CONNECTED)
+      continue;
+
+    if (web_server_socket_events_heartbeat(client, cl, now_us))
+    {
+      evict[num_evict++] = cl->id;
+      continue;
+    }
+
+    // The library doesn't notify about drained queues, so staged events are flushed from here
+    if (cl->resync || cl->num_staged > 0)
+      web_server_socket_events_flush(client, cl);
+  }
+
+  stats.evicted += num_evict;
+  xSemaphoreGive(events_lock);
+
+  for (size_t i = 0; i < num_evict; i++)
+  {
+    AsyncWebSocketClient *client = ws.client(evict[i]);
+    if (!client)
+      continue;
+
+    // Abort the connection right away, a closing handshake would never complete
+    dbgerr("Event client %" PRIu32 " didn't answer it's ping, evicting it!", evict[i]);
+    client->client()->close(true);
+  }
+}
+
+/*
+============================================================================
+                                Broadcasting                                
+============================================================================
+*/
+
+void web_server_socket_events_broadcast(const web_server_socket_event_t *event)
+{
+  // Events may be emitted while loading state, before the webserver is up
+  if (!publisher)
+    return;
+
+  if (web_server_socket_events_enqueue(event))
+    return;
+
+  // The publisher fell behind, clients are told to resync with the next batch
+  __atomic_fetch_add(&(stats.dropped), 1, __ATOMIC_RELAXED);
+  __atomic_store_n(&queue_overflowed, true, __ATOMIC_RELEASE);
+}
+
+void web_server_socket_events_publish()
+{
+  if (publisher)
+    xTaskNotifyGive(publisher);
+}
+
+void web_server_socket_events_broadcast_index(web_socket_event_t type, uint8_t index)
+{
+  web_server_socket_event_t ev = { .type = type, .index = index };
+  web_server_socket_events_broadcast(&ev);
+}
+
+void web_server_socket_events_broadcast_day(web_socket_event_t type, uint8_t day)
+{
+  web_server_socket_event_t ev = { .type = type, .day = day };
+  web_server_socket_events_broadcast(&ev);
+}
+
+void web_server_socket_events_broadcast_interval(web_socket_event_t type, uint8_t day, uint8_t index)
+{
+  web_server_socket_event_t ev = { .type = type, .day = day, .index = index };
+  web_server_socket_events_broadcast(&ev);
+}
+
+void web_server_socket_events_broadcast_interval_time(web_socket_event_t type, uint8_t day, uint8_t index, scheduler_time_t time)
+{
+  web_server_socket_event_t ev = { .type = type, .day = day, .index = index, .time = time };
+  web_server_socket_events_broadcast(&ev);
+}
+
+void web_server_socket_events_broadcast_interval_identifier(uint8_t day, uint8_t index, uint8_t identifier)
+{
+  web_server_socket_event_t ev = { .type = WSE_INTERVAL_IDENTIFIER_CHANGE, .day = day, .index = index, .identifier = identifier };
+  web_server_socket_events_broadcast(&ev);
+}
+
+void web_server_socket_events_broadcast_valve_rename(uint8_t valve_id, const char *alias)
+{
+  web_server_socket_event_t ev = { .type = WSE_VALVE_RENAME, .index = valve_id };
+  strncpy(ev.alias, alias, WEB_SERVER_SOCKET_EVENT_ALIAS_MAXLEN);
+  web_server_socket_events_broadcast(&ev);
+}
+
+void web_server_socket_events_broadcast_valve_timer(uint8_t valve_id, scheduler_time_t timer)
+{
+  web_server_socket_event_t ev = { .type = WSE_VALVE_TIMER_UPDATED, .index = valve_id, .time = timer };
+  web_server_socket_events_broadcast(&ev);
+}
+
+uint32_t web_server_socket_events_publish_now()
+{
+  if (!publisher)
+    return last_seq;
+
+  xSemaphoreTake(events_lock, portMAX_DELAY);
+  web_server_socket_events_drain();
+  uint32_t seq = last_seq;
+  xSemaphoreGive(events_lock);
+
+  return seq;
+}
+
+uint32_t web_server_socket_events_last_seq()
+{
+  return last_seq;
 }
 
-void web_server_socket_events_broadcast(web_socket_event_t event, char *arg)
+uint32_t web_server_socket_events_epoch()
 {
-  const char *event_str = web_socket_event_name(event);
-  scptr char *msg = strfmt_direct("%s;%s", event_str, arg == NULL ? "" : arg);
-  ws.binaryAll(msg);
+  return epoch;
 }
+
+web_server_socket_events_stats_t web_server_socket_events_get_stats()
+{
+  return stats;
+}
+
+web_server_socket_events_sse_stats_t web_server_socket_events_get_sse_stats()
+{
+  return {
+    .clients = (uint32_t) sse.count(),
+    .avg_waiting = (uint32_t) sse.avgPacketsWaiting(),
+  };
+}
+
+size_t web_server_socket_events_get_clients(web_server_socket_events_client_info_t *out)
+{
+  if (!events_lock)
+    return 0;
+
+  xSemaphoreTake(events_lock, portMAX_DELAY);
+
+  size_t num_clients = 0;
+  for (size_t i = 0; i < WEB_SERVER_SOCKET_EVENT_MAX_CLIENTS; i++)
+  {
+    web_server_socket_events_client_t *cl = &(clients[i]);
+    if (!cl->used)
+      continue;
+
+    out[num_clients++] = {
+      .id = cl->id,
+      .rtt_us = cl->rtt_us,
+      .binary = cl->binary,
+      .num_staged = cl->num_staged,
+    };
+  }
+
+  xSemaphoreGive(events_lock);
+  return num_clients;
+}
\ No newline at end of file
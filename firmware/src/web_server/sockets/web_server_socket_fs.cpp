@@ -43,27 +43,86 @@ static void web_server_socket_fs_respond_code(
   client->binary(web_server_socket_fs_response_name(response));
 }
 
-static void web_server_socket_fs_respond_json(
-  AsyncWebSocketClient *client,
-  htable_t *jsonh
-)
+static bool web_server_socket_fs_listing_step(json_writer_t *jw, size_t step, void *arg)
 {
-  scptr char *jstr = jsonh_stringify(jsonh, 2, 2048);
-  client->binary(jstr);
+  File *dir = (File *) arg;
+
+  // Header
+  if (step == 0)
+  {
+    json_writer_obj_begin(jw);
+    json_writer_key(jw, "items");
+    json_writer_arr_begin(jw);
+    return true;
+  }
+
+  // One file per step
+  File curr_file = dir->openNextFile();
+  if (curr_file)
+  {
+    json_writer_obj_begin(jw);
+    json_writer_kv_bool(jw, "isDirectory", curr_file.isDirectory());
+    json_writer_kv_int(jw, "size", (int) curr_file.size());
+    json_writer_kv_str(jw, "name", curr_file.name());
+    json_writer_obj_end(jw);
+
+    curr_file.close();
+    return true;
+  }
+
+  // Footer
+  json_writer_arr_end(jw);
+  json_writer_obj_end(jw);
+  return false;
 }
 
-INLINED static htable_t *web_server_socket_fs_jsonify_file(File *file)
+static void web_server_socket_fs_respond_listing(
+  AsyncWebSocketClient *client,
+  File *dir
+)
 {
-  scptr htable_t *res = htable_make(3, mman_dealloc_nr);
+  // Buffers of previous listings which have been sent completely in the meantime
+  ws._cleanBuffers();
+
+  for (size_t attempt = 0; attempt < WEB_SERFER_SOCKET_FS_LISTING_ATTEMPTS; attempt++)
+  {
+    // Measure first, so the message buffer can be allocated once with it's exact size
+    size_t len = json_writer_measure(web_server_socket_fs_listing_step, dir, JWF_COMPACT);
+    dir->rewindDirectory();
+
+    // Write the listing straight into the message buffer, which is not copied again on send
+    AsyncWebSocketMessageBuffer *msg = ws.makeBuffer(len);
+    if (!msg)
+    {
+      dbgerr("Could not allocate %lu bytes for a directory listing!", len);
+      return;
+    }
+
+    json_writer_t jw;
+    json_writer_init(&jw, web_server_socket_fs_listing_step, dir, JWF_COMPACT);
+    size_t written = json_writer_fill(&jw, msg->get(), len);
+    dir->rewindDirectory();
 
-  jsonh_set_bool(res, "isDirectory", file->isDirectory());
-  jsonh_set_int(res, "size", (int) file->size());
+    // The directory grew in between both passes, the listing would be truncated, so measure again
+    if (!jw.done)
+    {
+      // Buffers are only ever freed by the socket's cleanup, which also takes unsent ones
+      ws._cleanBuffers();
+      continue;
+    }
+
+    // The directory shrunk in between both passes, pad with whitespace to keep the document valid
+    if (written < len)
+      memset(&(msg->get()[written]), ' ', len - written);
 
-  scptr char *name = strclone(file->name());
-  if (jsonh_set_str(res, "name", (char *) mman_ref(name)) != JOPRES_SUCCESS)
-    mman_dealloc(name);
+    client->binary(msg);
+
+    // Release whatever isn't queued anymore, this buffer itself is freed by a later cleanup once sent
+    ws._cleanBuffers();
+    return;
+  }
 
-  return (htable_t *) mman_ref(res);
+  web_server_socket_fs_respond_code(client, WSFS_DIR_CHANGED);
 }
 
 INLINED static bool web_server_socket_fs_preproc_existing_file_request(
@@ -146,6 +205,9 @@ static int web_server_socket_fs_proc_untar_header(
   if (*last == '/')
     *last = 0;
 
+  // Cached static files at this path are about to change
+  web_server_static_invalidate(path);
+
   // Directory, create directory
   if (header->type == T_DIRECTORY)
   {
@@ -221,6 +283,8 @@ static int web_server_socket_fs_proc_untar_end(
   // Close previously opened file, if exists
   if (*(arg->curr_handle))
   {
+    // Drop what may have been cached while the file was still being written
+    web_server_static_invalidate(arg->curr_handle->name());
     arg->curr_handle->close();
     *(arg->curr_handle) = File(NULL);
 
@@ -335,6 +399,7 @@ static void web_server_socket_fs_proc_untar(
   file_req_task_arg_t *req;
   task_queue_next(&req);
   req->client = client;
+  req->client_id = client->id();
   req->path = strclone(path);
   req->file = file;
   req->type = FRT_UNTAR;
@@ -346,9 +411,29 @@ static void web_server_socket_fs_proc_untar(
 ============================================================================
 */
 
+/**
+ * @brief Resolve the client of a task, which may have disconnected while the task was running
+ * 
+ * @return NULL if the client is gone
+ */
+INLINED static AsyncWebSocketClient *web_server_socket_fs_task_client(file_req_task_arg_t *req)
+{
+  AsyncWebSocketClient *client = ws.client(req->client_id);
+  if (!client || client->status() != WS_CONNECTED)
+    return NULL;
+
+  return client;
+}
+
 static void web_server_socket_fs_proc_fetch_task(void *arg)
 {
   file_req_task_arg_t *req = (file_req_task_arg_t *) arg;
+
+  // Client already left before the task got to run
+  AsyncWebSocketClient *header_client = web_server_socket_fs_task_client(req);
+  if (!header_client)
+    return;
+
   File target = SD.open(req->path);
 
   // Transmit header first
@@ -357,27 +442,54 @@ static void web_server_socket_fs_proc_fetch_task(void *arg)
     web_server_socket_fs_response_name(WSFS_FILE_FOUND),
     target.size()
   );
-  req->client->binary(header);
+  header_client->binary(header);
   mman_dealloc(header);
 
   // Now transmit file in chunks
-  uint8_t read_buf[4096];
+  uint8_t read_buf[SD_READER_CHUNK_LEN];
 
   // Delay between read/send iterations
   const TickType_t xDelay = 2 / portTICK_PERIOD_MS;
   vTaskDelay(xDelay);
 
+  // Prefetch the next chunk while the current one is being sent
+  sd_reader_t *reader = sd_reader_open(target);
+
   size_t read;
-  while ((read = target.read(read_buf, sizeof(read_buf))) > 0)
+  while (true)
   {
-    // Wait for queue to empty out before an overflow occurs
-    while (req->client->queueIsFull());
-    req->client->binary(read_buf, read);
+    if (reader)
+      read = sd_reader_read(reader, read_buf, sizeof(read_buf), WEB_SERFER_SOCKET_FS_READ_TIMEOUT);
+
+    // Reader pool exhausted, read directly
+    else
+      read = target.read(read_buf, sizeof(read_buf));
+
+    // Done or the SD stalled
+    if (read == 0 || read == SD_READER_PENDING)
+      break;
+
+    // Wait for queue to empty out before an overflow occurs, yielding instead of spinning
+    AsyncWebSocketClient *client = web_server_socket_fs_task_client(req);
+    while (client && client->queueIsFull())
+    {
+      vTaskDelay(xDelay);
+      client = web_server_socket_fs_task_client(req);
+    }
+
+    // Client left mid-transfer
+    if (!client)
+      break;
+
+    client->binary(read_buf, read);
     vTaskDelay(xDelay);
   }
 
   // Done transmitting
-  target.close();
+  if (reader)
+    sd_reader_close(reader);
+  else
+    target.close();
 }
 
 static void web_server_socket_fs_proc_fetch(
@@ -393,22 +505,7 @@ static void web_server_socket_fs_proc_fetch(
   // Requested a directory, list files
   if (is_directory)
   {
-    // Create basic response structure
-    scptr htable_t *res = htable_make(1, mman_dealloc_nr);
-    scptr dynarr_t *items = dynarr_make(16, 1024, mman_dealloc_nr);
-    jsonh_set_arr(res, "items", items);
-
-    // Loop all available files and jsonify them into the items array
-
-    File curr_file;
-    while (curr_file = target.openNextFile())
-    {
-      scptr htable_t *f_jsn = web_server_socket_fs_jsonify_file(&curr_file);
-      if (jsonh_insert_arr_obj(items, (htable_t *) mman_ref(f_jsn)) != JOPRES_SUCCESS)
-        mman_dealloc(f_jsn);
-    }
-
-    web_server_socket_fs_respond_json(client, res);
+    web_server_socket_fs_respond_listing(client, &target);
     target.close();
     return;
   }
@@ -420,6 +517,7 @@ static void web_server_socket_fs_proc_fetch(
   file_req_task_arg_t *req;
   task_queue_next(&req);
   req->client = client;
+  req->client_id = client->id();
   req->path = strclone(path);
   req->type = FRT_FETCH_LIST;
 }
@@ -444,6 +542,8 @@ static void web_server_socket_fs_recursive_delete(const char *path, bool *succes
     return;
   }
 
+  web_server_static_invalidate(path);
+
   // Check if file is a directory
   if (targ.isDirectory())
   {
@@ -506,12 +606,14 @@ static void web_server_socket_fs_proc_delete(
     file_req_task_arg_t *req;
     task_queue_next(&req);
     req->client = client;
+    req->client_id = client->id();
     req->path = strclone(path);
     req->type = FRT_DELETE_DIR;
     return;
   }
 
   // Requested a file, delete the file
+  web_server_static_invalidate(path);
   if (!SD.remove(path))
   {
     web_server_socket_fs_respond_code(client, WSFS_COULD_NOT_DELETE_FILE);
@@ -558,6 +660,9 @@ static File web_server_socket_fs_proc_write(
     target.close();
   }
 
+  // Cached static files at this path are about to change
+  web_server_static_invalidate(path);
+
   // Create directory if not exists
   if (is_directory)
   {
@@ -625,6 +730,7 @@ static void web_server_socket_fs_proc_update(
   file_req_task_arg_t *req;
   task_queue_next(&req);
   req->client = client;
+  req->client_id = client->id();
   req->path = strclone(path);
   req->file = file;
   req->type = FRT_UPDATE;
@@ -671,16 +777,67 @@ static void web_server_socket_fs_proc_update_task(void *arg)
 ============================================================================
 */
 
-// "Further writes"-file information (file writes are chunked)
-static File w_f = File(NULL);
-static long w_f_sz = 0;
-static unsigned long w_f_last = 0;
+// "Further writes"-file information per client (file writes are chunked)
+static web_server_socket_fs_upload_t uploads[WEB_SERFER_SOCKET_FS_MAX_UPLOADS];
+
+INLINED static void upload_reset(web_server_socket_fs_upload_t *upload)
+{
+  // Drop what may have been cached while the file was still being written
+  if (upload->file)
+    web_server_static_invalidate(upload->file.name());
+
+  upload->file.close();
+  upload->file = File(NULL);
+  upload->client_id = 0;
+  upload->remaining = 0;
+  upload->last = 0;
+}
+
+INLINED static bool upload_timed_out(web_server_socket_fs_upload_t *upload)
+{
+  return millis() - upload->last > WEB_SERFER_SOCKET_FS_WRITE_TIMEOUT;
+}
 
-INLINED static void w_f_reset()
+/**
+ * @brief Find the active upload of a client
+ * 
+ * @return NULL if the client has no upload in progress
+ */
+INLINED static web_server_socket_fs_upload_t *upload_find(uint32_t client_id)
 {
-  w_f.close();
-  w_f_sz = 0;
-  w_f_last = 0;
+  for (size_t i = 0; i < WEB_SERFER_SOCKET_FS_MAX_UPLOADS; i++)
+  {
+    web_server_socket_fs_upload_t *upload = &(uploads[i]);
+    if (upload->file && upload->client_id == client_id)
+      return upload;
+  }
+
+  return NULL;
+}
+
+/**
+ * @brief Find a slot for a new upload, which is either unused or has been abandoned
+ * 
+ * @return NULL if all slots are occupied by active uploads
+ */
+INLINED static web_server_socket_fs_upload_t *upload_claim()
+{
+  for (size_t i = 0; i < WEB_SERFER_SOCKET_FS_MAX_UPLOADS; i++)
+  {
+    web_server_socket_fs_upload_t *upload = &(uploads[i]);
+
+    if (!upload->file)
+      return upload;
+
+    // Timed out, take it over
+    if (upload_timed_out(upload))
+    {
+      upload_reset(upload);
+      return upload;
+    }
+  }
+
+  return NULL;
 }
 
 static void web_server_socket_fs_handle_data(
@@ -704,25 +861,26 @@ static void web_server_socket_fs_handle_data(
     return;
   }
 
-  // Active write
-  if (w_f)
+  // Active write of this client
+  web_server_socket_fs_upload_t *upload = upload_find(client->id());
+  if (upload)
   {
     // Write timed out, reset and stop now
-    if (w_f_last != 0 && millis() - w_f_last > WEB_SERFER_SOCKET_FS_WRITE_TIMEOUT)
+    if (upload_timed_out(upload))
     {
-      w_f_reset();
+      upload_reset(upload);
     }
 
     // Still within timing requirements
     else {
       // Write full data
-      w_f.write(data, len);
-      w_f_last = millis();
+      upload->file.write(data, len);
+      upload->last = millis();
 
       // Check for completion
-      w_f_sz -= len;
-      if (w_f_sz == 0)
-        w_f_reset();
+      upload->remaining -= len;
+      if (upload->remaining == 0)
+        upload_reset(upload);
 
       web_server_socket_fs_respond_code(client, WSFS_FILE_APPENDED);
       return;
@@ -780,18 +938,33 @@ static void web_server_socket_fs_handle_data(
     bool is_overwrite = strncasecmp("overwrite", cmd, strlen("overwrite")) == 0;
     if (strncasecmp("write", cmd, strlen("write")) == 0 || is_overwrite)
     {
-      // Parse upload size from params
-      scptr char *upload_size = partial_strdup((char *) data, &data_offs, ";", false);
-      if (upload_size != NULL)
-        longp(&w_f_sz, upload_size, 10);
+      // Files are written by further frames, which needs a free upload slot
+      upload = is_directory_bool ? NULL : upload_claim();
+      if (!is_directory_bool && !upload)
+      {
+        web_server_socket_fs_respond_code(client, WSFS_UPLOADS_BUSY);
+        return;
+      }
 
-      w_f = web_server_socket_fs_proc_write(
+      File target = web_server_socket_fs_proc_write(
         client,
         path,
         is_directory_bool,
         is_overwrite
       );
 
+      if (!target)
+        return;
+
+      // Parse upload size from params
+      scptr char *upload_size = partial_strdup((char *) data, &data_offs, ";", false);
+      upload->remaining = 0;
+      if (upload_size != NULL)
+        longp(&(upload->remaining), upload_size, 10);
+
+      upload->client_id = client->id();
+      upload->file = target;
+      upload->last = millis();
       return;
     }
   
@@ -822,6 +995,14 @@ static void onEvent(
     }
 
     case WS_EVT_DISCONNECT:
+    {
+      // Abandon the client's unfinished upload right away instead of waiting for it to time out
+      web_server_socket_fs_upload_t *upload = upload_find(client->id());
+      if (upload)
+        upload_reset(upload);
+      break;
+    }
+
     case WS_EVT_CONNECT:
     case WS_EVT_PONG:
     case WS_EVT_ERROR:
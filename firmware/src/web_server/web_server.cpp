@@ -10,14 +10,26 @@ static AsyncWebServer wsrv(WEB_SERVER_PORT);
 
 void web_server_init(scheduler_t *scheduler, valve_control_t *valve_control)
 {
+  // Preflights are answered before anything else, without routing
+  web_server_route_any_options_init(&wsrv);
+
+  // API routes are dispatched next, so they never cause lookups on the SD
+  web_server_router_init(&wsrv);
+
   // Serve static files from SD, using index.html as a default file for / requests
-  wsrv.serveStatic("/", SD, WEB_SERVER_STATIC_PATH).setDefaultFile("index.html");
+  web_server_static_init(&wsrv);
+
+  // Picks the ETag nonce of this boot
+  web_server_cache_init();
 
   // Initialize routes
-  web_server_route_scheduler_init(scheduler, &wsrv);
-  web_server_route_valves_init(valve_control, &wsrv);
+  web_server_route_scheduler_init(scheduler);
+  web_server_route_valves_init(valve_control);
+  web_server_route_state_init(scheduler, valve_control);
+  web_server_route_batch_init(scheduler, valve_control);
   web_server_route_not_found_init(&wsrv);
-  web_server_route_memstat_init(&wsrv);
+  web_server_route_memstat_init();
+  web_server_route_metrics_init();
 
   // Initialize the websocket
   web_server_socket_events_init(&wsrv);
@@ -0,0 +1,227 @@
+#include "web_server/web_server_admission.h"
+
+typedef enum web_server_admission_verdict
+{
+  WSA_ADMITTED,
+  WSA_RATE_LIMITED,
+  WSA_BUSY,
+  WSA_LOW_HEAP
+} web_server_admission_verdict_t;
+
+typedef struct web_server_admission_slot
+{
+  AsyncWebServerRequest *request;             // Tracked request, NULL if unused
+  web_server_admission_verdict_t verdict;     // Decision made for the request
+  uint8_t retry_after;                        // Seconds the client should wait when rejected
+} web_server_admission_slot_t;
+
+typedef struct web_server_admission_bucket
+{
+  uint32_t ip;                                // Remote address of the client, zero if unused
+  uint32_t milli_tokens;                      // Available tokens, in thousandths
+  int64_t last_us;                            // Time of the last refill
+} web_server_admission_bucket_t;
+
+static web_server_admission_slot_t slots[WEB_SERVER_ADMISSION_SLOTS];
+static web_server_admission_bucket_t buckets[WEB_SERVER_ADMISSION_BUCKETS];
+static web_server_admission_stats_t stats;
+
+// Rejections are answered from flash, without building a document on a possibly exhausted heap
+static const char web_server_admission_rate_limited_body[] = "{\"error\":true,\"code\":\"RATE_LIMITED\",\"message\":\"Too many requests, please slow down!\"}";
+static const char web_server_admission_overloaded_body[] = "{\"error\":true,\"code\":\"OVERLOADED\",\"message\":\"The server is busy, please retry later!\"}";
+
+/*
+============================================================================
+                               Token buckets
+============================================================================
+*/
+
+/**
+ * @brief Find the bucket of a client, or take over the least recently seen one
+ */
+INLINED static web_server_admission_bucket_t *web_server_admission_bucket(uint32_t ip, int64_t now_us)
+{
+  web_server_admission_bucket_t *victim = &(buckets[0]);
+  for (size_t i = 0; i < WEB_SERVER_ADMISSION_BUCKETS; i++)
+  {
+    if (buckets[i].ip == ip)
+      return &(buckets[i]);
+
+    if (buckets[i].last_us < victim->last_us)
+      victim = &(buckets[i]);
+  }
+
+  // New clients start out with a full bucket
+  victim->ip = ip;
+  victim->milli_tokens = WEB_SERVER_ADMISSION_BURST * 1000;
+  victim->last_us = now_us;
+  return victim;
+}
+
+/**
+ * @brief Take a token from a client's bucket
+ * 
+ * @param retry_after Seconds until the next token is available, if there's none left
+ * 
+ * @return true A token has been taken
+ */
+INLINED static bool web_server_admission_take_token(uint32_t ip, uint8_t *retry_after)
+{
+  int64_t now_us = esp_timer_get_time();
+  web_server_admission_bucket_t *bucket = web_server_admission_bucket(ip, now_us);
+
+  // Refill by the time passed since, a thousandth of a token takes 1000 / RATE microseconds
+  uint64_t refill = (uint64_t) (now_us - bucket->last_us) * WEB_SERVER_ADMISSION_RATE / 1000;
+  uint64_t milli_tokens = bucket->milli_tokens + refill;
+  bucket->milli_tokens = (uint32_t) (milli_tokens > WEB_SERVER_ADMISSION_BURST * 1000 ? WEB_SERVER_ADMISSION_BURST * 1000 : milli_tokens);
+  bucket->last_us = now_us;
+
+  if (bucket->milli_tokens >= 1000)
+  {
+    bucket->milli_tokens -= 1000;
+    return true;
+  }
+
+  // Round up to whole seconds, as that's all Retry-After can express
+  uint32_t missing_us = (1000 - bucket->milli_tokens) * 1000 / WEB_SERVER_ADMISSION_RATE;
+  *retry_after = (uint8_t) ((missing_us + 999999) / 1000000);
+  return false;
+}
+
+/*
+============================================================================
+                                   Slots
+============================================================================
+*/
+
+INLINED static web_server_admission_slot_t *web_server_admission_find(AsyncWebServerRequest *request)
+{
+  for (size_t i = 0; i < WEB_SERVER_ADMISSION_SLOTS; i++)
+  {
+    if (slots[i].request == request)
+      return &(slots[i]);
+  }
+
+  return NULL;
+}
+
+static void web_server_admission_leave(AsyncWebServerRequest *request)
+{
+  web_server_admission_slot_t *slot = web_server_admission_find(request);
+  if (!slot)
+    return;
+
+  if (slot->verdict == WSA_ADMITTED)
+    stats.in_flight--;
+
+  slot->request = NULL;
+}
+
+INLINED static web_server_admission_verdict_t web_server_admission_decide(AsyncWebServerRequest *request, uint8_t *retry_after)
+{
+  if (!web_server_admission_take_token((uint32_t) request->client()->remoteIP(), retry_after))
+  {
+    stats.rate_limited++;
+    return WSA_RATE_LIMITED;
+  }
+
+  if (esp_get_free_heap_size() < WEB_SERVER_ADMISSION_HEAP_WATERMARK)
+  {
+    stats.low_heap++;
+    *retry_after = WEB_SERVER_ADMISSION_RETRY_HEAP;
+    return WSA_LOW_HEAP;
+  }
+
+  if (stats.in_flight >= WEB_SERVER_ADMISSION_MAX_IN_FLIGHT)
+  {
+    stats.busy++;
+    *retry_after = WEB_SERVER_ADMISSION_RETRY_BUSY;
+    return WSA_BUSY;
+  }
+
+  stats.admitted++;
+  return WSA_ADMITTED;
+}
+
+/*
+============================================================================
+                                 Admission
+============================================================================
+*/
+
+bool web_server_admission_enter(AsyncWebServerRequest *request, bool first)
+{
+  web_server_admission_slot_t *slot = web_server_admission_find(request);
+  if (slot)
+    return slot->verdict == WSA_ADMITTED;
+
+  // Already turned away before without a slot to remember it, like on it's first body segment
+  if (!first)
+    return false;
+
+  slot = web_server_admission_find(NULL);
+
+  // All slots taken, which can only happen with many rejected requests awaiting their response
+  if (!slot)
+  {
+    stats.busy++;
+    return false;
+  }
+
+  slot->request = request;
+  slot->retry_after = 0;
+  slot->verdict = web_server_admission_decide(request, &(slot->retry_after));
+
+  if (slot->verdict == WSA_ADMITTED)
+  {
+    stats.in_flight++;
+    if (stats.in_flight > stats.max_in_flight)
+      stats.max_in_flight = stats.in_flight;
+  }
+
+  // Requests live until their connection closes, which is after the response has been sent
+  request->onDisconnect([request]() {
+    web_server_admission_leave(request);
+  });
+
+  return slot->verdict == WSA_ADMITTED;
+}
+
+void web_server_admission_reject(AsyncWebServerRequest *request)
+{
+  web_server_admission_slot_t *slot = web_server_admission_find(request);
+
+  // Untracked requests have been rejected due to a lack of slots
+  web_server_admission_verdict_t verdict = slot ? slot->verdict : WSA_BUSY;
+  uint8_t retry_after = slot ? slot->retry_after : WEB_SERVER_ADMISSION_RETRY_BUSY;
+
+  AsyncWebServerResponse *resp;
+  if (verdict == WSA_RATE_LIMITED)
+  {
+    resp = request->beginResponse_P(
+      429, WEB_SERVER_TYPE_JSON,
+      (const uint8_t *) web_server_admission_rate_limited_body,
+      sizeof(web_server_admission_rate_limited_body) - 1
+    );
+  }
+  else
+  {
+    resp = request->beginResponse_P(
+      503, WEB_SERVER_TYPE_JSON,
+      (const uint8_t *) web_server_admission_overloaded_body,
+      sizeof(web_server_admission_overloaded_body) - 1
+    );
+  }
+
+  char retry_after_str[4];
+  snprintf(retry_after_str, sizeof(retry_after_str), "%" PRIu8, retry_after);
+  resp->addHeader("Retry-After", retry_after_str);
+
+  web_server_append_cors_headers(resp);
+  request->send(resp);
+}
+
+web_server_admission_stats_t web_server_admission_get_stats()
+{
+  return stats;
+}
\ No newline at end of file
@@ -0,0 +1,316 @@
+#include "web_server/web_server_cache.h"
+
+typedef struct web_server_cache_entry
+{
+  char key[WEB_SERVER_CACHE_KEY_MAXLEN];      // Route and argument, empty if unused
+  uint32_t generation;                        // Generation the body has been rendered from
+  uint8_t *body;                              // Rendered body, mman-allocated
+  size_t body_len;                            // Length of the body in bytes
+  json_writer_format_t format;                // Format the body has been rendered in
+  bool gzipped;                               // Whether the body has been compressed
+  uint32_t last_used;                         // Usage tick, for LRU eviction
+} web_server_cache_entry_t;
+
+static web_server_cache_entry_t entries[WEB_SERVER_CACHE_SLOTS];
+static web_server_cache_stats_t stats;
+static uint32_t usage_tick = 0;
+
+// Generations restart on every boot, this keeps ETags of earlier boots from matching
+static uint32_t boot_nonce = 0;
+
+/*
+============================================================================
+                                  Entries                                   
+============================================================================
+*/
+
+INLINED static web_server_cache_entry_t *web_server_cache_find(const char *key)
+{
+  for (size_t i = 0; i < WEB_SERVER_CACHE_SLOTS; i++)
+  {
+    if (strncmp(entries[i].key, key, WEB_SERVER_CACHE_KEY_MAXLEN) == 0)
+      return &(entries[i]);
+  }
+
+  return NULL;
+}
+
+INLINED static web_server_cache_entry_t *web_server_cache_evict()
+{
+  // Prefer unused slots, then the least recently used one
+  web_server_cache_entry_t *victim = &(entries[0]);
+  for (size_t i = 0; i < WEB_SERVER_CACHE_SLOTS; i++)
+  {
+    if (!entries[i].key[0])
+    {
+      victim = &(entries[i]);
+      break;
+    }
+
+    if (entries[i].last_used < victim->last_used)
+      victim = &(entries[i]);
+  }
+
+  // In-flight responses still hold their own reference to the body
+  if (victim->body)
+    mman_dealloc(victim->body);
+
+  memset(victim, 0, sizeof(web_server_cache_entry_t));
+  return victim;
+}
+
+/**
+ * @brief Render a document into a new buffer of exactly it's length
+ * 
+ * @return uint8_t* Body buffer or NULL if it exceeds the maximum cacheable size or out of memory
+ */
+INLINED static uint8_t *web_server_cache_render(json_writer_step_t step_fn, void *arg, json_writer_format_t format, size_t *body_len)
+{
+  size_t len = json_writer_measure(step_fn, arg, format);
+  if (len > WEB_SERVER_CACHE_MAX_BODY)
+    return NULL;
+
+  uint8_t *body = (uint8_t *) mman_alloc(sizeof(uint8_t), len, NULL);
+  if (!body)
+  {
+    dbgerr("Could not allocate %lu bytes for a cached body!", (unsigned long) len);
+    return NULL;
+  }
+
+  // The overflow buffer of the writer has to live somewhere, keep it off the small task stack
+  scptr json_writer_t *jw = (json_writer_t *) mman_alloc(sizeof(json_writer_t), 1, NULL);
+  if (!jw)
+  {
+    dbgerr("Could not allocate a json writer for a cached body!");
+    mman_dealloc(body);
+    return NULL;
+  }
+
+  json_writer_init(jw, step_fn, arg, format);
+
+  size_t offs = 0;
+  while (offs < len)
+  {
+    size_t written = json_writer_fill(jw, &body[offs], len - offs);
+    if (written == 0)
+      break;
+
+    offs += written;
+  }
+
+  *body_len = len;
+  return body;
+}
+
+/*
+============================================================================
+                                 Responding                                 
+============================================================================
+*/
+
+INLINED static void web_server_cache_append_headers(AsyncWebServerResponse *resp, const char *etag)
+{
+  web_server_append_cors_headers(resp);
+  resp->addHeader("ETag", etag);
+
+  // Clients may keep the body, but have to revalidate it on every use
+  resp->addHeader("Cache-Control", "no-cache");
+
+  // The same resource is available in multiple formats and encodings
+  resp->addHeader("Vary", "Accept, Accept-Encoding");
+}
+
+INLINED static void web_server_cache_send_body(AsyncWebServerRequest *request, web_server_cache_entry_t *entry, const char *etag)
+{
+  // The response's filler holds a reference, so an eviction can't free the body while it's being sent
+  std::shared_ptr<uint8_t> body_ref((uint8_t *) mman_ref(entry->body), mman_dealloc);
+  size_t body_len = entry->body_len;
+
+  AsyncWebServerResponse *resp = request->beginResponse(
+    web_server_format_type(entry->format), body_len,
+    [body_ref, body_len](uint8_t *buf, size_t max_len, size_t index) -> size_t {
+      size_t remaining = body_len - index;
+      size_t len = remaining < max_len ? remaining : max_len;
+      memcpy(buf, &(body_ref.get()[index]), len);
+      return len;
+    }
+  );
+
+  web_server_cache_append_headers(resp, etag);
+
+  if (entry->gzipped)
+    resp->addHeader("Content-Encoding", "gzip");
+
+  request->send(resp);
+}
+
+INLINED static void web_server_cache_make_etag(char *etag, size_t etag_len, const char *key, uint32_t generation)
+{
+  snprintf(etag, etag_len, "\"%s:%08" PRIx32 ":%" PRIu32 "\"", key, boot_nonce, generation);
+}
+
+/**
+ * @brief Derive the key of the body in a given format and encoding, so all variants
+ * are cached side by side and their ETags differ
+ */
+INLINED static void web_server_cache_format_key(char *out, const char *key, json_writer_format_t format, bool gzip)
+{
+  snprintf(
+    out, WEB_SERVER_CACHE_KEY_MAXLEN, "%s%s%s", key,
+    format == JWF_CBOR ? ".cbor" : "",
+    gzip ? ".gz" : ""
+  );
+}
+
+bool web_server_cache_try_resp(AsyncWebServerRequest *request, const char *route_key, uint32_t generation)
+{
+  // Only compact bodies are cached, pretty-printing is meant for debugging
+  json_writer_format_t format = web_server_negotiate_format(request);
+  if (format == JWF_PRETTY)
+    return false;
+
+  char key[WEB_SERVER_CACHE_KEY_MAXLEN];
+  web_server_cache_format_key(key, route_key, format, web_server_gzip_accepted(request));
+
+  char etag[WEB_SERVER_CACHE_ETAG_MAXLEN];
+  web_server_cache_make_etag(etag, sizeof(etag), key, generation);
+
+  // The client already holds the current body
+  if (request->hasHeader("If-None-Match") && request->header("If-None-Match") == etag)
+  {
+    stats.not_modified++;
+
+    AsyncWebServerResponse *resp = request->beginResponse(304);
+    web_server_cache_append_headers(resp, etag);
+    request->send(resp);
+    return true;
+  }
+
+  // Serve the cached body if it has been rendered from the current generation
+  web_server_cache_entry_t *entry = web_server_cache_find(key);
+  if (entry && entry->generation == generation)
+  {
+    stats.hits++;
+    entry->last_used = ++usage_tick;
+    web_server_cache_send_body(request, entry, etag);
+    return true;
+  }
+
+  return false;
+}
+
+void web_server_cache_snapshot_resp(
+  AsyncWebServerRequest *request,
+  const char *route_key,
+  uint32_t generation,
+  json_writer_step_t step_fn,
+  void *snapshot,
+  size_t snapshot_len
+)
+{
+  // Rendered from right away, streamed responses take their own copy
+  scptr uint8_t *snap = (uint8_t *) snapshot;
+
+  // Only compact bodies are cached, pretty-printing is meant for debugging
+  json_writer_format_t format = web_server_negotiate_format(request);
+  if (format == JWF_PRETTY)
+  {
+    web_server_json_stream_resp(request, 200, step_fn, snap, snapshot_len);
+    return;
+  }
+
+  stats.misses++;
+
+  char key[WEB_SERVER_CACHE_KEY_MAXLEN];
+  web_server_cache_format_key(key, route_key, format, web_server_gzip_accepted(request));
+
+  char etag[WEB_SERVER_CACHE_ETAG_MAXLEN];
+  web_server_cache_make_etag(etag, sizeof(etag), key, generation);
+
+  size_t body_len = 0;
+  uint8_t *body = web_server_cache_render(step_fn, snap, format, &body_len);
+
+  // Compressed once here, so cache hits don't pay for it again
+  size_t gz_len = 0;
+  uint8_t *gz = body ? web_server_gzip_body(request, body, body_len, &gz_len) : NULL;
+  if (gz)
+  {
+    mman_dealloc(body);
+    body = gz;
+    body_len = gz_len;
+  }
+
+  // Too large to be cached, stream it but still allow for revalidation
+  if (!body)
+  {
+    AsyncWebServerResponse *resp = web_server_json_stream_begin(request, 200, step_fn, snap, snapshot_len);
+    resp->addHeader("ETag", etag);
+    resp->addHeader("Cache-Control", "no-cache");
+    request->send(resp);
+    return;
+  }
+
+  // Replace the outdated body or take over a free slot
+  web_server_cache_entry_t *entry = web_server_cache_find(key);
+  if (entry)
+    mman_dealloc(entry->body);
+  else
+    entry = web_server_cache_evict();
+
+  strncpy(entry->key, key, WEB_SERVER_CACHE_KEY_MAXLEN - 1);
+  entry->generation = generation;
+  entry->body = body;
+  entry->body_len = body_len;
+  entry->format = format;
+  entry->gzipped = gz != NULL;
+  entry->last_used = ++usage_tick;
+
+  web_server_cache_send_body(request, entry, etag);
+}
+
+void web_server_cache_json_resp(
+  AsyncWebServerRequest *request,
+  const char *route_key,
+  uint32_t generation,
+  json_writer_step_t step_fn,
+  const void *arg,
+  size_t arg_len
+)
+{
+  if (web_server_cache_try_resp(request, route_key, generation))
+    return;
+
+  // Render from a snapshot, so the body matches the generation it's stored under
+  uint8_t *snapshot = (uint8_t *) mman_alloc(sizeof(uint8_t), arg_len, NULL);
+  if (!snapshot)
+  {
+    dbgerr("Could not allocate a snapshot of %lu bytes to render %s from!", (unsigned long) arg_len, route_key);
+    web_server_out_of_memory_resp(request);
+    return;
+  }
+
+  memcpy(snapshot, arg, arg_len);
+  web_server_cache_snapshot_resp(request, route_key, generation, step_fn, snapshot, arg_len);
+}
+
+/*
+============================================================================
+                                 Statistics                                 
+============================================================================
+*/
+
+web_server_cache_stats_t web_server_cache_get_stats()
+{
+  return stats;
+}
+
+/*
+============================================================================
+                              Initialization                                
+============================================================================
+*/
+
+void web_server_cache_init()
+{
+  boot_nonce = esp_random();
+}
\ No newline at end of file
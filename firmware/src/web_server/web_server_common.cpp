@@ -1,14 +1,86 @@
 #include "web_server/web_server_common.h"
 
-INLINED static void web_server_append_cors_headers(AsyncWebServerResponse *resp)
+/**
+ * @brief State of a streamed JSON response, followed by the snapshot of the step routine's argument
+ */
+typedef struct web_server_json_stream
+{
+  json_writer_t jw;
+  web_server_gzip_stream_t *gzip;             // Compression of the document, NULL if sent as is
+  uint8_t arg[] __attribute__((aligned(8)));
+} web_server_json_stream_t;
+
+/**
+ * @brief State of a JSON body which is being read, followed by the object's and the document's struct
+ */
+typedef struct web_server_json_body_state
+{
+  json_reader_t jr;
+  bool too_long;                              // Whether the body exceeded the route's maximum length
+  uint8_t data[] __attribute__((aligned(8)));
+} web_server_json_body_state_t;
+
+// Answered from flash, as there's no heap left to build a document
+static const char web_server_out_of_memory_body[] = "{\"error\":true,\"code\":\"OVERLOADED\",\"message\":\"Not enough memory left, please retry later!\"}";
+
+// Structs following each other are aligned like the state's data
+#define WEB_SERVER_JSON_BODY_ALIGN(len) (((len) + 7) & ~((size_t) 7))
+
+/*
+============================================================================
+                                  Headers                                   
+============================================================================
+*/
+
+void web_server_append_cors_headers(AsyncWebServerResponse *resp)
 {
   // Allow CORS requests
   resp->addHeader("Access-Control-Allow-Origin", "*");
+}
+
+void web_server_append_preflight_headers(AsyncWebServerResponse *resp)
+{
+  web_server_append_cors_headers(resp);
   resp->addHeader("Access-Control-Max-Age", "600");
   resp->addHeader("Access-Control-Allow-Methods", "PUT,POST,GET,DELETE,OPTIONS");
   resp->addHeader("Access-Control-Allow-Headers", "*");
 }
 
+/*
+============================================================================
+                                Negotiation                                 
+============================================================================
+*/
+
+bool web_server_wants_pretty(AsyncWebServerRequest *request)
+{
+  if (!request->hasParam("pretty"))
+    return false;
+
+  return request->getParam("pretty")->value() == "1";
+}
+
+bool web_server_wants_cbor(AsyncWebServerRequest *request)
+{
+  if (!request->hasHeader("Accept"))
+    return false;
+
+  return strstr(request->header("Accept").c_str(), WEB_SERVER_TYPE_CBOR) != NULL;
+}
+
+json_writer_format_t web_server_negotiate_format(AsyncWebServerRequest *request)
+{
+  if (web_server_wants_cbor(request))
+    return JWF_CBOR;
+
+  return web_server_wants_pretty(request) ? JWF_PRETTY : JWF_COMPACT;
+}
+
+const char *web_server_format_type(json_writer_format_t format)
+{
+  return format == JWF_CBOR ? WEB_SERVER_TYPE_CBOR : WEB_SERVER_TYPE_JSON;
+}
+
 /*
 ============================================================================
                                Success routines                               
@@ -24,14 +96,79 @@ void web_server_empty_ok(AsyncWebServerRequest *request)
 
 void web_server_json_resp(AsyncWebServerRequest *request, int status, htable_t *json)
 {
-  scptr char *stringified = jsonh_stringify(json, 2, 2048);
+  // An indent of zero results in compact output
+  uint8_t indent = web_server_wants_pretty(request) ? WEB_SERVER_JSON_PRETTY_INDENT : 0;
+  scptr char *stringified = jsonh_stringify(json, indent, 2048);
 
-  AsyncWebServerResponse *resp = request->beginResponse(status, "application/json", stringified);
+  AsyncWebServerResponse *resp = request->beginResponse(status, WEB_SERVER_TYPE_JSON, stringified);
   web_server_append_cors_headers(resp);
 
   request->send(resp);
 }
 
+static void web_server_json_stream_free(web_server_json_stream_t *stream)
+{
+  if (stream->gzip)
+    web_server_gzip_stream_free(stream->gzip);
+
+  mman_dealloc(stream);
+}
+
+AsyncWebServerResponse *web_server_json_stream_begin(
+  AsyncWebServerRequest *request,
+  int status,
+  json_writer_step_t step_fn,
+  const void *arg,
+  size_t arg_len
+)
+{
+  web_server_json_stream_t *stream = (web_server_json_stream_t *) mman_alloc(sizeof(web_server_json_stream_t) + arg_len, 1, NULL);
+  if (!stream)
+  {
+    dbgerr("Could not allocate a response stream with an argument of %lu bytes!", (unsigned long) arg_len);
+    return web_server_out_of_memory_begin(request);
+  }
+
+  memcpy(stream->arg, arg, arg_len);
+
+  json_writer_format_t format = web_server_negotiate_format(request);
+  json_writer_init(&(stream->jw), step_fn, stream->arg, format);
+  stream->gzip = web_server_gzip_stream_begin(request, step_fn, stream->arg, format);
+
+  // The response's filler owns the stream, which is released as soon as the response is done or aborted
+  std::shared_ptr<web_server_json_stream_t> stream_ref(stream, web_server_json_stream_free);
+
+  AsyncWebServerResponse *resp = request->beginChunkedResponse(
+    web_server_format_type(format),
+    [stream_ref](uint8_t *buf, size_t max_len, size_t index) -> size_t {
+      if (stream_ref->gzip)
+        return web_server_gzip_stream_fill(stream_ref->gzip, &(stream_ref->jw), buf, max_len);
+      return json_writer_fill(&(stream_ref->jw), buf, max_len);
+    }
+  );
+
+  resp->setCode(status);
+  web_server_append_cors_headers(resp);
+
+  if (stream->gzip)
+    resp->addHeader("Content-Encoding", "gzip");
+
+  // The same resource is available in multiple formats and encodings
+  resp->addHeader("Vary", "Accept, Accept-Encoding");
+  return resp;
+}
+
+void web_server_json_stream_resp(
+  AsyncWebServerRequest *request,
+  int status,
+  json_writer_step_t step_fn,
+  const void *arg,
+  size_t arg_len
+)
+{
+  request->send(web_server_json_stream_begin(request, status, step_fn, arg, arg_len));
+}
+
 /*
 ============================================================================
                                Error routines                               
@@ -57,79 +194,112 @@ void web_server_error_resp(AsyncWebServerRequest *request, int status, web_serve
   web_server_json_resp(request, status, resp);
 }
 
+AsyncWebServerResponse *web_server_out_of_memory_begin(AsyncWebServerRequest *request)
+{
+  AsyncWebServerResponse *resp = request->beginResponse_P(
+    503, WEB_SERVER_TYPE_JSON,
+    (const uint8_t *) web_server_out_of_memory_body,
+    sizeof(web_server_out_of_memory_body) - 1
+  );
+
+  web_server_append_cors_headers(resp);
+  return resp;
+}
+
+void web_server_out_of_memory_resp(AsyncWebServerRequest *request)
+{
+  request->send(web_server_out_of_memory_begin(request));
+}
+
 /*
 ============================================================================
                                 Body Handling                               
 ============================================================================
 */
 
-void web_server_str_body_handler(AsyncWebServerRequest *request, uint8_t *data, size_t len, size_t index, size_t total)
+void web_server_json_body_handler(AsyncWebServerRequest *request, const void *arg, uint8_t *data, size_t len, size_t index, size_t total)
 {
-  uint8_t *body = (uint8_t *) request->_tempObject;
+  const web_server_json_body_t *body = (const web_server_json_body_t *) arg;
 
-  // Create buffer on the first segment of the message
-  if(index == 0)
+  // Create the state on the first segment of the message
+  if (index == 0)
   {
+    size_t out_len = WEB_SERVER_JSON_BODY_ALIGN(body->schema->out_len);
+
     // Allocate using malloc since the API will automatically call free after the request's lifetime
-    request->_tempObject = malloc(sizeof(uint8_t) * total);
-    body = (uint8_t *) request->_tempObject;
+    web_server_json_body_state_t *state = (web_server_json_body_state_t *) malloc(sizeof(web_server_json_body_state_t) + out_len + body->doc_len);
+    request->_tempObject = state;
 
-    // Not enough space available for the whole body
-    if (!body)
+    // Not enough space available for the state
+    if (!state)
       return;
-  }
 
-  // Write the segment into the buffer
-  memcpy(&(body[index]), data, len);
-}
+    state->too_long = total > body->max_len;
 
-INLINED static bool web_server_ensure_str_body(AsyncWebServerRequest *request, char **output)
-{
-  // Body segment collector has been called at least once
-  if (request->_tempObject)
-  {
-    uint8_t *body = (uint8_t *) request->_tempObject;
+    uint8_t *doc = &(state->data[out_len]);
+    memset(doc, 0, body->doc_len);
+    bool cbor = request->contentType() == WEB_SERVER_TYPE_CBOR;
+    json_reader_init(&(state->jr), body->schema, state->data, body->item_fn, doc, cbor);
+  }
 
-    // Check if we had enough space
-    if (!body)
-    {
-      web_server_error_resp(request, 500, BODY_TOO_LONG, "Body too long, not enough space!");
-      return false;
-    }
+  web_server_json_body_state_t *state = (web_server_json_body_state_t *) request->_tempObject;
+  if (!state || state->too_long)
+    return;
 
-    *output = (char *) body;
-    return true;
+  // Content-length has been exceeded
+  if (index + len > body->max_len)
+  {
+    state->too_long = true;
+    return;
   }
 
-  // No body collected
-  web_server_error_resp(request, 400, NO_CONTENT, "No body content provided!");
-  return false;
+  // Errors are kept by the reader until the request is handled
+  json_reader_feed(&(state->jr), data, len);
 }
 
-bool web_server_ensure_json_body(AsyncWebServerRequest *request, htable_t **output)
+bool web_server_ensure_json_body(AsyncWebServerRequest *request, void **output)
 {
-  // Get the string body
-  char *body = NULL;
-  if (!web_server_ensure_str_body(request, &body))
+  web_server_json_body_state_t *state = (web_server_json_body_state_t *) request->_tempObject;
+
+  // Body handler has never been called
+  if (!state)
+  {
+    if (request->contentLength() > 0)
+      web_server_error_resp(request, 500, BODY_TOO_LONG, "Body too long, not enough space!");
+    else
+      web_server_error_resp(request, 400, NO_CONTENT, "No body content provided!");
+
     return false;
+  }
 
   // Check that the content-type actually matches
-  if (request->contentType() != "application/json")
+  if (request->contentType() != WEB_SERVER_TYPE_JSON && request->contentType() != WEB_SERVER_TYPE_CBOR)
   {
-    web_server_error_resp(request, 400, NOT_JSON, "This endpoint only accepts JSON bodies!");
+    web_server_error_resp(request, 400, NOT_JSON, "This endpoint only accepts JSON or CBOR bodies!");
     return false;
   }
 
-  // Parse json
-  scptr char *err = NULL;
-  scptr htable_t *body_jsn = jsonh_parse(body, &err);
-  if (!body_jsn)
+  if (state->too_long)
   {
-    web_server_error_resp(request, 400, INVALID_JSON, "Could not parse the JSON body: %s", err);
+    web_server_error_resp(request, 413, BODY_TOO_LONG, "Body too long, exceeds the limit of this endpoint!");
+    return false;
+  }
+
+  json_reader_t *jr = &(state->jr);
+  if (!json_reader_finish(jr))
+  {
+    // Name the failing item of arrays, counting from zero
+    if (jr->error == JRE_SCHEMA && jr->item_fn)
+      web_server_error_resp(request, 400, BODY_MALFORMED, "Body data malformed: item %u: %s", (unsigned int) jr->items, jr->err);
+    else if (jr->error == JRE_SCHEMA)
+      web_server_error_resp(request, 400, BODY_MALFORMED, "Body data malformed: %s", jr->err);
+    else
+      web_server_error_resp(request, 400, INVALID_JSON, "Could not parse the JSON body: %s", jr->err);
+
     return false;
   }
 
-  // Write output
-  *output = (htable_t *) mman_ref(body_jsn);
+  // Arrays are read into the document, objects into their own struct
+  *output = jr->item_fn ? jr->item_arg : jr->out;
   return true;
 }
\ No newline at end of file
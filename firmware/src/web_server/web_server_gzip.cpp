@@ -0,0 +1,242 @@
+#include "web_server/web_server_gzip.h"
+#include "web_server/web_server_router.h"
+
+// Label of documents which aren't produced by a route handler
+#define WEB_SERVER_GZIP_UNROUTED "?"
+
+static web_server_gzip_stats_t stats[WEB_SERVER_GZIP_STATS_SLOTS];
+static size_t num_stats = 0;
+static size_t num_streams = 0;
+
+/*
+============================================================================
+                                Statistics
+============================================================================
+*/
+
+INLINED static const char *web_server_gzip_endpoint()
+{
+  const char *pattern = web_server_router_current_pattern();
+  return pattern ? pattern : WEB_SERVER_GZIP_UNROUTED;
+}
+
+/**
+ * @brief Find the statistics of a route, or claim a free slot for it
+ * 
+ * @return web_server_gzip_stats_t* Statistics or NULL if all slots are taken
+ */
+INLINED static web_server_gzip_stats_t *web_server_gzip_stats_of(const char *endpoint)
+{
+  // Patterns are string literals, so their address identifies them
+  for (size_t i = 0; i < num_stats; i++)
+  {
+    if (stats[i].endpoint == endpoint)
+      return &(stats[i]);
+  }
+
+  if (num_stats == WEB_SERVER_GZIP_STATS_SLOTS)
+    return NULL;
+
+  web_server_gzip_stats_t *slot = &(stats[num_stats++]);
+  slot->endpoint = endpoint;
+  return slot;
+}
+
+INLINED static void web_server_gzip_record(const char *endpoint, uint32_t bytes_in, uint32_t bytes_out, uint32_t took_us)
+{
+  web_server_gzip_stats_t *slot = web_server_gzip_stats_of(endpoint);
+  if (!slot)
+    return;
+
+  slot->compressed++;
+  slot->bytes_in += bytes_in;
+  slot->bytes_out += bytes_out;
+  slot->total_us += took_us;
+}
+
+size_t web_server_gzip_get_stats(web_server_gzip_stats_t *out)
+{
+  memcpy(out, stats, sizeof(web_server_gzip_stats_t) * num_stats);
+  return num_stats;
+}
+
+/*
+============================================================================
+                                Negotiation
+============================================================================
+*/
+
+bool web_server_gzip_accepted(AsyncWebServerRequest *request)
+{
+  if (!request->hasHeader("Accept-Encoding"))
+    return false;
+
+  return strstr(request->header("Accept-Encoding").c_str(), "gzip") != NULL;
+}
+
+/**
+ * @brief Decide whether a body of known length is compressed, which is recorded otherwise
+ */
+INLINED static bool web_server_gzip_applies(const char *endpoint, size_t len)
+{
+  if (len >= WEB_SERVER_GZIP_MIN_LEN)
+    return true;
+
+  web_server_gzip_stats_t *slot = web_server_gzip_stats_of(endpoint);
+  if (slot)
+    slot->skipped++;
+
+  return false;
+}
+
+/*
+============================================================================
+                                 Streams
+============================================================================
+*/
+
+web_server_gzip_stream_t *web_server_gzip_stream_begin(
+  AsyncWebServerRequest *request,
+  json_writer_step_t step_fn,
+  void *arg,
+  json_writer_format_t format
+)
+{
+  if (!web_server_gzip_accepted(request))
+    return NULL;
+
+  const char *endpoint = web_server_gzip_endpoint();
+
+  // Every stream holds a whole window, don't compete with the rest of the system for heap
+  if (num_streams >= WEB_SERVER_GZIP_MAX_STREAMS)
+  {
+    web_server_gzip_stats_t *slot = web_server_gzip_stats_of(endpoint);
+    if (slot)
+      slot->busy++;
+
+    return NULL;
+  }
+
+  // The decision has to be made before the headers are sent, so measure the document up front
+  int64_t start_us = esp_timer_get_time();
+  size_t len = json_writer_measure(step_fn, arg, format);
+  uint32_t took_us = (uint32_t) (esp_timer_get_time() - start_us);
+
+  if (!web_server_gzip_applies(endpoint, len))
+    return NULL;
+
+  // Fall back to an uncompressed response if the window doesn't fit
+  web_server_gzip_stream_t *gs = (web_server_gzip_stream_t *) mman_alloc(sizeof(web_server_gzip_stream_t), 1, NULL);
+  if (!gs)
+    return NULL;
+
+  deflate_stream_init(&(gs->ds));
+  gs->slab_len = 0;
+  gs->slab_offs = 0;
+  gs->endpoint = endpoint;
+  gs->took_us = took_us;
+
+  num_streams++;
+  return gs;
+}
+
+size_t web_server_gzip_stream_fill(web_server_gzip_stream_t *gs, json_writer_t *jw, uint8_t *buf, size_t len)
+{
+  int64_t start_us = esp_timer_get_time();
+  size_t offs = 0;
+
+  while (offs < len && !deflate_stream_done(&(gs->ds)))
+  {
+    // Hand out compressed output first
+    size_t read = deflate_stream_read(&(gs->ds), &buf[offs], len - offs);
+    offs += read;
+
+    if (read > 0)
+      continue;
+
+    // Render the next slab of the document, the input ends as soon as the writer is done
+    if (gs->slab_offs == gs->slab_len)
+    {
+      gs->slab_len = json_writer_fill(jw, gs->slab, WEB_SERVER_GZIP_SLAB_LEN);
+      gs->slab_offs = 0;
+
+      if (gs->slab_len == 0)
+      {
+        deflate_stream_finish(&(gs->ds));
+        continue;
+      }
+    }
+
+    gs->slab_offs += deflate_stream_write(&(gs->ds), &(gs->slab[gs->slab_offs]), gs->slab_len - gs->slab_offs);
+  }
+
+  gs->took_us += (uint32_t) (esp_timer_get_time() - start_us);
+  return offs;
+}
+
+void web_server_gzip_stream_free(web_server_gzip_stream_t *gs)
+{
+  // Aborted responses didn't send the whole document, which would distort the ratio
+  if (deflate_stream_done(&(gs->ds)))
+    web_server_gzip_record(gs->endpoint, gs->ds.total_in, gs->ds.total_out, gs->took_us);
+
+  num_streams--;
+  mman_dealloc(gs);
+}
+
+/*
+============================================================================
+                                  Bodies
+============================================================================
+*/
+
+uint8_t *web_server_gzip_body(AsyncWebServerRequest *request, const uint8_t *body, size_t len, size_t *gz_len)
+{
+  if (!web_server_gzip_accepted(request))
+    return NULL;
+
+  const char *endpoint = web_server_gzip_endpoint();
+  if (!web_server_gzip_applies(endpoint, len))
+    return NULL;
+
+  int64_t start_us = esp_timer_get_time();
+
+  // Compress into a worst case sized buffer, then keep only what's been used
+  scptr deflate_stream_t *ds = (deflate_stream_t *) mman_alloc(sizeof(deflate_stream_t), 1, NULL);
+  scptr uint8_t *out = (uint8_t *) mman_alloc(sizeof(uint8_t), deflate_stream_bound(len), NULL);
+
+  // The body is served uncompressed if there's not enough heap left
+  if (!ds || !out)
+  {
+    dbgerr("Could not allocate buffers to compress a body of %lu bytes!", (unsigned long) len);
+    return NULL;
+  }
+
+  deflate_stream_init(ds);
+
+  size_t offs = 0, out_len = 0;
+  while (!deflate_stream_done(ds))
+  {
+    size_t read = deflate_stream_read(ds, &out[out_len], deflate_stream_bound(len) - out_len);
+    out_len += read;
+
+    if (read > 0)
+      continue;
+
+    if (offs == len)
+      deflate_stream_finish(ds);
+    else
+      offs += deflate_stream_write(ds, &body[offs], len - offs);
+  }
+
+  uint8_t *gz = (uint8_t *) mman_alloc(sizeof(uint8_t), out_len, NULL);
+  if (!gz)
+    return NULL;
+
+  memcpy(gz, out, out_len);
+
+  web_server_gzip_record(endpoint, len, out_len, (uint32_t) (esp_timer_get_time() - start_us));
+
+  *gz_len = out_len;
+  return gz;
+}
\ No newline at end of file
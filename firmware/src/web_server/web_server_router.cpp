@@ -0,0 +1,402 @@
+#include "web_server/web_server_router.h"
+
+/**
+ * @brief Kind of path segment a node matches
+ */
+typedef enum web_server_router_segment
+{
+  WSR_SEGMENT_LITERAL,              // Exactly the node's segment
+  WSR_SEGMENT_INT,                  // {int}
+  WSR_SEGMENT_WEEKDAY               // {weekday}
+} web_server_router_segment_t;
+
+// Number of distinct request methods, see WebRequestMethod
+#define WEB_SERVER_ROUTER_NUM_METHODS 7
+
+typedef struct web_server_router_node
+{
+  web_server_router_segment_t type;                                   // Kind of segment
+  const char *segment;                                                // Literal segment, pointing into the pattern
+  uint8_t segment_len;                                                // Length of the literal segment
+  int8_t first_child;                                                 // Index of the first child, -1 if none
+  int8_t next_sibling;                                                // Index of the next sibling, -1 if none
+  web_server_route_handler_t handlers[WEB_SERVER_ROUTER_NUM_METHODS]; // Handler per method, by bit index
+  web_server_route_body_handler_t body_handlers[WEB_SERVER_ROUTER_NUM_METHODS];
+  const void *body_args[WEB_SERVER_ROUTER_NUM_METHODS];
+  const char *patterns[WEB_SERVER_ROUTER_NUM_METHODS];                // Pattern each handler has been registered on
+} web_server_router_node_t;
+
+/**
+ * @brief Result of walking the trie for a path
+ */
+typedef struct web_server_router_match
+{
+  web_server_router_node_t *node;                                     // Matched node, NULL if there's none
+  web_server_route_args_t args;                                       // Converted captures
+  int8_t invalid_capture;                                             // Index of a capture that didn't convert, -1 if none
+  web_server_router_segment_t invalid_type;                           // Type of that capture
+  const char *invalid_segment;                                        // Start of that capture's segment
+  uint8_t invalid_segment_len;                                        // Length of that capture's segment
+} web_server_router_match_t;
+
+// Node zero is the root, which represents the empty path
+static web_server_router_node_t nodes[WEB_SERVER_ROUTER_MAX_NODES];
+static size_t num_nodes = 0;
+
+// Pattern of the route whose handler is currently running, NULL outside of handlers
+static const char *current_pattern = NULL;
+
+/*
+============================================================================
+                                  Building                                  
+============================================================================
+*/
+
+INLINED static int web_server_router_method_index(WebRequestMethod method)
+{
+  for (int i = 0; i < WEB_SERVER_ROUTER_NUM_METHODS; i++)
+  {
+    if (method == (1 << i))
+      return i;
+  }
+
+  return -1;
+}
+
+static web_server_router_node_t *web_server_router_node_make()
+{
+  if (num_nodes >= WEB_SERVER_ROUTER_MAX_NODES)
+  {
+    dbgerr("Exceeded the maximum number of router nodes!");
+    return NULL;
+  }
+
+  web_server_router_node_t *node = &(nodes[num_nodes++]);
+  memset(node, 0, sizeof(web_server_router_node_t));
+  node->first_child = -1;
+  node->next_sibling = -1;
+  return node;
+}
+
+/**
+ * @brief Classify a pattern segment, captures are wrapped in curly braces
+ */
+INLINED static web_server_router_segment_t web_server_router_classify(const char *segment, size_t len)
+{
+  if (len == 5 && strncmp(segment, "{int}", len) == 0)
+    return WSR_SEGMENT_INT;
+
+  if (len == 9 && strncmp(segment, "{weekday}", len) == 0)
+    return WSR_SEGMENT_WEEKDAY;
+
+  return WSR_SEGMENT_LITERAL;
+}
+
+/**
+ * @brief Find the child of a node which represents a given pattern segment, or add it
+ */
+static web_server_router_node_t *web_server_router_child(web_server_router_node_t *parent, const char *segment, size_t len)
+{
+  web_server_router_segment_t type = web_server_router_classify(segment, len);
+
+  int8_t *link = &(parent->first_child);
+  while (*link >= 0)
+  {
+    web_server_router_node_t *child = &(nodes[*link]);
+
+    if (
+      child->type == type
+      && (type != WSR_SEGMENT_LITERAL || (child->segment_len == len && strncmp(child->segment, segment, len) == 0))
+    )
+      return child;
+
+    link = &(child->next_sibling);
+  }
+
+  web_server_router_node_t *child = web_server_router_node_make();
+  if (!child)
+    return NULL;
+
+  child->type = type;
+  child->segment = segment;
+  child->segment_len = (uint8_t) len;
+  *link = (int8_t) (child - nodes);
+  return child;
+}
+
+/*
+============================================================================
+                                  Matching                                  
+============================================================================
+*/
+
+/**
+ * @brief Convert the segment of an {int} capture
+ */
+INLINED static bool web_server_router_parse_int(const char *segment, size_t len, long *value)
+{
+  // Bounded, so the value can't overflow
+  if (len == 0 || len > 9)
+    return false;
+
+  long res = 0;
+  for (size_t i = 0; i < len; i++)
+  {
+    if (segment[i] < '0' || segment[i] > '9')
+      return false;
+
+    res = res * 10 + (segment[i] - '0');
+  }
+
+  *value = res;
+  return true;
+}
+
+/**
+ * @brief Convert the segment of a {weekday} capture
+ */
+INLINED static bool web_server_router_parse_weekday(const char *segment, size_t len, long *value)
+{
+  if (len >= WEB_SERVER_ROUTER_WEEKDAY_MAXLEN)
+    return false;
+
+  char name[WEB_SERVER_ROUTER_WEEKDAY_MAXLEN];
+  memcpy(name, segment, len);
+  name[len] = 0;
+
+  scheduler_weekday_t day;
+  if (scheduler_weekday_value(name, &day) != ENUMLUT_SUCCESS)
+    return false;
+
+  *value = (long) day;
+  return true;
+}
+
+/**
+ * @brief Walk the trie along a path, converting captures on the way
+ * 
+ * @return true The path ends on a node
+ * @return false There's no node for this path
+ */
+static bool web_server_router_match(const char *path, web_server_router_match_t *match)
+{
+  memset(match, 0, sizeof(web_server_router_match_t));
+  match->invalid_capture = -1;
+
+  if (num_nodes == 0 || path[0] != '/')
+    return false;
+
+  web_server_router_node_t *node = &(nodes[0]);
+  const char *segment = &path[1];
+
+  while (true)
+  {
+    const char *end = strchr(segment, '/');
+    size_t len = end ? (size_t) (end - segment) : strlen(segment);
+
+    // Prefer literals over captures
+    web_server_router_node_t *capture = NULL, *next = NULL;
+    for (int8_t i = node->first_child; i >= 0 && !next; i = nodes[i].next_sibling)
+    {
+      web_server_router_node_t *child = &(nodes[i]);
+
+      if (child->type != WSR_SEGMENT_LITERAL)
+      {
+        if (!capture)
+          capture = child;
+        continue;
+      }
+
+      if (child->segment_len == len && strncmp(child->segment, segment, len) == 0)
+        next = child;
+    }
+
+    if (!next && capture && len > 0)
+    {
+      if (match->args.num_values >= WEB_SERVER_ROUTER_MAX_CAPTURES)
+        return false;
+
+      long *value = &(match->args.values[match->args.num_values]);
+      bool converted = capture->type == WSR_SEGMENT_INT
+        ? web_server_router_parse_int(segment, len, value)
+        : web_server_router_parse_weekday(segment, len, value);
+
+      // Remember the first segment that failed, the route is still matched to answer with a 400
+      if (!converted && match->invalid_capture < 0)
+      {
+        match->invalid_capture = match->args.num_values;
+        match->invalid_type = capture->type;
+        match->invalid_segment = segment;
+        match->invalid_segment_len = (uint8_t) (len > UINT8_MAX ? UINT8_MAX : len);
+      }
+
+      match->args.num_values++;
+      next = capture;
+    }
+
+    if (!next)
+      return false;
+
+    node = next;
+
+    if (!end)
+      break;
+
+    segment = end + 1;
+  }
+
+  match->node = node;
+  return true;
+}
+
+/*
+============================================================================
+                                  Handler                                   
+============================================================================
+*/
+
+INLINED static web_server_route_handler_t web_server_router_handler(web_server_router_match_t *match, WebRequestMethod method)
+{
+  int method_index = web_server_router_method_index(method);
+  if (method_index < 0)
+    return NULL;
+
+  return match->node->handlers[method_index];
+}
+
+class WebServerRouter : public AsyncWebHandler
+{
+  public:
+    bool canHandle(AsyncWebServerRequest *request) override
+    {
+      web_server_router_match_t match;
+      if (!web_server_router_match(request->url().c_str(), &match))
+        return false;
+
+      if (!web_server_router_handler(&match, request->method()))
+        return false;
+
+      // Routes may inspect any header
+      request->addInterestingHeader("ANY");
+      return true;
+    }
+
+    void handleRequest(AsyncWebServerRequest *request) override
+    {
+      web_server_router_match_t match;
+      if (!web_server_router_match(request->url().c_str(), &match))
+        return;
+
+      // Requests without a body are first seen here
+      if (!web_server_admission_enter(request, request->contentLength() == 0))
+      {
+        web_server_admission_reject(request);
+        return;
+      }
+
+      // Malformed capture, like a non-numeric id
+      if (match.invalid_capture >= 0)
+      {
+        if (match.invalid_type == WSR_SEGMENT_WEEKDAY)
+          web_server_error_resp(request, 400, INVALID_WEEKDAY, "Invalid weekday specified (%.*s)!", match.invalid_segment_len, match.invalid_segment);
+        else
+          web_server_error_resp(request, 400, NON_NUM_ID, "Invalid non-numeric identifier (%.*s)!", match.invalid_segment_len, match.invalid_segment);
+        return;
+      }
+
+      web_server_route_handler_t handler = web_server_router_handler(&match, request->method());
+      if (!handler)
+        return;
+
+      // Handlers respond synchronously, so the pattern is valid for exactly this call
+      current_pattern = match.node->patterns[web_server_router_method_index(request->method())];
+      handler(request, &(match.args));
+      current_pattern = NULL;
+    }
+
+    void handleBody(AsyncWebServerRequest *request, uint8_t *data, size_t len, size_t index, size_t total) override
+    {
+      web_server_router_match_t match;
+      if (!web_server_router_match(request->url().c_str(), &match))
+        return;
+
+      int method_index = web_server_router_method_index(request->method());
+      if (method_index < 0)
+        return;
+
+      // Bodies of rejected requests are dropped, the rejection is sent once the request is complete
+      if (!web_server_admission_enter(request, index == 0))
+        return;
+
+      web_server_route_body_handler_t body_handler = match.node->body_handlers[method_index];
+      if (body_handler)
+        body_handler(request, match.node->body_args[method_index], data, len, index, total);
+    }
+
+    bool isRequestHandlerTrivial() override
+    {
+      // Bodies are needed by some routes
+      return false;
+    }
+};
+
+static WebServerRouter router;
+
+/*
+============================================================================
+                              Initialization                                
+============================================================================
+*/
+
+void web_server_router_on(
+  const char *pattern,
+  WebRequestMethod method,
+  web_server_route_handler_t handler,
+  web_server_route_body_handler_t body_handler,
+  const void *body_arg
+)
+{
+  int method_index = web_server_router_method_index(method);
+  if (method_index < 0 || pattern[0] != '/')
+  {
+    dbgerr("Invalid route %s for method %d!", pattern, (int) method);
+    return;
+  }
+
+  // Root node
+  if (num_nodes == 0 && !web_server_router_node_make())
+    return;
+
+  web_server_router_node_t *node = &(nodes[0]);
+  const char *segment = &pattern[1];
+
+  while (node)
+  {
+    const char *end = strchr(segment, '/');
+    size_t len = end ? (size_t) (end - segment) : strlen(segment);
+    node = web_server_router_child(node, segment, len);
+
+    if (!end)
+      break;
+
+    segment = end + 1;
+  }
+
+  if (!node)
+    return;
+
+  node->handlers[method_index] = handler;
+  node->body_handlers[method_index] = body_handler;
+  node->body_args[method_index] = body_arg;
+  node->patterns[method_index] = pattern;
+}
+
+const char *web_server_router_current_pattern()
+{
+  return current_pattern;
+}
+
+void web_server_router_init(AsyncWebServer *wsrv)
+{
+  wsrv->addHandler(&router);
+}
\ No newline at end of file
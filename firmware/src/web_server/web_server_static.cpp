@@ -0,0 +1,615 @@
+#include "web_server/web_server_static.h"
+
+typedef struct web_server_static_entry
+{
+  char path[WEB_SERVER_STATIC_PATH_MAXLEN];   // Path on the SD, empty if the slot is free
+  uint8_t *body;                              // Cached content, mman-allocated
+  size_t body_len;                            // Length of the content in bytes
+  time_t last_write;                          // Last write time of the file when it was read
+  uint32_t last_used;                         // Usage tick of the last access, for LRU eviction
+} web_server_static_entry_t;
+
+/**
+ * @brief Reference to a cached file's content, which stays valid after the lock has been released
+ */
+typedef struct web_server_static_ref
+{
+  uint8_t *body;                              // Referenced content, has to be released using mman_dealloc
+  size_t body_len;                            // Length of the content in bytes
+  time_t last_write;                          // Last write time of the file when it was read
+} web_server_static_ref_t;
+
+typedef struct web_server_static_type
+{
+  const char *ext;
+  const char *type;
+} web_server_static_type_t;
+
+static web_server_static_entry_t entries[WEB_SERVER_STATIC_CACHE_SLOTS];
+static uint32_t usage_tick = 0;
+
+static web_server_static_stats_t stats;
+
+// Responses are built on the webserver's task, while invalidations come from the file system worker
+static SemaphoreHandle_t static_lock = NULL;
+
+static const web_server_static_type_t content_types[] = {
+  { ".html", "text/html" },
+  { ".htm", "text/html" },
+  { ".css", "text/css" },
+  { ".js", "application/javascript" },
+  { ".json", "application/json" },
+  { ".map", "application/json" },
+  { ".txt", "text/plain" },
+  { ".xml", "text/xml" },
+  { ".svg", "image/svg+xml" },
+  { ".png", "image/png" },
+  { ".gif", "image/gif" },
+  { ".jpg", "image/jpeg" },
+  { ".ico", "image/x-icon" },
+  { ".woff", "font/woff" },
+  { ".woff2", "font/woff2" },
+  { ".ttf", "font/ttf" },
+};
+
+/*
+============================================================================
+                                   Cache                                    
+============================================================================
+*/
+
+/**
+ * @brief Find the entry of a path, expects the lock to be held
+ */
+INLINED static web_server_static_entry_t *web_server_static_cache_find(const char *path)
+{
+  for (size_t i = 0; i < WEB_SERVER_STATIC_CACHE_SLOTS; i++)
+  {
+    if (strncmp(entries[i].path, path, WEB_SERVER_STATIC_PATH_MAXLEN) == 0)
+      return &(entries[i]);
+  }
+
+  return NULL;
+}
+
+/**
+ * @brief Drop an entry's content, expects the lock to be held
+ */
+INLINED static void web_server_static_cache_drop(web_server_static_entry_t *entry)
+{
+  // In-flight responses still hold their own reference to the body
+  mman_dealloc(entry->body);
+  stats.cache_bytes -= entry->body_len;
+
+  entry->path[0] = 0;
+  entry->body = NULL;
+  entry->body_len = 0;
+}
+
+/**
+ * @brief Evict least recently used entries until a body of the given length fits
+ * within the budget, expects the lock to be held
+ * 
+ * @return web_server_static_entry_t* Free slot to store the body in
+ */
+static web_server_static_entry_t *web_server_static_cache_make_room(size_t body_len)
+{
+  while (true)
+  {
+    web_server_static_entry_t *free_slot = NULL, *lru = NULL;
+
+    for (size_t i = 0; i < WEB_SERVER_STATIC_CACHE_SLOTS; i++)
+    {
+      web_server_static_entry_t *entry = &(entries[i]);
+
+      if (!entry->path[0])
+      {
+        if (!free_slot)
+          free_slot = entry;
+        continue;
+      }
+
+      if (!lru || entry->last_used < lru->last_used)
+        lru = entry;
+    }
+
+    if (free_slot && stats.cache_bytes + body_len <= WEB_SERVER_STATIC_CACHE_BUDGET)
+      return free_slot;
+
+    // Cannot happen, as single bodies never exceed the budget
+    if (!lru)
+      return NULL;
+
+    web_server_static_cache_drop(lru);
+    stats.cache_evictions++;
+  }
+}
+
+INLINED static void web_server_static_cache_ref(web_server_static_entry_t *entry, web_server_static_ref_t *out)
+{
+  entry->last_used = ++usage_tick;
+  out->body = (uint8_t *) mman_ref(entry->body);
+  out->body_len = entry->body_len;
+  out->last_write = entry->last_write;
+}
+
+/**
+ * @brief Check whether a path is cached without touching the SD
+ */
+static bool web_server_static_cache_has(const char *path)
+{
+  xSemaphoreTake(static_lock, portMAX_DELAY);
+  bool res = web_server_static_cache_find(path) != NULL;
+  xSemaphoreGive(static_lock);
+  return res;
+}
+
+/**
+ * @brief Reference a path's cached content
+ * 
+ * @return true The path was cached and the reference has been taken
+ */
+static bool web_server_static_cache_get(const char *path, web_server_static_ref_t *out)
+{
+  xSemaphoreTake(static_lock, portMAX_DELAY);
+
+  web_server_static_entry_t *entry = web_server_static_cache_find(path);
+  if (entry)
+    web_server_static_cache_ref(entry, out);
+
+  xSemaphoreGive(static_lock);
+  return entry != NULL;
+}
+
+/**
+ * @brief Read an opened file into the cache and reference it's content, the file is
+ * left open and rewound if it could not be cached
+ * 
+ * @return true The file has been cached and the reference has been taken
+ * @return false The file is too large to be cached, there's not enough heap left or it could not be read
+ */
+static bool web_server_static_cache_load(const char *path, File *f, web_server_static_ref_t *out)
+{
+  size_t len = f->size();
+  if (len > WEB_SERVER_STATIC_CACHE_FILE_MAXLEN || strlen(path) >= WEB_SERVER_STATIC_PATH_MAXLEN)
+    return false;
+
+  // Read outside of the lock, as that's the slow part
+  uint8_t *body = (uint8_t *) mman_alloc(sizeof(uint8_t), len, NULL);
+
+  // Not worth failing the request over, the file is streamed instead
+  if (!body)
+  {
+    dbgerr("Could not allocate %lu bytes to cache the static file %s!", (unsigned long) len, path);
+    f->seek(0);
+    return false;
+  }
+
+  size_t read = 0;
+  while (read < len)
+  {
+    int res = f->read(&body[read], len - read);
+    if (res <= 0)
+      break;
+
+    read += res;
+  }
+
+  if (read != len)
+  {
+    dbgerr("Could not read the static file %s!", path);
+    mman_dealloc(body);
+    f->seek(0);
+    return false;
+  }
+
+  xSemaphoreTake(static_lock, portMAX_DELAY);
+
+  // Another request loaded it in the meantime
+  web_server_static_entry_t *entry = web_server_static_cache_find(path);
+  if (entry)
+    web_server_static_cache_drop(entry);
+
+  entry = web_server_static_cache_make_room(len);
+  if (!entry)
+  {
+    xSemaphoreGive(static_lock);
+    mman_dealloc(body);
+    f->seek(0);
+    return false;
+  }
+
+  strcpy(entry->path, path);
+  entry->body = body;
+  entry->body_len = len;
+  entry->last_write = f->getLastWrite();
+  stats.cache_bytes += len;
+
+  web_server_static_cache_ref(entry, out);
+
+  xSemaphoreGive(static_lock);
+  return true;
+}
+
+/*
+============================================================================
+                                Invalidation                                
+============================================================================
+*/
+
+void web_server_static_invalidate(const char *path)
+{
+  if (!static_lock)
+    return;
+
+  size_t path_len = strlen(path);
+
+  // Ignore trailing slashes of directories
+  while (path_len > 1 && path[path_len - 1] == '/')
+    path_len--;
+
+  xSemaphoreTake(static_lock, portMAX_DELAY);
+
+  for (size_t i = 0; i < WEB_SERVER_STATIC_CACHE_SLOTS; i++)
+  {
+    web_server_static_entry_t *entry = &(entries[i]);
+    if (!entry->path[0])
+      continue;
+
+    // The file itself, it's precompressed sibling or one of it's parent directories changed
+    if (
+      strncmp(entry->path, path, path_len) != 0
+      || (
+        entry->path[path_len] != 0 && entry->path[path_len] != '/' && path[path_len - 1] != '/'
+        && strcmp(&(entry->path[path_len]), WEB_SERVER_STATIC_GZIP_EXT) != 0
+      )
+    )
+      continue;
+
+    web_server_static_cache_drop(entry);
+  }
+
+  xSemaphoreGive(static_lock);
+}
+
+web_server_static_stats_t web_server_static_get_stats()
+{
+  return stats;
+}
+
+/*
+============================================================================
+                                   Files                                    
+============================================================================
+*/
+
+/**
+ * @brief Open a regular file, directories are never served
+ */
+INLINED static bool web_server_static_open_file(const char *path, File *f)
+{
+  *f = SD.open(path);
+  if (!(*f))
+    return false;
+
+  if (f->isDirectory())
+  {
+    f->close();
+    *f = File(NULL);
+    return false;
+  }
+
+  return true;
+}
+
+/**
+ * @brief Check whether a file's name carries a content hash, like main.<hash>.js
+ */
+INLINED static bool web_server_static_is_hashed(const char *path)
+{
+  const char *base = strrchr(path, '/');
+  base = base ? base + 1 : path;
+
+  // The hash is the segment right before the extension
+  const char *ext = strrchr(base, '.');
+  if (!ext)
+    return false;
+
+  const char *hash = ext;
+  while (hash > base && *(hash - 1) != '.')
+    hash--;
+
+  // No name in front of the hash
+  if (hash == base)
+    return false;
+
+  size_t hash_len = ext - hash;
+  if (hash_len < WEB_SERVER_STATIC_HASH_MINLEN)
+    return false;
+
+  for (size_t i = 0; i < hash_len; i++)
+  {
+    if (!isxdigit(hash[i]))
+      return false;
+  }
+
+  return true;
+}
+
+/**
+ * @brief Get the content type of a file by it's extension
+ */
+INLINED static const char *web_server_static_content_type(const char *path)
+{
+  const char *ext = strrchr(path, '.');
+  if (ext)
+  {
+    for (size_t i = 0; i < sizeof(content_types) / sizeof(web_server_static_type_t); i++)
+    {
+      if (strcmp(content_types[i].ext, ext) == 0)
+        return content_types[i].type;
+    }
+  }
+
+  return "application/octet-stream";
+}
+
+INLINED static void web_server_static_make_etag(char *etag, size_t etag_len, size_t size, time_t last_write, bool gzipped)
+{
+  snprintf(
+    etag, etag_len, "\"%x-%lx%s\"",
+    (unsigned int) size, (unsigned long) last_write, gzipped ? "-gz" : ""
+  );
+}
+
+INLINED static void web_server_static_append_headers(AsyncWebServerResponse *resp, const char *path, const char *etag)
+{
+  resp->addHeader("ETag", etag);
+  resp->addHeader("Vary", "Accept-Encoding");
+  resp->addHeader(
+    "Cache-Control",
+    web_server_static_is_hashed(path) ? WEB_SERVER_STATIC_CACHE_IMMUTABLE : WEB_SERVER_STATIC_CACHE_REVALIDATE
+  );
+}
+
+/**
+ * @brief Begin a response which sends a referenced cached body, the reference is moved into the response
+ */
+static AsyncWebServerResponse *web_server_static_begin_cached(
+  AsyncWebServerRequest *request,
+  const char *type,
+  web_server_static_ref_t *ref
+)
+{
+  // The response's filler holds the reference, so an invalidation can't free the body while it's being sent
+  std::shared_ptr<uint8_t> body_ref(ref->body, mman_dealloc);
+  size_t body_len = ref->body_len;
+
+  return request->beginResponse(
+    type, body_len,
+    [body_ref, body_len](uint8_t *buf, size_t max_len, size_t index) -> size_t {
+      size_t remaining = body_len - index;
+      size_t len = remaining < max_len ? remaining : max_len;
+      memcpy(buf, &(body_ref.get()[index]), len);
+      return len;
+    }
+  );
+}
+
+/**
+ * @brief Begin a response which streams an uncached file through a read-ahead reader,
+ * falls back to the library's file response if the reader pool is exhausted
+ */
+static AsyncWebServerResponse *web_server_static_begin_file(
+  AsyncWebServerRequest *request,
+  File f,
+  const char *path,
+  const char *type,
+  bool gzipped
+)
+{
+  size_t len = f.size();
+  sd_reader_t *reader = sd_reader_open(f);
+
+  // The file response adds the gzip encoding itself, based on the file's name
+  if (!reader)
+    return request->beginResponse(f, path, type);
+
+  // Closed as soon as the response is done with it, no matter how it ends
+  std::shared_ptr<sd_reader_t> reader_ref(reader, sd_reader_close);
+
+  AsyncWebServerResponse *resp = request->beginResponse(
+    type, len,
+    [reader_ref](uint8_t *buf, size_t max_len, size_t index) -> size_t {
+      // Never wait for the SD here, as this runs on the TCP task which all connections share,
+      // the first chunk is already in when the reader is opened, so only later ones may be pending
+      size_t read = sd_reader_read(reader_ref.get(), buf, max_len, 0);
+
+      // The next chunk is still being read, ask to be called again on the next ack or poll
+      if (read == SD_READER_PENDING)
+        return RESPONSE_TRY_AGAIN;
+
+      return read;
+    }
+  );
+
+  if (gzipped)
+    resp->addHeader("Content-Encoding", "gzip");
+
+  return resp;
+}
+
+void web_server_static_send_index(AsyncWebServerRequest *request, const char *path)
+{
+  web_server_static_ref_t ref;
+  if (web_server_static_cache_get(path, &ref))
+  {
+    stats.cache_hits++;
+    request->send(web_server_static_begin_cached(request, "text/html", &ref));
+    return;
+  }
+
+  stats.cache_misses++;
+
+  File f;
+  if (!web_server_static_open_file(path, &f))
+  {
+    request->send(404);
+    return;
+  }
+
+  if (web_server_static_cache_load(path, &f, &ref))
+  {
+    f.close();
+    request->send(web_server_static_begin_cached(request, "text/html", &ref));
+    return;
+  }
+
+  // Not cacheable, stream it
+  request->send(web_server_static_begin_file(request, f, path, "text/html", false));
+}
+
+/**
+ * @brief Serves files from the static web-root, preferring cached and precompressed variants
+ */
+class WebServerStaticHandler : public AsyncWebHandler
+{
+  public:
+    bool canHandle(AsyncWebServerRequest *request) override
+    {
+      if (request->method() != HTTP_GET && request->method() != HTTP_HEAD)
+        return false;
+
+      // API paths never live on the SD, don't cause lookups for them
+      const String &url = request->url();
+      if (url.startsWith("/api/"))
+        return false;
+
+      request->addInterestingHeader("Accept-Encoding");
+      request->addInterestingHeader("If-None-Match");
+
+      // Directories are answered with their index.html
+      char path[WEB_SERVER_STATIC_PATH_MAXLEN];
+      int path_len = snprintf(
+        path, sizeof(path), "%s%s%s",
+        WEB_SERVER_STATIC_PATH, url.c_str() + 1, url.endsWith("/") ? "index.html" : ""
+      );
+
+      if (path_len < 0 || path_len + strlen(WEB_SERVER_STATIC_GZIP_EXT) >= sizeof(path))
+        return false;
+
+      // Try the precompressed sibling first, cached files don't need to be opened
+      File f;
+      bool found = false;
+      if (request->hasHeader("Accept-Encoding") && strstr(request->header("Accept-Encoding").c_str(), "gzip"))
+      {
+        strcpy(&path[path_len], WEB_SERVER_STATIC_GZIP_EXT);
+        found = web_server_static_cache_has(path) || web_server_static_open_file(path, &f);
+
+        if (!found)
+          path[path_len] = 0;
+      }
+
+      if (!found && !web_server_static_cache_has(path) && !web_server_static_open_file(path, &f))
+        return false;
+
+      // Same hand-over as the library's static handler, the request frees the path
+      request->_tempFile = f;
+      request->_tempObject = strdup(path);
+      return true;
+    }
+
+    void handleRequest(AsyncWebServerRequest *request) override
+    {
+      // Path of the file which is sent, the response's path lacks the extension of a precompressed sibling
+      const char *path = (const char *) request->_tempObject;
+      bool gzipped = (
+        String(path).endsWith(WEB_SERVER_STATIC_GZIP_EXT)
+        && !request->url().endsWith(WEB_SERVER_STATIC_GZIP_EXT)
+      );
+
+      char resp_path[WEB_SERVER_STATIC_PATH_MAXLEN];
+      strcpy(resp_path, path);
+      if (gzipped)
+        resp_path[strlen(resp_path) - strlen(WEB_SERVER_STATIC_GZIP_EXT)] = 0;
+
+      // Prefer the cache, the file may also have been cached or invalidated since the lookup
+      File f = request->_tempFile;
+      web_server_static_ref_t ref;
+      bool cached = web_server_static_cache_get(path, &ref);
+
+      if (cached)
+        stats.cache_hits++;
+
+      else
+      {
+        stats.cache_misses++;
+
+        if (!f && !web_server_static_open_file(path, &f))
+        {
+          request->send(404);
+          return;
+        }
+
+        cached = web_server_static_cache_load(path, &f, &ref);
+      }
+
+      char etag[WEB_SERVER_STATIC_ETAG_MAXLEN];
+      size_t size = cached ? ref.body_len : f.size();
+      web_server_static_make_etag(etag, sizeof(etag), size, cached ? ref.last_write : f.getLastWrite(), gzipped);
+
+      // The file is only streamed if it couldn't be cached
+      if (cached && f)
+        f.close();
+
+      // The client already holds the current file
+      if (request->hasHeader("If-None-Match") && request->header("If-None-Match") == etag)
+      {
+        stats.not_modified++;
+
+        if (cached)
+          mman_dealloc(ref.body);
+        else
+          f.close();
+
+        AsyncWebServerResponse *resp = request->beginResponse(304);
+        web_server_static_append_headers(resp, resp_path, etag);
+        request->send(resp);
+        return;
+      }
+
+      stats.files++;
+      stats.bytes += size;
+      if (gzipped)
+        stats.gzipped++;
+
+      AsyncWebServerResponse *resp;
+      const char *type = web_server_static_content_type(resp_path);
+      if (cached)
+      {
+        resp = web_server_static_begin_cached(request, type, &ref);
+        if (gzipped)
+          resp->addHeader("Content-Encoding", "gzip");
+      }
+
+      else
+        resp = web_server_static_begin_file(request, f, resp_path, type, gzipped);
+
+      web_server_static_append_headers(resp, resp_path, etag);
+      request->send(resp);
+    }
+};
+
+static WebServerStaticHandler static_handler;
+
+/*
+============================================================================
+                              Initialization                                
+============================================================================
+*/
+
+void web_server_static_init(AsyncWebServer *wsrv)
+{
+  static_lock = xSemaphoreCreateMutex();
+  wsrv->addHandler(&static_handler);
+}
\ No newline at end of file
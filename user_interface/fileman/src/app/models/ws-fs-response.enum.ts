@@ -25,4 +25,6 @@ export enum EWSFSResp {
   WSFS_UPDATE_FAILED = "WSFS_UPDATE_FAILED",
   WSFS_UPDATED = "WSFS_UPDATED",
   WSFS_NOT_A_BIN = "WSFS_NOT_A_BIN",
+  WSFS_UPLOADS_BUSY = "WSFS_UPLOADS_BUSY",
+  WSFS_DIR_CHANGED = "WSFS_DIR_CHANGED",
 }
\ No newline at end of file
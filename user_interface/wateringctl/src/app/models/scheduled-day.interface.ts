@@ -2,5 +2,6 @@ import { IInterval } from './interval.interface';
 
 export interface IScheduledDay {
   disabled: boolean;
+  slots: number;
   intervals: IInterval[];
 }
\ No newline at end of file
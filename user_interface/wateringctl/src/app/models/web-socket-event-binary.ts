@@ -0,0 +1,133 @@
+import { stringifyIntervalTime } from './interval.interface';
+import { EWebSocketEventType } from './web-socket-event-type.enum';
+import { IWebSocketEvent } from './web-socket-event.interface';
+
+// Subprotocol to request binary framed events with
+export const WEB_SOCKET_EVENT_PROTO_BIN = 'wse.bin.v1';
+
+// Event types, indexed by their binary id
+const eventTypesById: EWebSocketEventType[] = [
+  EWebSocketEventType.WSE_INTERVAL_SCHED_ON,
+  EWebSocketEventType.WSE_INTERVAL_SCHED_OFF,
+  EWebSocketEventType.WSE_VALVE_ON,
+  EWebSocketEventType.WSE_VALVE_OFF,
+  EWebSocketEventType.WSE_VALVE_RENAME,
+  EWebSocketEventType.WSE_VALVE_DISABLE_ON,
+  EWebSocketEventType.WSE_VALVE_DISABLE_OFF,
+  EWebSocketEventType.WSE_DAY_DISABLE_ON,
+  EWebSocketEventType.WSE_DAY_DISABLE_OFF,
+  EWebSocketEventType.WSE_INTERVAL_DISABLE_ON,
+  EWebSocketEventType.WSE_INTERVAL_DISABLE_OFF,
+  EWebSocketEventType.WSE_INTERVAL_START_CHANGE,
+  EWebSocketEventType.WSE_INTERVAL_END_CHANGE,
+  EWebSocketEventType.WSE_INTERVAL_IDENTIFIER_CHANGE,
+  EWebSocketEventType.WSE_INTERVAL_DELETED,
+  EWebSocketEventType.WSE_VALVE_TIMER_UPDATED,
+  EWebSocketEventType.WSE_RESYNC_REQUIRED,
+  EWebSocketEventType.WSE_EPOCH,
+];
+
+// Weekdays, indexed by their binary id
+const weekdaysById: string[] = [
+  'WEEKDAY_SU', 'WEEKDAY_MO', 'WEEKDAY_TU', 'WEEKDAY_WE', 'WEEKDAY_TH', 'WEEKDAY_FR', 'WEEKDAY_SA',
+];
+
+const decodeTime = (secs: number): string => {
+  return stringifyIntervalTime([Math.floor(secs / 3600), Math.floor(secs / 60) % 60, secs % 60]);
+};
+
+/**
+ * Decode a single binary framed event starting at the given offset
+ */
+const decodeBinaryWebSocketEvent = (view: DataView, start: number): { event: IWebSocketEvent, next: number } | null => {
+  const buf = view.buffer;
+  const type = eventTypesById[view.getUint8(start)];
+  const seq = view.getUint32(start + 1, true);
+  if (!type)
+    return null;
+
+  let offs = start + 5;
+  const u8 = () => String(view.getUint8(offs++));
+  const day = () => weekdaysById[view.getUint8(offs++)];
+  const u32 = () => {
+    const value = view.getUint32(offs, true);
+    offs += 4;
+    return value;
+  };
+  const time = () => decodeTime(u32());
+  const alias = () => {
+    const len = view.getUint8(offs++);
+    const str = new TextDecoder().decode(new Uint8Array(buf, offs, len));
+    offs += len;
+    return str;
+  };
+
+  let args: string[] = [];
+  switch (type) {
+    case EWebSocketEventType.WSE_INTERVAL_SCHED_ON:
+    case EWebSocketEventType.WSE_INTERVAL_SCHED_OFF:
+    case EWebSocketEventType.WSE_VALVE_ON:
+    case EWebSocketEventType.WSE_VALVE_OFF:
+    case EWebSocketEventType.WSE_VALVE_DISABLE_ON:
+    case EWebSocketEventType.WSE_VALVE_DISABLE_OFF:
+      args = [u8()];
+      break;
+
+    case EWebSocketEventType.WSE_DAY_DISABLE_ON:
+    case EWebSocketEventType.WSE_DAY_DISABLE_OFF:
+      args = [day()];
+      break;
+
+    case EWebSocketEventType.WSE_INTERVAL_DISABLE_ON:
+    case EWebSocketEventType.WSE_INTERVAL_DISABLE_OFF:
+    case EWebSocketEventType.WSE_INTERVAL_DELETED:
+      args = [day(), u8()];
+      break;
+
+    case EWebSocketEventType.WSE_INTERVAL_START_CHANGE:
+    case EWebSocketEventType.WSE_INTERVAL_END_CHANGE:
+      args = [day(), u8(), time()];
+      break;
+
+    case EWebSocketEventType.WSE_INTERVAL_IDENTIFIER_CHANGE:
+      args = [day(), u8(), u8()];
+      break;
+
+    case EWebSocketEventType.WSE_VALVE_RENAME:
+      args = [u8(), alias()];
+      break;
+
+    case EWebSocketEventType.WSE_VALVE_TIMER_UPDATED:
+      args = [u8(), time()];
+      break;
+
+    case EWebSocketEventType.WSE_EPOCH:
+      args = [String(u32())];
+      break;
+  }
+
+  return { event: { seq, type, args }, next: offs };
+};
+
+/**
+ * Decode all binary framed events of a frame into the same args as the text framing would carry
+ */
+export const decodeBinaryWebSocketEvents = (buf: ArrayBuffer): IWebSocketEvent[] => {
+  const view = new DataView(buf);
+  const events: IWebSocketEvent[] = [];
+
+  // Events are concatenated, each one's length follows from it's type
+  let offs = 0;
+  while (offs + 5 <= view.byteLength) {
+    const wse = decodeBinaryWebSocketEvent(view, offs);
+
+    // Unknown type, the remainder can't be delimited
+    if (!wse)
+      break;
+
+    events.push(wse.event);
+    offs = wse.next;
+  }
+
+  return events;
+};
\ No newline at end of file
@@ -0,0 +1,11 @@
+// Event topics a client can subscribe to, combined as a bitmask
+export enum EWebSocketEventTopic {
+  VALVES    = 1 << 0,
+  TIMERS    = 1 << 1,
+  SCHEDULE  = 1 << 2,
+  INTERVALS = 1 << 3,
+  ALL       = 0xFF,
+}
+
+// Valve mask which covers all valves
+export const WEB_SOCKET_EVENT_VALVES_ALL = 0xFFFFFFFF;
\ No newline at end of file
@@ -15,4 +15,6 @@ export enum EWebSocketEventType {
   WSE_INTERVAL_IDENTIFIER_CHANGE    = "WSE_INTERVAL_IDENTIFIER_CHANGE",
   WSE_INTERVAL_DELETED              = "WSE_INTERVAL_DELETED",
   WSE_VALVE_TIMER_UPDATED           = "WSE_VALVE_TIMER_UPDATED",
+  WSE_RESYNC_REQUIRED               = "WSE_RESYNC_REQUIRED",
+  WSE_EPOCH                         = "WSE_EPOCH",
 }
\ No newline at end of file
@@ -1,6 +1,7 @@
 import { EWebSocketEventType } from './web-socket-event-type.enum';
 
 export interface IWebSocketEvent {
+  seq: number;
   type: EWebSocketEventType;
   args: string[];
 }
\ No newline at end of file
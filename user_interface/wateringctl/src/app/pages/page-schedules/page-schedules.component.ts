@@ -7,6 +7,7 @@ import { compareIntervalStarts, IInterval, isIntervalEmpty, setIntervalEmpty } f
 import { IScheduledDay } from 'src/app/models/scheduled-day.interface';
 import { ESchedulerWeekday } from 'src/app/models/scheduler-weekday.enum';
 import { IStatePersistable } from 'src/app/models/state-persistable.interface';
+import { EWebSocketEventTopic } from 'src/app/models/web-socket-event-topic.enum';
 import { EWebSocketEventType } from 'src/app/models/web-socket-event-type.enum';
 import { IWebSocketEvent } from 'src/app/models/web-socket-event.interface';
 import { ComponentStateService } from 'src/app/services/component-state.service';
@@ -93,6 +94,13 @@ export class PageSchedulesComponent implements IStatePersistable, OnDestroy {
   ) {
     this.stateService.load(this);
     this._subs.sink = eventService.events.subscribe(e => this.handleWSE(e));
+
+    // Valve events are only needed to keep aliases up to date
+    eventService.subscribe(
+      EWebSocketEventTopic.SCHEDULE |
+      EWebSocketEventTopic.INTERVALS |
+      EWebSocketEventTopic.VALVES
+    );
   }
 
   private findInterval(wse: IWebSocketEvent, action: (interval: IInterval, args: string[]) => void) {
@@ -116,6 +124,12 @@ export class PageSchedulesComponent implements IStatePersistable, OnDestroy {
   }
 
   private handleWSE(wse: IWebSocketEvent) {
+    // Events have been missed, local state is out of sync
+    if (wse.type === EWebSocketEventType.WSE_RESYNC_REQUIRED) {
+      this.loadSchedule(false);
+      return;
+    }
+
     if (
       wse.type === EWebSocketEventType.WSE_DAY_DISABLE_ON ||
       wse.type === EWebSocketEventType.WSE_DAY_DISABLE_OFF
@@ -237,8 +251,18 @@ export class PageSchedulesComponent implements IStatePersistable, OnDestroy {
     if (schedule === null)
       return;
 
-    const nextEmpty = schedule.intervals.find(it => isIntervalEmpty(it));
-    if (!nextEmpty) {
+    // Only occupied slots are listed, take the lowest unlisted index
+    const occupied = new Set(
+      schedule.intervals
+        .filter(it => !isIntervalEmpty(it))
+        .map(it => it.index)
+    );
+
+    let nextEmpty = 0;
+    while (nextEmpty < schedule.slots && occupied.has(nextEmpty))
+      nextEmpty++;
+
+    if (nextEmpty >= schedule.slots) {
       this.notificationsService.publish({
         headline: this.tranService.instant('server_errors.headline'),
         text: this.tranService.instant('server_errors.NO_INT_SLOTS'),
@@ -253,7 +277,7 @@ export class PageSchedulesComponent implements IStatePersistable, OnDestroy {
     const now = new Date();
     this.schedulerService.putDaysIndexedInterval(
       this._currentDay as ESchedulerWeekday,
-      nextEmpty.index,
+      nextEmpty,
       {
         identifier: 0,
         disabled: false,
@@ -4,6 +4,7 @@ import { OverlayValveAliasEditComponent } from 'src/app/components/overlays/over
 import { OverlayValveTimerComponent } from 'src/app/components/overlays/overlay-valve-timer/overlay-valve-timer.component';
 import { IStatePersistable } from 'src/app/models/state-persistable.interface';
 import { compareValveIds, IValve } from 'src/app/models/valve.interface';
+import { EWebSocketEventTopic } from 'src/app/models/web-socket-event-topic.enum';
 import { EWebSocketEventType } from 'src/app/models/web-socket-event-type.enum';
 import { IWebSocketEvent } from 'src/app/models/web-socket-event.interface';
 import { ComponentStateService } from 'src/app/services/component-state.service';
@@ -75,6 +76,7 @@ export class PageValvesComponent implements IStatePersistable, OnDestroy {
     this.stateService.load(this);
     this.loadValves();
     this._subs.sink = eventService.events.subscribe(v => this.handleWSE(v));
+    eventService.subscribe(EWebSocketEventTopic.VALVES | EWebSocketEventTopic.TIMERS);
   }
 
   ngOnDestroy(): void {
@@ -88,6 +90,12 @@ export class PageValvesComponent implements IStatePersistable, OnDestroy {
   }
 
   private handleWSE(wse: IWebSocketEvent) {
+    // Events have been missed, local state is out of sync
+    if (wse.type === EWebSocketEventType.WSE_RESYNC_REQUIRED) {
+      this.loadValves();
+      return;
+    }
+
     if (
       wse.type === EWebSocketEventType.WSE_VALVE_ON ||
       wse.type === EWebSocketEventType.WSE_VALVE_OFF
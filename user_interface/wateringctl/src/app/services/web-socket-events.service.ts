@@ -1,5 +1,7 @@
 import { Injectable } from '@angular/core';
 import { Subject } from 'rxjs';
+import { decodeBinaryWebSocketEvents, WEB_SOCKET_EVENT_PROTO_BIN } from '../models/web-socket-event-binary';
+import { EWebSocketEventTopic, WEB_SOCKET_EVENT_VALVES_ALL } from '../models/web-socket-event-topic.enum';
 import { EWebSocketEventType } from '../models/web-socket-event-type.enum';
 import { IWebSocketEvent } from '../models/web-socket-event.interface';
 import { HttpService } from './http.service';
@@ -13,6 +15,16 @@ export class WebSocketEventsService {
   private _ws?: WebSocket;
   private _events = new Subject<IWebSocketEvent>();
 
+  // Sequence number of the last received event, missed ones are replayed on reconnect
+  private _lastSeq?: number;
+
+  // Epoch the sequence numbers belong to, announced on every connect as they start over on reboots
+  private _epoch?: number;
+
+  // Subscribed topics and valves, sent along on every (re)connect
+  private _topics: number = EWebSocketEventTopic.ALL;
+  private _valves: number = WEB_SOCKET_EVENT_VALVES_ALL;
+
   private _connTestStr = '<conn_test>';
   private _connTestTimeout?: number | undefined;
   private _connectionPoller?: number | undefined;
@@ -30,14 +42,21 @@ export class WebSocketEventsService {
     this.connect();
   }
 
-  private async parseMessage(ev: MessageEvent) {
-    // Read data as string, account for binary
-    let data = ev.data as string;
-    if (ev.data instanceof Blob)
-      data = await ev.data.text();
+  private parseTextEvent(data: string): IWebSocketEvent {
+    const seqDelim = data.indexOf(';');
+    const seq = Number.parseInt(data.substring(0, seqDelim));
+    const body = data.substring(seqDelim + 1);
+
+    const delim = body.indexOf(';');
+    const type = body.substring(0, delim) as EWebSocketEventType;
+    const args = body.substring(delim + 1).split(';');
+
+    return { seq, type, args };
+  }
 
+  private parseMessage(ev: MessageEvent) {
     // Connection test response, clear timeout
-    if (data === this._connTestStr) {
+    if (ev.data === this._connTestStr) {
       clearInterval(this._connTestTimeout);
 
       // Re-test again
@@ -45,14 +64,44 @@ export class WebSocketEventsService {
       return;
     }
 
-    const delim = data.indexOf(';');
-    const type = data.substring(0, delim);
-    const args = data.substring(delim + 1).split(';');
+    // Events are binary framed, as negotiated on connect, and a frame may carry a whole batch of them
+    const events = ev.data instanceof ArrayBuffer
+      ? decodeBinaryWebSocketEvents(ev.data)
+      : (ev.data as string).split('\n').map(line => this.parseTextEvent(line));
+
+    for (const wse of events) {
+      // Not an event in itself, only tells which boot the following sequence numbers belong to
+      if (wse.type === EWebSocketEventType.WSE_EPOCH) {
+        this._epoch = Number.parseInt(wse.args[0]);
+        continue;
+      }
+
+      // Already received before the replay caught up
+      if (
+        wse.type !== EWebSocketEventType.WSE_RESYNC_REQUIRED &&
+        this._lastSeq !== undefined &&
+        wse.seq <= this._lastSeq
+      )
+        continue;
+
+      this._lastSeq = wse.seq;
+      this._events.next(wse);
+    }
+  }
+
+  /**
+   * Only receive events of the given topics, and of the given valves (bit per valve id)
+   */
+  subscribe(topics: number, valves: number = WEB_SOCKET_EVENT_VALVES_ALL) {
+    this._topics = topics;
+    this._valves = valves;
 
-    this._events.next({
-      type: type as EWebSocketEventType,
-      args,
-    });
+    if (this._ws?.readyState === WebSocket.OPEN)
+      this.sendSubscription();
+  }
+
+  private sendSubscription() {
+    this._ws?.send(`sub;${this._topics};${this._valves >>> 0}`);
   }
 
   private disconnect() {
@@ -76,7 +125,12 @@ export class WebSocketEventsService {
       clearTimeout(this._connectionPoller);
 
     // Create a new websocket that directly feeds into the local subject
-    this._ws = new WebSocket(this._path);
+    let query = `?topics=${this._topics}&valves=${this._valves >>> 0}`;
+    if (this._epoch !== undefined && this._lastSeq !== undefined)
+      query += `&since=${this._epoch}:${this._lastSeq}`;
+
+    this._ws = new WebSocket(this._path + query, WEB_SOCKET_EVENT_PROTO_BIN);
+    this._ws.binaryType = 'arraybuffer';
     this._ws.onmessage = (e: MessageEvent) => this.parseMessage(e);
 
     // Connection closed
@@ -85,7 +139,11 @@ export class WebSocketEventsService {
       this.connect();
     }
 
-    this._ws.onopen = () => this.ensureConnection();
+    // The subscription might have changed while connecting
+    this._ws.onopen = () => {
+      this.sendSubscription();
+      this.ensureConnection();
+    };
   }
 
   private ensureConnection() {